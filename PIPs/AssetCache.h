@@ -0,0 +1,499 @@
+#pragma once
+
+#include "CompactPath.h"
+
+//
+// Content-addressed, memory-mapped on-disk cache for generated images and Paths
+//
+// Each asset is described by a recipe string listing everything that affects its contents, such as
+// "polka dots 824x824 seed 1". The recipe's 64-bit hash names a file in the cache directory; the recipe
+// is also stored in the file and checked on load, so a hash collision is just a miss.
+//
+// On a hit the file is memory-mapped rather than read. A software image's pixels stay in the mapped file
+// until something writes to the image, at which point the pixels are copied to the heap. Other image
+// types get a single copy from the mapping into the requested type. Paths are parsed straight from the
+// mapping.
+//
+// On a miss the create callback runs and its result is written to a temporary file that's then moved
+// into place, so other threads and processes never see a partly written asset. Loads and stores are
+// safe from any thread.
+//
+// The least recently used files are deleted when the cache is opened, to keep it under maxBytes.
+//
+class AssetCache
+{
+public:
+    explicit AssetCache(juce::File directory_ = getDefaultDirectory(), juce::int64 maxBytes = 256 * 1024 * 1024) :
+        directory(directory_)
+    {
+        directory.createDirectory();
+        trim(maxBytes);
+    }
+
+    ~AssetCache() = default;
+
+    static juce::File getDefaultDirectory()
+    {
+        return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory).getChildFile("JUCE Direct2D Test").getChildFile("Asset Cache");
+    }
+
+    //
+    // SoftwareImageType gets a zero-copy image backed by the mapped file; other types get a converted copy
+    //
+    juce::Image getImage(juce::String const& recipe, std::function<juce::Image()> create, juce::ImageType const& imageType = juce::SoftwareImageType{})
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+        auto file = getFile(recipe, Kind::image);
+
+        if (auto mappedImage = loadImage(file, recipe); mappedImage.isValid())
+        {
+            addResult(true, start);
+
+            if (dynamic_cast<juce::SoftwareImageType const*>(&imageType) != nullptr)
+            {
+                return mappedImage;
+            }
+
+            return imageType.convert(mappedImage);
+        }
+
+        auto image = create();
+        if (image.isValid())
+        {
+            storeImage(file, recipe, image);
+        }
+
+        addResult(false, start);
+        return image;
+    }
+
+    //
+    // Paths are stored exactly, unless compactTolerance is more than zero and the path can be stored as a
+    // CompactPath within that tolerance. Empty paths aren't stored, so a create callback that was cancelled
+    // part way can return an empty path without poisoning the cache.
+    //
+    juce::Path getPath(juce::String const& recipe, std::function<juce::Path()> create, float compactTolerance = 0.0f)
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+        auto file = getFile(recipe, Kind::path);
+
+        juce::Path path;
+        if (loadPath(file, recipe, path))
+        {
+            addResult(true, start);
+            return path;
+        }
+
+        path = create();
+        if (! path.isEmpty())
+        {
+            storePath(file, recipe, path, compactTolerance);
+        }
+
+        addResult(false, start);
+        return path;
+    }
+
+    void clear()
+    {
+        for (auto const& file : directory.findChildFiles(juce::File::findFiles, false, "*.asset"))
+        {
+            file.deleteFile();
+        }
+    }
+
+    //
+    // Hit rate is accumulated as 100 for a hit and 0 for a miss, so the average is a percentage
+    //
+    juce::StatisticsAccumulator<double> getHitRate() const
+    {
+        juce::ScopedLock locker{ statisticsLock };
+        return hitRate;
+    }
+
+    juce::StatisticsAccumulator<double> getLoadTime() const
+    {
+        juce::ScopedLock locker{ statisticsLock };
+        return loadTime;
+    }
+
+private:
+    enum class Kind
+    {
+        image = 1,
+        path
+    };
+
+    enum PathEncoding
+    {
+        exactPath = 1,
+        compactPath
+    };
+
+    static constexpr juce::uint32 magic = 0x54455341; // "ASET"
+    static constexpr juce::uint32 formatVersion = 1;
+    static constexpr size_t alignment = 16;
+
+    juce::File const directory;
+    juce::CriticalSection statisticsLock;
+    juce::StatisticsAccumulator<double> hitRate;
+    juce::StatisticsAccumulator<double> loadTime;
+    juce::CriticalSection touchedFilesLock;
+    mutable std::set<juce::String> touchedFiles;
+
+    void addResult(bool hit, juce::int64 startTicks)
+    {
+        juce::ScopedLock locker{ statisticsLock };
+        hitRate.addValue(hit ? 100.0 : 0.0);
+        loadTime.addValue(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000.0);
+    }
+
+    //
+    // 64-bit FNV-1a of the recipe and the kind of asset
+    //
+    juce::File getFile(juce::String const& recipe, Kind kind) const
+    {
+        juce::uint64 hash = 0xcbf29ce484222325ull;
+        auto addByte = [&](juce::uint8 byte)
+            {
+                hash = (hash ^ byte) * 0x100000001b3ull;
+            };
+
+        addByte((juce::uint8)kind);
+        for (auto character = recipe.toRawUTF8(); *character != 0; ++character)
+        {
+            addByte((juce::uint8)*character);
+        }
+
+        return directory.getChildFile(juce::String::toHexString((juce::int64)hash).paddedLeft('0', 16) + ".asset");
+    }
+
+    void trim(juce::int64 maxBytes) const
+    {
+        auto files = directory.findChildFiles(juce::File::findFiles, false, "*.asset");
+        std::sort(files.begin(), files.end(), [](juce::File const& a, juce::File const& b)
+            {
+                return a.getLastAccessTime() > b.getLastAccessTime();
+            });
+
+        juce::int64 totalBytes = 0;
+        for (auto const& file : files)
+        {
+            totalBytes += file.getSize();
+            if (totalBytes > maxBytes)
+            {
+                file.deleteFile();
+            }
+        }
+    }
+
+    //==============================================================================
+    //
+    // File layout, all little-endian:
+    //
+    //  magic, format version, kind, recipe length     4 x uint32
+    //  recipe                                         UTF-8, padded to 16 bytes
+    //  payload                                        kind-specific, starting 16-byte aligned
+    //
+    static size_t getPayloadOffset(size_t recipeBytes) noexcept
+    {
+        return (4 * sizeof(juce::uint32) + recipeBytes + alignment - 1) & ~(alignment - 1);
+    }
+
+    static void writeHeader(juce::OutputStream& stream, juce::String const& recipe, Kind kind)
+    {
+        auto recipeBytes = recipe.getNumBytesAsUTF8();
+
+        stream.writeInt((int)magic);
+        stream.writeInt((int)formatVersion);
+        stream.writeInt((int)kind);
+        stream.writeInt((int)recipeBytes);
+        stream.write(recipe.toRawUTF8(), recipeBytes);
+        stream.writeRepeatedByte(0, getPayloadOffset(recipeBytes) - 4 * sizeof(juce::uint32) - recipeBytes);
+    }
+
+    //
+    // Maps the file and checks its header; returns the payload offset, or 0 if the file isn't a match
+    //
+    size_t mapAndCheck(juce::File const& file, juce::String const& recipe, Kind kind, std::unique_ptr<juce::MemoryMappedFile>& mappedFile) const
+    {
+        if (! file.existsAsFile())
+        {
+            return 0;
+        }
+
+        mappedFile = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+        auto data = static_cast<juce::uint8 const*>(mappedFile->getData());
+        auto size = mappedFile->getSize();
+        auto recipeBytes = recipe.getNumBytesAsUTF8();
+        auto payloadOffset = getPayloadOffset(recipeBytes);
+
+        if (data == nullptr
+            || size < payloadOffset
+            || juce::ByteOrder::littleEndianInt(data) != magic
+            || juce::ByteOrder::littleEndianInt(data + 4) != formatVersion
+            || juce::ByteOrder::littleEndianInt(data + 8) != (juce::uint32)kind
+            || juce::ByteOrder::littleEndianInt(data + 12) != (juce::uint32)recipeBytes
+            || std::memcmp(data + 16, recipe.toRawUTF8(), recipeBytes) != 0)
+        {
+            mappedFile.reset();
+            return 0;
+        }
+
+        touch(file);
+        return payloadOffset;
+    }
+
+    //
+    // The access time only matters to trim(), which runs when the cache is opened, so each file is
+    // touched once per session rather than on every hit
+    //
+    void touch(juce::File const& file) const
+    {
+        {
+            juce::ScopedLock locker{ touchedFilesLock };
+            if (! touchedFiles.insert(file.getFileName()).second)
+            {
+                return;
+            }
+        }
+
+        file.setLastAccessTime(juce::Time::getCurrentTime());
+    }
+
+    template <typename Writer>
+    void store(juce::File const& file, Writer&& writer) const
+    {
+        juce::TemporaryFile temporaryFile{ file };
+
+        {
+            juce::FileOutputStream stream{ temporaryFile.getFile() };
+            if (stream.failedToOpen() || ! writer(stream))
+            {
+                return;
+            }
+
+            stream.flush();
+            if (stream.getStatus().failed())
+            {
+                return;
+            }
+        }
+
+        temporaryFile.overwriteTargetFileWithTemporary();
+    }
+
+    //==============================================================================
+    //
+    // Image payload: pixel format, width, height, line stride as uint32, then the pixels in the same layout
+    // as a software image
+    //
+    class MappedImagePixelData : public juce::ImagePixelData
+    {
+    public:
+        MappedImagePixelData(std::unique_ptr<juce::MemoryMappedFile> mappedFile_, size_t pixelOffset, juce::Image::PixelFormat format, int width_, int height_, int lineStride_) :
+            juce::ImagePixelData(format, width_, height_),
+            mappedFile(std::move(mappedFile_)),
+            pixels(static_cast<juce::uint8 const*>(mappedFile->getData()) + pixelOffset),
+            pixelStride(getPixelStride(format)),
+            lineStride(lineStride_)
+        {
+        }
+
+        std::unique_ptr<juce::LowLevelGraphicsContext> createLowLevelContext() override
+        {
+            sendDataChangeMessage();
+            return std::make_unique<juce::LowLevelGraphicsSoftwareRenderer>(juce::Image{ *this });
+        }
+
+        void initialiseBitmapData(juce::Image::BitmapData& bitmap, int x, int y, juce::Image::BitmapData::ReadWriteMode mode) override
+        {
+            if (mode != juce::Image::BitmapData::readOnly)
+            {
+                makeWritable();
+                sendDataChangeMessage();
+            }
+
+            auto base = writablePixels != nullptr ? writablePixels.get() : const_cast<juce::uint8*>(pixels);
+            bitmap.data = base + x * pixelStride + y * lineStride;
+            bitmap.size = (size_t)(lineStride * (height - y) - x * pixelStride);
+            bitmap.pixelFormat = pixelFormat;
+            bitmap.lineStride = lineStride;
+            bitmap.pixelStride = pixelStride;
+        }
+
+        juce::ImagePixelData::Ptr clone() override
+        {
+            juce::Image copy{ pixelFormat, width, height, false, juce::SoftwareImageType{} };
+
+            {
+                juce::Image::BitmapData dest{ copy, juce::Image::BitmapData::writeOnly };
+
+                for (int y = 0; y < height; ++y)
+                {
+                    std::memcpy(dest.getLinePointer(y), pixels + y * lineStride, (size_t)(width * pixelStride));
+                }
+            }
+
+            return copy.getPixelData();
+        }
+
+        std::unique_ptr<juce::ImageType> createType() const override
+        {
+            return std::make_unique<juce::SoftwareImageType>();
+        }
+
+    private:
+        std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+        juce::uint8 const* pixels;
+        int const pixelStride;
+        int const lineStride;
+        juce::HeapBlock<juce::uint8> writablePixels;
+
+        //
+        // The mapping is read-only, so the first write copies the pixels to the heap. The mapping stays
+        // until the pixel data is deleted, since BitmapData handed out earlier may still point into it.
+        //
+        void makeWritable()
+        {
+            if (writablePixels != nullptr)
+            {
+                return;
+            }
+
+            auto numBytes = (size_t)lineStride * (size_t)height;
+            writablePixels.malloc(numBytes);
+            std::memcpy(writablePixels.get(), pixels, numBytes);
+
+            pixels = writablePixels.get();
+        }
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MappedImagePixelData)
+    };
+
+    static int getPixelStride(juce::Image::PixelFormat format) noexcept
+    {
+        return format == juce::Image::RGB ? 3 : (format == juce::Image::ARGB ? 4 : 1);
+    }
+
+    juce::Image loadImage(juce::File const& file, juce::String const& recipe) const
+    {
+        std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+        auto payloadOffset = mapAndCheck(file, recipe, Kind::image, mappedFile);
+        if (payloadOffset == 0)
+        {
+            return {};
+        }
+
+        auto data = static_cast<juce::uint8 const*>(mappedFile->getData()) + payloadOffset;
+        auto available = mappedFile->getSize() - payloadOffset;
+        if (available < 4 * sizeof(juce::uint32))
+        {
+            return {};
+        }
+
+        auto format = (juce::Image::PixelFormat)juce::ByteOrder::littleEndianInt(data);
+        auto width = (int)juce::ByteOrder::littleEndianInt(data + 4);
+        auto height = (int)juce::ByteOrder::littleEndianInt(data + 8);
+        auto lineStride = (int)juce::ByteOrder::littleEndianInt(data + 12);
+
+        if ((format != juce::Image::ARGB && format != juce::Image::RGB && format != juce::Image::SingleChannel)
+            || width <= 0 || height <= 0 || lineStride < width * getPixelStride(format)
+            || (size_t)lineStride * (size_t)height > available - 4 * sizeof(juce::uint32))
+        {
+            return {};
+        }
+
+        return juce::Image{ new MappedImagePixelData{ std::move(mappedFile), payloadOffset + 4 * sizeof(juce::uint32), format, width, height, lineStride } };
+    }
+
+    void storeImage(juce::File const& file, juce::String const& recipe, juce::Image const& image) const
+    {
+        store(file, [&](juce::OutputStream& stream)
+            {
+                juce::Image::BitmapData bitmap{ image, juce::Image::BitmapData::readOnly };
+                auto pixelStride = getPixelStride(image.getFormat());
+                auto rowBytes = image.getWidth() * pixelStride;
+                auto lineStride = (rowBytes + 3) & ~3;
+
+                writeHeader(stream, recipe, Kind::image);
+                stream.writeInt((int)image.getFormat());
+                stream.writeInt(image.getWidth());
+                stream.writeInt(image.getHeight());
+                stream.writeInt(lineStride);
+
+                for (int y = 0; y < image.getHeight(); ++y)
+                {
+                    if (! stream.write(bitmap.getLinePointer(y), (size_t)rowBytes))
+                    {
+                        return false;
+                    }
+
+                    stream.writeRepeatedByte(0, (size_t)(lineStride - rowBytes));
+                }
+
+                return true;
+            });
+    }
+
+    //==============================================================================
+    //
+    // Path payload: encoding as uint32, then either Path::writePathToStream data or a CompactPath
+    //
+    bool loadPath(juce::File const& file, juce::String const& recipe, juce::Path& path) const
+    {
+        std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+        auto payloadOffset = mapAndCheck(file, recipe, Kind::path, mappedFile);
+        if (payloadOffset == 0 || mappedFile->getSize() < payloadOffset + sizeof(juce::uint32))
+        {
+            return false;
+        }
+
+        auto data = static_cast<juce::uint8 const*>(mappedFile->getData()) + payloadOffset;
+        auto size = mappedFile->getSize() - payloadOffset - sizeof(juce::uint32);
+
+        switch (juce::ByteOrder::littleEndianInt(data))
+        {
+        case PathEncoding::exactPath:
+            path.loadPathFromData(data + sizeof(juce::uint32), size);
+            return true;
+
+        case PathEncoding::compactPath:
+        {
+            juce::MemoryInputStream stream{ data + sizeof(juce::uint32), size, false };
+            CompactPath compact;
+            if (! compact.readFromStream(stream))
+            {
+                return false;
+            }
+
+            compact.decode(path);
+            return true;
+        }
+        }
+
+        return false;
+    }
+
+    void storePath(juce::File const& file, juce::String const& recipe, juce::Path const& path, float compactTolerance) const
+    {
+        store(file, [&](juce::OutputStream& stream)
+            {
+                writeHeader(stream, recipe, Kind::path);
+
+                CompactPath compact;
+                if (compactTolerance > 0.0f && compact.encode(path, compactTolerance))
+                {
+                    stream.writeInt(PathEncoding::compactPath);
+                    compact.writeToStream(stream);
+                    return true;
+                }
+
+                stream.writeInt(PathEncoding::exactPath);
+                path.writePathToStream(stream);
+                return true;
+            });
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AssetCache)
+};
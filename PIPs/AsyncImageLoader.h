@@ -0,0 +1,202 @@
+#pragma once
+
+#include "ImageResampler.h"
+
+//
+// Decodes image files on worker threads so the message thread never waits on PNG or JPEG decoding
+//
+// load() returns a Request straight away. A worker thread decodes the file, then, if it's bigger than
+// the requested maximum size, downscales it to fit into a staging image from PixelBufferPool. The
+// request then goes back to the message thread, which uploads it to a native image if asked and calls
+// onReady, usually to trigger a repaint. Until then, Request::draw() paints a placeholder.
+//
+// Staging buffers go back to the shared pool when they've been uploaded or when the request is
+// released, so a stream of similar-sized thumbnails keeps reusing the same few buffers. A request
+// that's released before its turn comes is skipped without being decoded.
+//
+// The loader can be destroyed with loads still queued; queued jobs are dropped and running ones finish.
+// onReady runs on the message thread and may come after the loader is gone, so it shouldn't touch the
+// loader.
+//
+class AsyncImageLoader
+{
+public:
+    struct Options
+    {
+        int maxWidth = std::numeric_limits<int>::max();
+        int maxHeight = std::numeric_limits<int>::max();
+        bool uploadToNative = true;
+    };
+
+    //==============================================================================
+    class Request : public juce::ReferenceCountedObject
+    {
+    public:
+        using Ptr = juce::ReferenceCountedObjectPtr<Request>;
+
+        Request(juce::File const& file_, Options options_, std::function<void()> onReady_) :
+            file(file_),
+            options(options_),
+            onReady(std::move(onReady_))
+        {
+        }
+
+        ~Request() override = default;
+
+        bool isReady() const noexcept { return state == State::ready; }
+        bool hasFailed() const noexcept { return state == State::failed; }
+
+        //
+        // Message thread only; null until the request is ready
+        //
+        juce::Image getImage() const
+        {
+            return isReady() ? image : juce::Image{};
+        }
+
+        //
+        // Draws the image fitted into the area, or a placeholder if it isn't ready
+        //
+        void draw(juce::Graphics& g, juce::Rectangle<float> area) const
+        {
+            if (isReady())
+            {
+                g.drawImage(image, area, juce::RectanglePlacement::centred);
+                return;
+            }
+
+            g.setColour(juce::Colours::grey.withAlpha(hasFailed() ? 0.2f : 0.5f));
+            g.fillRoundedRectangle(area.reduced(2.0f), 4.0f);
+        }
+
+        juce::File const file;
+        Options const options;
+
+        //
+        // Time spent decoding and downscaling on the worker thread
+        //
+        double decodeMilliseconds = 0.0;
+
+    private:
+        friend class AsyncImageLoader;
+
+        enum class State
+        {
+            pending,
+            ready,
+            failed
+        };
+
+        std::atomic<State> state{ State::pending };
+        std::function<void()> onReady;
+        juce::Image image;
+        juce::Image stagingImage;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Request)
+    };
+
+    //==============================================================================
+    AsyncImageLoader(int numThreads = juce::jmax(1, juce::SystemStats::getNumCpus() / 2)) :
+        threadPool(numThreads)
+    {
+    }
+
+    ~AsyncImageLoader()
+    {
+        threadPool.removeAllJobs(true, -1);
+    }
+
+    Request::Ptr load(juce::File const& file, Options options, std::function<void()> onReady)
+    {
+        Request::Ptr request = new Request{ file, options, std::move(onReady) };
+
+        threadPool.addJob([this, request]
+            {
+                //
+                // Nobody else holds the request, so nobody is waiting for it
+                //
+                if (request->getReferenceCount() == 1)
+                {
+                    return;
+                }
+
+                decode(*request);
+
+                juce::MessageManager::callAsync([request]
+                    {
+                        finish(*request);
+                    });
+            });
+
+        return request;
+    }
+
+    int getNumPending() const
+    {
+        return threadPool.getNumJobs();
+    }
+
+private:
+    ImageResampler resampler;
+    juce::CriticalSection resamplerLock;
+    juce::ThreadPool threadPool;
+
+    void decode(Request& request)
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+        auto decoded = juce::ImageFileFormat::loadFrom(request.file);
+
+        if (decoded.isValid())
+        {
+            auto scale = juce::jmin(1.0, (double)request.options.maxWidth / decoded.getWidth(), (double)request.options.maxHeight / decoded.getHeight());
+            auto width = juce::jmax(1, juce::roundToInt(decoded.getWidth() * scale));
+            auto height = juce::jmax(1, juce::roundToInt(decoded.getHeight() * scale));
+
+            if (width < decoded.getWidth() || height < decoded.getHeight())
+            {
+                //
+                // The resampler already spreads each image across its own threads, so one at a time
+                //
+                request.stagingImage = juce::Image{ decoded.getFormat(), width, height, false, PixelBufferPool::Type{} };
+
+                juce::ScopedLock locker{ resamplerLock };
+                resampler.rescaleInto(decoded, request.stagingImage, juce::Graphics::mediumResamplingQuality);
+            }
+            else
+            {
+                request.stagingImage = juce::SoftwareImageType{}.convert(decoded);
+            }
+        }
+
+        request.decodeMilliseconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+    }
+
+    static void finish(Request& request)
+    {
+        if (request.stagingImage.isNull())
+        {
+            request.state = Request::State::failed;
+        }
+        else
+        {
+            if (request.options.uploadToNative)
+            {
+                request.image = juce::NativeImageType{}.convert(request.stagingImage);
+                request.stagingImage = {};
+            }
+            else
+            {
+                request.image = request.stagingImage;
+            }
+
+            request.state = Request::State::ready;
+        }
+
+        if (request.onReady != nullptr)
+        {
+            request.onReady();
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AsyncImageLoader)
+};
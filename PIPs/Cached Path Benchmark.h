@@ -0,0 +1,273 @@
+/*******************************************************************************
+ The block below describes the properties of this PIP. A PIP is a short snippet
+ of code that can be read by the Projucer and used to generate a JUCE project.
+
+ BEGIN_JUCE_PIP_METADATA
+
+  name:             Cached Path Benchmark
+
+  dependencies:     juce_core, juce_data_structures, juce_events, juce_graphics
+  exporters:        VS2022, linux_make
+
+  moduleFlags:      JUCE_STRICT_REFCOUNTEDPOINTER=1
+  defines:
+
+  type:             Console
+
+ END_JUCE_PIP_METADATA
+
+*******************************************************************************/
+
+#pragma once
+
+#include "PathOutlineCache.h"
+#include "WavyCirclePath.h"
+#include "CompactPath.h"
+
+//
+// Headless companion to the Cached Path Creation Test
+//
+// Sweeps the same path over segment count, original size, transform scale, and stroke thickness
+// for both fillPath and strokePath, rendering offscreen with the software renderer. Runs without a
+// display, so it works on a Linux build machine.
+//
+// Usage: CachedPathBenchmark [--json] [--iterations N] [--quick] [--output file]
+//
+// For each configuration it reports:
+//
+//  - createPathMs      building the Path
+//  - createOutlineMs   stroking the Path (zero for fills)
+//  - drawMs            rasterising the prepared Path or outline
+//  - totalMs           g.fillPath or g.strokePath from scratch, as the app would call it
+//  - decodeCompactMs   decoding the path from CompactPath storage
+//  - pathBytes, outlineBytes, compactBytes
+//
+class CachedPathBenchmark
+{
+public:
+    struct Options
+    {
+        bool json = false;
+        bool quick = false;
+        int iterations = 5;
+        juce::File outputFile;
+    };
+
+    explicit CachedPathBenchmark(Options options_) :
+        options(options_)
+    {
+    }
+
+    juce::String run()
+    {
+        juce::Array<int> const segmentCounts = options.quick ? juce::Array<int>{ 4, 1000, 100000 } : juce::Array<int>{ 4, 16, 100, 1000, 10000, 100000 };
+        juce::Array<float> const sizes = options.quick ? juce::Array<float>{ 500.0f } : juce::Array<float>{ 100.0f, 500.0f, 2000.0f };
+        juce::Array<float> const scales = options.quick ? juce::Array<float>{ 1.0f } : juce::Array<float>{ 0.1f, 1.0f, 10.0f };
+        juce::Array<float> const thicknesses = options.quick ? juce::Array<float>{ 1.0f, 50.0f } : juce::Array<float>{ 1.0f, 10.0f, 50.0f };
+
+        for (auto segmentCount : segmentCounts)
+        {
+            for (auto size : sizes)
+            {
+                for (auto scale : scales)
+                {
+                    results.add(measure({ "fillPath", segmentCount, size, scale, 0.0f }));
+
+                    for (auto thickness : thicknesses)
+                    {
+                        results.add(measure({ "strokePath", segmentCount, size, scale, thickness }));
+                    }
+                }
+            }
+        }
+
+        return options.json ? toJSON() : toCSV();
+    }
+
+private:
+    struct Configuration
+    {
+        juce::String mode;
+        int segmentCount;
+        float size;
+        float scale;
+        float strokeThickness;
+    };
+
+    struct Result
+    {
+        Configuration configuration;
+        double createPathMs = 0.0;
+        double createOutlineMs = 0.0;
+        double drawMs = 0.0;
+        double totalMs = 0.0;
+        size_t pathBytes = 0;
+        size_t outlineBytes = 0;
+        size_t compactBytes = 0;
+        double decodeCompactMs = 0.0;
+    };
+
+    static constexpr int imageSize = 1024;
+
+    Options const options;
+    juce::Array<Result> results;
+    juce::Image image{ juce::Image::ARGB, imageSize, imageSize, true, juce::SoftwareImageType{} };
+
+    template <typename Callback>
+    double timeMs(Callback&& callback) const
+    {
+        double total = 0.0;
+
+        for (int iteration = 0; iteration < options.iterations; ++iteration)
+        {
+            auto start = juce::Time::getHighResolutionTicks();
+            callback();
+            total += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        }
+
+        return total * 1000.0 / (double)options.iterations;
+    }
+
+    Result measure(Configuration const& configuration)
+    {
+        Result result;
+        result.configuration = configuration;
+
+        juce::Path path;
+        result.createPathMs = timeMs([&] { path = WavyCirclePath::create(configuration.size, configuration.segmentCount); });
+        result.pathBytes = PathOutlineCache::countPathBytes(path);
+
+        CompactPath compactPath;
+        if (compactPath.encode(path, 0.1f))
+        {
+            juce::Path decoded;
+            result.compactBytes = compactPath.getNumBytes();
+            result.decodeCompactMs = timeMs([&]
+                {
+                    decoded.clear();
+                    compactPath.decode(decoded);
+                });
+        }
+
+        auto transform = juce::AffineTransform::scale(configuration.scale).translated(imageSize * 0.5f, imageSize * 0.5f);
+        juce::Graphics g{ image };
+        g.setColour(juce::Colours::red);
+
+        if (configuration.mode == "strokePath")
+        {
+            juce::PathStrokeType strokeType{ configuration.strokeThickness, juce::PathStrokeType::curved, juce::PathStrokeType::rounded };
+
+            juce::Path outline;
+            result.createOutlineMs = timeMs([&] { strokeType.createStrokedPath(outline, path, transform); });
+            result.outlineBytes = PathOutlineCache::countPathBytes(outline);
+
+            result.drawMs = timeMs([&] { g.fillPath(outline); });
+            result.totalMs = timeMs([&] { g.strokePath(path, strokeType, transform); });
+        }
+        else
+        {
+            result.drawMs = timeMs([&] { g.fillPath(path, transform); });
+            result.totalMs = result.drawMs;
+        }
+
+        return result;
+    }
+
+    juce::String toCSV() const
+    {
+        juce::StringArray lines;
+        lines.add("mode,segments,size,scale,strokeThickness,createPathMs,createOutlineMs,drawMs,totalMs,decodeCompactMs,pathBytes,outlineBytes,compactBytes");
+
+        for (auto const& result : results)
+        {
+            auto const& configuration = result.configuration;
+            lines.add(configuration.mode
+                + "," + juce::String{ configuration.segmentCount }
+                + "," + juce::String{ configuration.size }
+                + "," + juce::String{ configuration.scale }
+                + "," + juce::String{ configuration.strokeThickness }
+                + "," + juce::String{ result.createPathMs, 4 }
+                + "," + juce::String{ result.createOutlineMs, 4 }
+                + "," + juce::String{ result.drawMs, 4 }
+                + "," + juce::String{ result.totalMs, 4 }
+                + "," + juce::String{ result.decodeCompactMs, 4 }
+                + "," + juce::String{ (juce::int64)result.pathBytes }
+                + "," + juce::String{ (juce::int64)result.outlineBytes }
+                + "," + juce::String{ (juce::int64)result.compactBytes });
+        }
+
+        return lines.joinIntoString("\n") + "\n";
+    }
+
+    juce::String toJSON() const
+    {
+        juce::Array<juce::var> rows;
+
+        for (auto const& result : results)
+        {
+            auto const& configuration = result.configuration;
+            auto row = new juce::DynamicObject{};
+            row->setProperty("mode", configuration.mode);
+            row->setProperty("segments", configuration.segmentCount);
+            row->setProperty("size", configuration.size);
+            row->setProperty("scale", configuration.scale);
+            row->setProperty("strokeThickness", configuration.strokeThickness);
+            row->setProperty("createPathMs", result.createPathMs);
+            row->setProperty("createOutlineMs", result.createOutlineMs);
+            row->setProperty("drawMs", result.drawMs);
+            row->setProperty("totalMs", result.totalMs);
+            row->setProperty("decodeCompactMs", result.decodeCompactMs);
+            row->setProperty("pathBytes", (juce::int64)result.pathBytes);
+            row->setProperty("outlineBytes", (juce::int64)result.outlineBytes);
+            row->setProperty("compactBytes", (juce::int64)result.compactBytes);
+            rows.add(juce::var{ row });
+        }
+
+        auto root = new juce::DynamicObject{};
+        root->setProperty("benchmark", "CachedPathBenchmark");
+        root->setProperty("juceVersion", juce::SystemStats::getJUCEVersion());
+        root->setProperty("operatingSystem", juce::SystemStats::getOperatingSystemName());
+        root->setProperty("cpu", juce::SystemStats::getCpuModel());
+        root->setProperty("iterations", options.iterations);
+        root->setProperty("results", rows);
+
+        return juce::JSON::toString(juce::var{ root });
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CachedPathBenchmark)
+};
+
+int main(int argc, char* argv[])
+{
+    CachedPathBenchmark::Options options;
+    juce::StringArray args{ argv + 1, argc - 1 };
+
+    for (int index = 0; index < args.size(); ++index)
+    {
+        if (args[index] == "--json")
+            options.json = true;
+        else if (args[index] == "--quick")
+            options.quick = true;
+        else if (args[index] == "--iterations")
+            options.iterations = juce::jmax(1, args[++index].getIntValue());
+        else if (args[index] == "--output")
+            options.outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++index]);
+    }
+
+    CachedPathBenchmark benchmark{ options };
+    auto report = benchmark.run();
+
+    if (options.outputFile != juce::File{})
+    {
+        if (! options.outputFile.replaceWithText(report))
+        {
+            std::cerr << "Couldn't write " << options.outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    std::cout << report;
+    return 0;
+}
@@ -0,0 +1,328 @@
+#pragma once
+
+//
+// Compact, quantised storage for large Paths
+//
+// juce::Path stores a marker float plus two floats per point, so a lineTo costs 12 bytes. CompactPath
+// stores one verb byte per element and each point as a pair of 16-bit fixed-point deltas relative to
+// the previous point, quantised to 1/65535 of the larger side of the path's bounds. A lineTo costs
+// 5 bytes.
+//
+// encode() refuses paths that can't be quantised within the requested tolerance. decode() rebuilds a
+// complete juce::Path from the compact form, applying an optional transform on the way, so the saving
+// is in what's kept between draws; the renderer still needs the full Path while drawing it.
+// writeToStream() and readFromStream() use a little-endian binary format.
+//
+class CompactPath
+{
+public:
+    CompactPath() = default;
+    ~CompactPath() = default;
+
+    enum Verb : juce::uint8
+    {
+        startNewSubPath,
+        lineTo,
+        quadraticTo,
+        cubicTo,
+        closePath
+    };
+
+    //
+    // Returns false, leaving the CompactPath empty, if the quantisation step would put points further
+    // than tolerance from where they started
+    //
+    bool encode(juce::Path const& source, float tolerance)
+    {
+        clear();
+
+        auto bounds = source.getBounds();
+        auto step = juce::jmax(bounds.getWidth(), bounds.getHeight()) / (float)maxQuantised;
+
+        //
+        // Rounding moves each coordinate by up to half a step, so a point by up to half a step diagonally
+        //
+        auto maxError = step * 0.5f * juce::MathConstants<float>::sqrt2;
+        if (maxError > tolerance)
+        {
+            return false;
+        }
+
+        origin = bounds.getTopLeft();
+        quantisationStep = step > 0.0f ? step : 1.0f;
+        nonZeroWinding = source.isUsingNonZeroWinding();
+
+        juce::Point<int> previous;
+        auto addPoint = [&](float x, float y)
+            {
+                juce::Point<int> quantised{ quantise(x - origin.x), quantise(y - origin.y) };
+
+                //
+                // Deltas wrap around in 16 bits, so any delta fits and decoding by wrapping addition is exact
+                //
+                deltas.push_back((juce::int16)(juce::uint16)(quantised.x - previous.x));
+                deltas.push_back((juce::int16)(juce::uint16)(quantised.y - previous.y));
+                previous = quantised;
+            };
+
+        juce::Path::Iterator it{ source };
+        while (it.next())
+        {
+            switch (it.elementType)
+            {
+            case juce::Path::Iterator::startNewSubPath:
+                verbs.push_back(Verb::startNewSubPath);
+                addPoint(it.x1, it.y1);
+                break;
+
+            case juce::Path::Iterator::lineTo:
+                verbs.push_back(Verb::lineTo);
+                addPoint(it.x1, it.y1);
+                break;
+
+            case juce::Path::Iterator::quadraticTo:
+                verbs.push_back(Verb::quadraticTo);
+                addPoint(it.x1, it.y1);
+                addPoint(it.x2, it.y2);
+                break;
+
+            case juce::Path::Iterator::cubicTo:
+                verbs.push_back(Verb::cubicTo);
+                addPoint(it.x1, it.y1);
+                addPoint(it.x2, it.y2);
+                addPoint(it.x3, it.y3);
+                break;
+
+            case juce::Path::Iterator::closePath:
+                verbs.push_back(Verb::closePath);
+                break;
+            }
+        }
+
+        verbs.shrink_to_fit();
+        deltas.shrink_to_fit();
+        return true;
+    }
+
+    void clear()
+    {
+        verbs.clear();
+        deltas.clear();
+    }
+
+    bool isEmpty() const noexcept { return verbs.empty(); }
+
+    size_t getNumBytes() const noexcept
+    {
+        return verbs.size() * sizeof(Verb) + deltas.size() * sizeof(juce::int16);
+    }
+
+    float getMaximumError() const noexcept
+    {
+        return quantisationStep * 0.5f * juce::MathConstants<float>::sqrt2;
+    }
+
+    //
+    // Walks the elements without building a Path, in the style of Path::Iterator
+    //
+    class Iterator
+    {
+    public:
+        explicit Iterator(CompactPath const& path_) :
+            path(path_)
+        {
+        }
+
+        bool next() noexcept
+        {
+            if (verbIndex >= path.verbs.size())
+            {
+                return false;
+            }
+
+            elementType = path.verbs[verbIndex++];
+
+            switch (elementType)
+            {
+            case Verb::startNewSubPath:
+            case Verb::lineTo:
+                readPoint(x1, y1);
+                break;
+
+            case Verb::quadraticTo:
+                readPoint(x1, y1);
+                readPoint(x2, y2);
+                break;
+
+            case Verb::cubicTo:
+                readPoint(x1, y1);
+                readPoint(x2, y2);
+                readPoint(x3, y3);
+                break;
+
+            case Verb::closePath:
+                break;
+            }
+
+            return true;
+        }
+
+        Verb elementType = Verb::startNewSubPath;
+        float x1 = 0.0f, y1 = 0.0f, x2 = 0.0f, y2 = 0.0f, x3 = 0.0f, y3 = 0.0f;
+
+    private:
+        CompactPath const& path;
+        size_t verbIndex = 0;
+        size_t deltaIndex = 0;
+        juce::uint16 quantisedX = 0, quantisedY = 0;
+
+        void readPoint(float& x, float& y) noexcept
+        {
+            quantisedX = (juce::uint16)(quantisedX + (juce::uint16)path.deltas[deltaIndex++]);
+            quantisedY = (juce::uint16)(quantisedY + (juce::uint16)path.deltas[deltaIndex++]);
+            x = path.origin.x + (float)quantisedX * path.quantisationStep;
+            y = path.origin.y + (float)quantisedY * path.quantisationStep;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE(Iterator)
+    };
+
+    //
+    // Appends the elements to dest, reserving space for them up front
+    //
+    void decode(juce::Path& dest, juce::AffineTransform const& transform = {}) const
+    {
+        dest.setUsingNonZeroWinding(nonZeroWinding);
+        dest.preallocateSpace((int)(verbs.size() + deltas.size() / 2 * 3));
+
+        Iterator it{ *this };
+        while (it.next())
+        {
+            if (! transform.isIdentity())
+            {
+                transform.transformPoints(it.x1, it.y1, it.x2, it.y2, it.x3, it.y3);
+            }
+
+            switch (it.elementType)
+            {
+            case Verb::startNewSubPath: dest.startNewSubPath(it.x1, it.y1); break;
+            case Verb::lineTo:          dest.lineTo(it.x1, it.y1); break;
+            case Verb::quadraticTo:     dest.quadraticTo(it.x1, it.y1, it.x2, it.y2); break;
+            case Verb::cubicTo:         dest.cubicTo(it.x1, it.y1, it.x2, it.y2, it.x3, it.y3); break;
+            case Verb::closePath:       dest.closeSubPath(); break;
+            }
+        }
+    }
+
+    //==============================================================================
+    void writeToStream(juce::OutputStream& stream) const
+    {
+        stream.writeInt(magic);
+        stream.writeInt(formatVersion);
+        stream.writeFloat(origin.x);
+        stream.writeFloat(origin.y);
+        stream.writeFloat(quantisationStep);
+        stream.writeBool(nonZeroWinding);
+        stream.writeInt64((juce::int64)verbs.size());
+        stream.writeInt64((juce::int64)deltas.size());
+        stream.write(verbs.data(), verbs.size());
+
+        for (auto delta : deltas)
+        {
+            stream.writeShort(delta);
+        }
+    }
+
+    //
+    // When the stream can't say how long it is, the counts in the header can't be checked against it, so
+    // they're capped instead to keep a corrupt header from asking for a huge allocation
+    //
+    static constexpr juce::int64 maxCountForUnknownLength = 1 << 26;
+
+    bool readFromStream(juce::InputStream& stream)
+    {
+        clear();
+
+        if (stream.readInt() != magic || stream.readInt() != formatVersion)
+        {
+            return false;
+        }
+
+        origin.x = stream.readFloat();
+        origin.y = stream.readFloat();
+        quantisationStep = stream.readFloat();
+        nonZeroWinding = stream.readBool();
+
+        auto numVerbs = stream.readInt64();
+        auto numDeltas = stream.readInt64();
+        auto remaining = stream.getNumBytesRemaining();
+        auto maxCount = remaining >= 0 ? (juce::int64)std::numeric_limits<int>::max() : maxCountForUnknownLength;
+        if (numVerbs < 0 || numDeltas < 0 || numVerbs > maxCount || numDeltas > maxCount
+            || (remaining >= 0 && numVerbs + numDeltas * 2 > remaining))
+        {
+            return false;
+        }
+
+        verbs.resize((size_t)numVerbs);
+        if (stream.read(verbs.data(), (int)numVerbs) != (int)numVerbs)
+        {
+            clear();
+            return false;
+        }
+
+        deltas.resize((size_t)numDeltas);
+        for (auto& delta : deltas)
+        {
+            delta = stream.readShort();
+        }
+
+        if (! isConsistent())
+        {
+            clear();
+            return false;
+        }
+
+        return true;
+    }
+
+private:
+    static constexpr int maxQuantised = 65535;
+    static constexpr int magic = 0x48544150; // "PATH"
+    static constexpr int formatVersion = 1;
+
+    std::vector<Verb> verbs;
+    std::vector<juce::int16> deltas;
+    juce::Point<float> origin;
+    float quantisationStep = 1.0f;
+    bool nonZeroWinding = true;
+
+    int quantise(float offset) const noexcept
+    {
+        return juce::jlimit(0, maxQuantised, juce::roundToInt(offset / quantisationStep));
+    }
+
+    //
+    // Checks a stream's verbs match the number of points it carries, so the iterator can't overrun
+    //
+    bool isConsistent() const noexcept
+    {
+        size_t numPoints = 0;
+
+        for (auto verb : verbs)
+        {
+            switch (verb)
+            {
+            case Verb::startNewSubPath:
+            case Verb::lineTo:      numPoints += 1; break;
+            case Verb::quadraticTo: numPoints += 2; break;
+            case Verb::cubicTo:     numPoints += 3; break;
+            case Verb::closePath:   break;
+            default:                return false;
+            }
+        }
+
+        return numPoints * 2 == deltas.size();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CompactPath)
+};
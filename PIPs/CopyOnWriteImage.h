@@ -0,0 +1,293 @@
+#pragma once
+
+//
+// Software images whose copies and clipped views share pixel storage until they're written to
+//
+// Image::createCopy() and copying a clipped image both duplicate the whole pixel buffer up front. A
+// CopyOnWriteImage copy or view is just a reference to the parent's storage plus an area. Taking a
+// writable BitmapData copies only the rows it covers into the view's own buffer; a BitmapData for a
+// single row copies a single row. Once every row of a view has been copied, the view owns that buffer
+// as its storage, and an image that's the only user of its storage is written in place.
+//
+// Reads never copy, except when a read spans rows that have already been copied and rows that haven't;
+// BitmapData needs evenly spaced rows, so the rest of the range is copied to line them up.
+//
+// Copies, bytes copied and views shared are counted across all images for the metrics display. The
+// images are meant to be used from one thread at a time, like any other Image.
+//
+class CopyOnWriteImage
+{
+public:
+    static juce::Image create(juce::Image::PixelFormat format, int width, int height, bool clearImage)
+    {
+        return juce::Image{ new PixelData{ new Storage{ format, width, height, clearImage }, { width, height } } };
+    }
+
+    //
+    // Copies any image into copy-on-write storage; this is the one full copy
+    //
+    static juce::Image adopt(juce::Image const& source)
+    {
+        if (source.isNull())
+        {
+            return {};
+        }
+
+        if (dynamic_cast<PixelData*>(source.getPixelData()) != nullptr)
+        {
+            return source.createCopy();
+        }
+
+        auto image = create(source.getFormat(), source.getWidth(), source.getHeight(), false);
+
+        {
+            juce::Image::BitmapData sourceData{ source, juce::Image::BitmapData::readOnly };
+            juce::Image::BitmapData destData{ image, juce::Image::BitmapData::writeOnly };
+
+            auto rowBytes = (size_t)(source.getWidth() * destData.pixelStride);
+            for (int y = 0; y < source.getHeight(); ++y)
+            {
+                std::memcpy(destData.getLinePointer(y), sourceData.getLinePointer(y), rowBytes);
+            }
+
+            addCopy(source.getHeight(), rowBytes * (size_t)source.getHeight());
+        }
+
+        return image;
+    }
+
+    //
+    // A zero-copy view of part of a copy-on-write image; unlike Image::getClippedImage, writing to the
+    // view doesn't change the source, or the other way round
+    //
+    static juce::Image getClippedImage(juce::Image const& source, juce::Rectangle<int> area)
+    {
+        if (auto pixelData = dynamic_cast<PixelData*>(source.getPixelData()))
+        {
+            return juce::Image{ pixelData->createView(area.getIntersection(source.getBounds())) };
+        }
+
+        return source.getClippedImage(area);
+    }
+
+    struct Metrics
+    {
+        juce::int64 numCopies = 0;
+        juce::int64 numRowsCopied = 0;
+        juce::int64 numBytesCopied = 0;
+        juce::int64 numViewsShared = 0;
+    };
+
+    static Metrics getMetrics() noexcept
+    {
+        return { numCopies.load(), numRowsCopied.load(), numBytesCopied.load(), numViewsShared.load() };
+    }
+
+    static void resetMetrics() noexcept
+    {
+        numCopies = 0;
+        numRowsCopied = 0;
+        numBytesCopied = 0;
+        numViewsShared = 0;
+    }
+
+    class Type : public juce::ImageType
+    {
+    public:
+        juce::ImagePixelData::Ptr create(juce::Image::PixelFormat format, int width, int height, bool shouldClearImage) const override
+        {
+            return CopyOnWriteImage::create(format, width, height, shouldClearImage).getPixelData();
+        }
+
+        int getTypeID() const override
+        {
+            return 0x434f5749; // "COWI"
+        }
+    };
+
+private:
+    static inline std::atomic<juce::int64> numCopies{ 0 };
+    static inline std::atomic<juce::int64> numRowsCopied{ 0 };
+    static inline std::atomic<juce::int64> numBytesCopied{ 0 };
+    static inline std::atomic<juce::int64> numViewsShared{ 0 };
+
+    static void addCopy(int numRows, size_t numBytes) noexcept
+    {
+        ++numCopies;
+        numRowsCopied += numRows;
+        numBytesCopied += (juce::int64)numBytes;
+    }
+
+    static int getPixelStride(juce::Image::PixelFormat format) noexcept
+    {
+        return format == juce::Image::RGB ? 3 : (format == juce::Image::ARGB ? 4 : 1);
+    }
+
+    struct Storage : public juce::ReferenceCountedObject
+    {
+        using Ptr = juce::ReferenceCountedObjectPtr<Storage>;
+
+        Storage(juce::Image::PixelFormat format_, int width, int height, bool clearImage) :
+            format(format_),
+            lineStride((width * getPixelStride(format_) + 3) & ~3)
+        {
+            pixels.allocate((size_t)lineStride * (size_t)height, clearImage);
+        }
+
+        Storage(juce::Image::PixelFormat format_, juce::HeapBlock<juce::uint8>& pixels_, int lineStride_) :
+            format(format_),
+            lineStride(lineStride_)
+        {
+            pixels.swapWith(pixels_);
+        }
+
+        juce::Image::PixelFormat const format;
+        int const lineStride;
+        juce::HeapBlock<juce::uint8> pixels;
+    };
+
+    //==============================================================================
+    class PixelData : public juce::ImagePixelData
+    {
+    public:
+        PixelData(Storage::Ptr storage_, juce::Rectangle<int> area_) :
+            juce::ImagePixelData(storage_->format, area_.getWidth(), area_.getHeight()),
+            storage(storage_),
+            area(area_),
+            pixelStride(getPixelStride(pixelFormat)),
+            privateLineStride((width * pixelStride + 3) & ~3)
+        {
+        }
+
+        std::unique_ptr<juce::LowLevelGraphicsContext> createLowLevelContext() override
+        {
+            sendDataChangeMessage();
+            return std::make_unique<juce::LowLevelGraphicsSoftwareRenderer>(juce::Image{ *this });
+        }
+
+        void initialiseBitmapData(juce::Image::BitmapData& bitmap, int x, int y, juce::Image::BitmapData::ReadWriteMode mode) override
+        {
+            auto endRow = juce::jlimit(y + 1, height, y + bitmap.height);
+
+            if (mode != juce::Image::BitmapData::readOnly)
+            {
+                if (numPrivateRows > 0 || storage->getReferenceCount() > 1)
+                {
+                    makeRowsPrivate(y, endRow);
+                }
+
+                sendDataChangeMessage();
+            }
+            else if (numPrivateRows > 0 && ! areRowsUniform(y, endRow))
+            {
+                makeRowsPrivate(y, endRow);
+            }
+
+            auto usePrivateRows = numPrivateRows > 0 && rowIsPrivate[(size_t)y];
+            bitmap.lineStride = usePrivateRows ? privateLineStride : storage->lineStride;
+            bitmap.data = (usePrivateRows ? getPrivateRow(y) : getSharedRow(y)) + x * pixelStride;
+            bitmap.size = (size_t)(bitmap.lineStride * (height - y) - x * pixelStride);
+            bitmap.pixelFormat = pixelFormat;
+            bitmap.pixelStride = pixelStride;
+        }
+
+        juce::ImagePixelData::Ptr clone() override
+        {
+            return createView({ width, height });
+        }
+
+        std::unique_ptr<juce::ImageType> createType() const override
+        {
+            return std::make_unique<Type>();
+        }
+
+        //
+        // A view can only share storage that holds this image's current pixels, so any copied rows are
+        // finished off into this image's own storage first
+        //
+        juce::ImagePixelData::Ptr createView(juce::Rectangle<int> viewArea)
+        {
+            if (numPrivateRows > 0)
+            {
+                makeRowsPrivate(0, height);
+            }
+
+            ++numViewsShared;
+            return new PixelData{ storage, viewArea.translated(area.getX(), area.getY()) };
+        }
+
+    private:
+        Storage::Ptr storage;
+        juce::Rectangle<int> area;
+        int const pixelStride;
+        int const privateLineStride;
+
+        juce::HeapBlock<juce::uint8> privatePixels;
+        std::vector<bool> rowIsPrivate;
+        int numPrivateRows = 0;
+
+        juce::uint8* getSharedRow(int y) const noexcept
+        {
+            return storage->pixels + (size_t)(area.getY() + y) * (size_t)storage->lineStride + (size_t)(area.getX() * pixelStride);
+        }
+
+        juce::uint8* getPrivateRow(int y) const noexcept
+        {
+            return privatePixels + (size_t)y * (size_t)privateLineStride;
+        }
+
+        bool areRowsUniform(int startRow, int endRow) const noexcept
+        {
+            for (int y = startRow + 1; y < endRow; ++y)
+            {
+                if (rowIsPrivate[(size_t)y] != rowIsPrivate[(size_t)startRow])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        void makeRowsPrivate(int startRow, int endRow)
+        {
+            if (privatePixels == nullptr)
+            {
+                privatePixels.malloc((size_t)privateLineStride * (size_t)height);
+                rowIsPrivate.assign((size_t)height, false);
+            }
+
+            auto rowBytes = (size_t)(width * pixelStride);
+            int numCopied = 0;
+
+            for (int y = startRow; y < endRow; ++y)
+            {
+                if (! rowIsPrivate[(size_t)y])
+                {
+                    std::memcpy(getPrivateRow(y), getSharedRow(y), rowBytes);
+                    rowIsPrivate[(size_t)y] = true;
+                    ++numCopied;
+                }
+            }
+
+            if (numCopied > 0)
+            {
+                numPrivateRows += numCopied;
+                addCopy(numCopied, rowBytes * (size_t)numCopied);
+            }
+
+            //
+            // Every row is private now, so the private buffer becomes this image's own storage
+            //
+            if (numPrivateRows == height)
+            {
+                storage = new Storage{ pixelFormat, privatePixels, privateLineStride };
+                area = { width, height };
+                rowIsPrivate.clear();
+                numPrivateRows = 0;
+            }
+        }
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PixelData)
+    };
+};
@@ -0,0 +1,258 @@
+#pragma once
+
+//
+// Records draws into an image and plays them back in batches
+//
+// The software renderer rasterises every Graphics call as it's made, so a hundred filled shapes means
+// a hundred edge tables and a hundred passes over the image. DeferredGraphics records the calls instead.
+// On flush(), or when it goes out of scope, it plays them back with compatible draws merged:
+//
+//  shapes with the same fill and winding rule become one path, or one rectangle list if they're all
+//  rectangles, and are filled in one call
+//
+//  draws of the same image run back to back, so the source stays in cache
+//
+// A draw can only join an earlier batch if it doesn't overlap anything in that batch or in any batch
+// recorded after it. Overlap is tested on whole-pixel bounds, so merged shapes never share a pixel and
+// the result matches drawing them one at a time. Shapes with translucent fills that overlap each other
+// are still drawn separately, in order.
+//
+// There's no clip or transform state; this is meant for composing offscreen images, not for paint().
+//
+class DeferredGraphics
+{
+public:
+    explicit DeferredGraphics(juce::Image& target_) :
+        target(target_)
+    {
+    }
+
+    ~DeferredGraphics()
+    {
+        flush();
+    }
+
+    void setColour(juce::Colour colour)
+    {
+        fill = juce::FillType{ colour };
+    }
+
+    void setFillType(juce::FillType const& newFill)
+    {
+        fill = newFill;
+    }
+
+    void setImageResamplingQuality(juce::Graphics::ResamplingQuality newQuality)
+    {
+        quality = newQuality;
+    }
+
+    void fillRect(juce::Rectangle<float> area)
+    {
+        recordShape(area, true, [&](Batch& batch)
+            {
+                batch.rectangles.add(area);
+                batch.path.addRectangle(area);
+            });
+    }
+
+    void fillEllipse(juce::Rectangle<float> area)
+    {
+        recordShape(area, true, [&](Batch& batch)
+            {
+                batch.allRectangles = false;
+                batch.path.addEllipse(area);
+            });
+    }
+
+    void fillEllipse(float x, float y, float width, float height)
+    {
+        fillEllipse({ x, y, width, height });
+    }
+
+    void drawEllipse(juce::Rectangle<float> area, float lineThickness)
+    {
+        juce::Path ellipse;
+        ellipse.addEllipse(area);
+        strokePath(ellipse, juce::PathStrokeType{ lineThickness });
+    }
+
+    void fillPath(juce::Path const& path, juce::AffineTransform const& transform = {})
+    {
+        recordShape(path.getBoundsTransformed(transform), path.isUsingNonZeroWinding(), [&](Batch& batch)
+            {
+                batch.allRectangles = false;
+                batch.path.addPath(path, transform);
+            });
+    }
+
+    void strokePath(juce::Path const& path, juce::PathStrokeType const& strokeType, juce::AffineTransform const& transform = {})
+    {
+        juce::Path stroke;
+        strokeType.createStrokedPath(stroke, path, transform);
+        fillPath(stroke);
+    }
+
+    void drawImageAt(juce::Image const& image, int x, int y)
+    {
+        drawImageTransformed(image, juce::AffineTransform::translation((float)x, (float)y));
+    }
+
+    void drawImageTransformed(juce::Image const& image, juce::AffineTransform const& transform)
+    {
+        if (image.isNull())
+        {
+            return;
+        }
+
+        auto area = image.getBounds().toFloat().transformedBy(transform).getSmallestIntegerContainer().expanded(1);
+        record(area, [&](Batch const& batch) { return batch.image.getPixelData() == image.getPixelData() && batch.quality == quality; },
+            [&]()
+            {
+                Batch batch;
+                batch.image = image;
+                batch.quality = quality;
+                return batch;
+            },
+            [&](Batch& batch)
+            {
+                batch.imageTransforms.push_back(transform);
+            });
+    }
+
+    //
+    // Plays back everything recorded so far
+    //
+    void flush()
+    {
+        if (batches.empty())
+        {
+            return;
+        }
+
+        juce::Graphics g{ target };
+
+        for (auto const& batch : batches)
+        {
+            if (! batch.image.isNull())
+            {
+                g.setImageResamplingQuality(batch.quality);
+
+                for (auto const& transform : batch.imageTransforms)
+                {
+                    g.drawImageTransformed(batch.image, transform);
+                }
+            }
+            else
+            {
+                g.setFillType(batch.fill);
+
+                if (batch.allRectangles)
+                {
+                    g.fillRectList(batch.rectangles);
+                }
+                else
+                {
+                    g.fillPath(batch.path);
+                }
+            }
+        }
+
+        numBatchesPlayed += (int)batches.size();
+        batches.clear();
+    }
+
+    int getNumDrawsRecorded() const noexcept { return numDrawsRecorded; }
+    int getNumBatchesPlayed() const noexcept { return numBatchesPlayed; }
+
+private:
+    juce::Image& target;
+    juce::FillType fill{ juce::Colours::black };
+    juce::Graphics::ResamplingQuality quality = juce::Graphics::mediumResamplingQuality;
+
+    struct Batch
+    {
+        juce::FillType fill;
+        bool nonZeroWinding = true;
+        bool allRectangles = true;
+        juce::Path path;
+        juce::RectangleList<float> rectangles;
+
+        juce::Image image;
+        juce::Graphics::ResamplingQuality quality = juce::Graphics::mediumResamplingQuality;
+        std::vector<juce::AffineTransform> imageTransforms;
+
+        juce::Rectangle<int> bounds;
+        std::vector<juce::Rectangle<int>> areas;
+
+        bool overlaps(juce::Rectangle<int> area) const
+        {
+            if (! bounds.intersects(area))
+            {
+                return false;
+            }
+
+            return std::any_of(areas.begin(), areas.end(), [&](auto const& existing) { return existing.intersects(area); });
+        }
+    };
+
+    std::vector<Batch> batches;
+    int numDrawsRecorded = 0;
+    int numBatchesPlayed = 0;
+
+    //
+    // How far back a draw looks for a batch to join; keeps recording linear for long runs of unrelated draws
+    //
+    static constexpr int maxBatchesToSearch = 32;
+
+    template <typename AppendFunction>
+    void recordShape(juce::Rectangle<float> shapeBounds, bool nonZeroWinding, AppendFunction&& append)
+    {
+        record(shapeBounds.getSmallestIntegerContainer().expanded(1),
+            [&](Batch const& batch) { return batch.image.isNull() && batch.fill == fill && batch.nonZeroWinding == nonZeroWinding; },
+            [&]()
+            {
+                Batch batch;
+                batch.fill = fill;
+                batch.nonZeroWinding = nonZeroWinding;
+                batch.path.setUsingNonZeroWinding(nonZeroWinding);
+                return batch;
+            },
+            append);
+    }
+
+    template <typename MatchFunction, typename CreateFunction, typename AppendFunction>
+    void record(juce::Rectangle<int> area, MatchFunction&& matches, CreateFunction&& create, AppendFunction&& append)
+    {
+        ++numDrawsRecorded;
+
+        auto numSearched = 0;
+        for (auto batch = batches.rbegin(); batch != batches.rend() && numSearched < maxBatchesToSearch; ++batch, ++numSearched)
+        {
+            auto overlaps = batch->overlaps(area);
+            if (! overlaps && matches(*batch))
+            {
+                addToBatch(*batch, area, append);
+                return;
+            }
+
+            if (overlaps)
+            {
+                break;
+            }
+        }
+
+        batches.push_back(create());
+        addToBatch(batches.back(), area, append);
+    }
+
+    template <typename AppendFunction>
+    static void addToBatch(Batch& batch, juce::Rectangle<int> area, AppendFunction&& append)
+    {
+        append(batch);
+        batch.bounds = batch.areas.empty() ? area : batch.bounds.getUnion(area);
+        batch.areas.push_back(area);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeferredGraphics)
+};
@@ -21,6 +21,9 @@
 
 #pragma once
 
+#include "ImageBudget.h"
+#include "PixelBufferPool.h"
+
 class BrushTest : public juce::Component, public juce::ImagePixelData::Listener
 {
 public:
@@ -113,6 +116,8 @@ public:
         // Check if the cachedImage is still valid; if it's not valid, then the Direct2D bitmap is no longer
         // cached on the GPU and the image data is gone.
         //
+        auto softwareImage = softwareImageHandle.get();
+        auto direct2DImage = direct2DImageHandle.get();
         if (softwareImage.isNull() || direct2DImage.isNull())
         {
             return;
@@ -244,8 +249,12 @@ private:
     //
     // Drawing a cached image is much faster than drawing a non-cached image.
     //
-    juce::Image softwareImage;
-    juce::Image direct2DImage;
+    // The images here are owned by the shared image budget, which repaints them through the callbacks
+    // set up in createCachedImages if they're evicted or the device is lost
+    //
+    juce::SharedResourcePointer<ImageBudget> imageBudget;
+    ImageBudget::Handle softwareImageHandle;
+    ImageBudget::Handle direct2DImageHandle;
 
     void paintImage(Image& image)
     {
@@ -371,11 +380,19 @@ private:
 
     void createCachedImages()
     {
-        softwareImage = Image{ Image::ARGB, getWidth() / 2, getHeight(), true, SoftwareImageType{} };
-        paintImage(softwareImage);
+        softwareImageHandle = imageBudget->add([this]
+            {
+                auto image = Image{ Image::ARGB, getWidth() / 2, getHeight(), true, PixelBufferPool::Type{} };
+                paintImage(image);
+                return image;
+            });
 
-        direct2DImage = Image{ Image::ARGB, getWidth() / 2, getHeight(), true, NativeImageType{} };
-        paintImage(direct2DImage);
+        direct2DImageHandle = imageBudget->add([this]
+            {
+                auto image = Image{ Image::ARGB, getWidth() / 2, getHeight(), true, NativeImageType{} };
+                paintImage(image);
+                return image;
+            });
     }
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BrushTest)
@@ -21,6 +21,12 @@
 
 #pragma once
 
+#include "StatTable.h"
+#include "PathOutlineCache.h"
+#include "PathLevelOfDetail.h"
+#include "WavyCirclePath.h"
+#include "CompactPath.h"
+
 class CachedPathCreationTest : public juce::Component
 {
 public:
@@ -78,6 +84,34 @@ public:
                 repaint();
             };
 
+        addAndMakeVisible(outlineCacheToggle);
+        outlineCacheToggle.onClick = [this]()
+            {
+                outlineCache.clear();
+                repaint();
+            };
+
+        addAndMakeVisible(lodToggle);
+        lodToggle.onClick = [this] { createPath(); };
+
+        addAndMakeVisible(compactPathToggle);
+        compactPathToggle.onClick = [this] { createPath(); };
+
+        addAndMakeVisible(parallelStrokeToggle);
+        parallelStrokeToggle.onClick = [this]()
+            {
+                outlineCache.setParallelStroker(parallelStrokeToggle.getToggleState() ? &parallelStroker : nullptr);
+                repaint();
+            };
+
+        statTable.addAccumulator("Parallel stroke (ms)", parallelStroker.strokeTime);
+        statTable.addAccumulator("Compact size (% of Path)", compactPathSize);
+        statTable.addAccumulator("Compact decode (ms)", compactDecodeTime);
+        statTable.addAccumulator("LOD points drawn", levelOfDetail.pointsDrawn);
+        statTable.addAccumulator("Outline cache hits (%)", outlineCache.outlineHitRate);
+        statTable.addAccumulator("Mask cache hits (%)", outlineCache.maskHitRate);
+        statTable.addAccumulator("Create outline (ms)", outlineCache.createOutlineTime);
+
         addAndMakeVisible(direct2DToggle);
         direct2DToggle.onClick = [this]()
             {
@@ -109,8 +143,16 @@ public:
             strokeThicknessLabel.setBounds(r.withWidth(120));
             strokeThicknessSlider.setBounds(r.withX(strokeThicknessLabel.getRight()).withWidth(getWidth() - strokeThicknessLabel.getRight()));
 
-            r.translate(0, 30);
-            cacheToggle.setBounds(strokeThicknessSlider.getX(), r.getY(), 120, 30);
+            juce::Rectangle<int> toggleArea{ r.getX(), r.getBottom(), getWidth() - r.getX(), 90 };
+            auto toggleRow = toggleArea.removeFromTop(30);
+            cacheToggle.setBounds(toggleRow.removeFromLeft(120));
+            outlineCacheToggle.setBounds(toggleRow);
+
+            toggleRow = toggleArea.removeFromTop(30);
+            lodToggle.setBounds(toggleRow.removeFromLeft(120));
+            parallelStrokeToggle.setBounds(toggleRow);
+
+            compactPathToggle.setBounds(toggleArea.removeFromLeft(120));
         }
 
         transformScaleLabel.setBounds(0, getHeight() - 30, 50, 30);
@@ -119,6 +161,8 @@ public:
 
         direct2DToggle.setBounds(getWidth() / 2 - 60, 10, 120, 30);
 
+        statTable.setTopLeftPosition(getScreenPosition().translated(getWidth() - statTable.getWidth() - 5, getHeight() - statTable.getHeight() - 40));
+
         createPath();
     }
 
@@ -133,12 +177,21 @@ public:
         auto xScale = (float)xScaleSlider.getValue();
         auto yScale = (float)yScaleSlider.getValue();
         auto transform = juce::AffineTransform::scale(xScale, yScale).translated(getWidth() * 0.5f, getHeight() * 0.5f);
+
+        //
+        // When zoomed out, draw the coarsest simplified version of the path that's still within half a pixel
+        //
+        auto const& drawPath = lodToggle.getToggleState() ? levelOfDetail.select(path, g, transform) : path;
+
         switch (modeCombo.getSelectedId())
         {
         case Mode::fillPath:
         {
             g.setColour(juce::Colours::orchid);
-            g.fillPath(path, transform);
+            if (outlineCacheToggle.getToggleState())
+                outlineCache.fillPath(g, drawPath, pathVersion, transform);
+            else
+                g.fillPath(drawPath, transform);
             break;
         }
 
@@ -146,7 +199,20 @@ public:
         {
             auto strokeType = createStrokeType();
             g.setColour(juce::Colours::red);
-            g.strokePath(path, strokeType, transform);
+            if (outlineCacheToggle.getToggleState())
+            {
+                outlineCache.strokePath(g, drawPath, pathVersion, strokeType, transform);
+            }
+            else if (parallelStrokeToggle.getToggleState())
+            {
+                juce::Path stroke;
+                parallelStroker.createStrokedPath(stroke, drawPath, strokeType, transform, g.getInternalContext().getPhysicalPixelScaleFactor());
+                g.fillPath(stroke);
+            }
+            else
+            {
+                g.strokePath(drawPath, strokeType, transform);
+            }
             break;
         }
         }
@@ -162,6 +228,13 @@ public:
         if (auto peer = getPeer())
         {
             direct2DToggle.setToggleState(peer->getCurrentRenderingEngine() > 0, dontSendNotification);
+
+            statTable.addToDesktop(0, nullptr);
+            statTable.setAlwaysOnTop(true);
+        }
+        else
+        {
+            statTable.removeFromDesktop();
         }
     }
 
@@ -184,6 +257,10 @@ private:
     juce::Slider yScaleSlider{ juce::Slider::LinearVertical, juce::Slider::TextBoxBelow };
     juce::ToggleButton cacheToggle{ "Cached" };
     juce::ToggleButton direct2DToggle{ "Direct2D" };
+    juce::ToggleButton outlineCacheToggle{ "Outline cache" };
+    juce::ToggleButton parallelStrokeToggle{ "Parallel stroke" };
+    juce::ToggleButton lodToggle{ "Level of detail" };
+    juce::ToggleButton compactPathToggle{ "Compact path" };
     juce::VBlankAttachment attachment{ this, [this]() { animate(); } };
     double lastMsec = juce::Time::getMillisecondCounterHiRes();
 
@@ -196,6 +273,7 @@ private:
     // Drawing a cached geometry realization is much faster than drawing a non-cached Path.
     //
     juce::Path path;
+    juce::uint64 pathVersion = 0;
     juce::Path strokedPath;
     juce::Path flattenedPath;
     juce::Rectangle<int> pathPaintArea;
@@ -207,28 +285,22 @@ private:
             return;
         }
 
-        path = {};
-        float size = (float)originalPathSizeSlider.getValue();
-        auto area = getLocalBounds().toFloat().withSizeKeepingCentre(size, size).withPosition(-size * 0.5f, -size * 0.5f);
+        path = WavyCirclePath::create((float)originalPathSizeSlider.getValue(), (int)pathSegmentCountSlider.getValue());
+        ++pathVersion;
 
-        int numCycles = 12;
-        float angle = 0.0f;
-        float angleStep = juce::MathConstants<float>::twoPi / (float)pathSegmentCountSlider.getValue();
-        float radius = area.getWidth() * 0.5f;
-        float amplitude = radius * 0.25f;
-        path.startNewSubPath(area.getCentreX(), area.getCentreY() - radius);
-        angle += angleStep;
-
-        while (angle < juce::MathConstants<float>::twoPi)
+        compactPath.clear();
+        if (compactPathToggle.getToggleState() && compactPath.encode(path, maxCompactPathError))
         {
-            auto distance = amplitude * std::sin(angle * (float)numCycles);
-            auto point = area.getCentre().getPointOnCircumference(distance + radius, angle);
-            path.lineTo(point);
-            angle += angleStep;
+            compactPathSize.addValue(100.0 * (double)compactPath.getNumBytes() / (double)PathOutlineCache::countPathBytes(path));
+            decodeCompactPath();
         }
-        path.closeSubPath();
 
-        cacheToggle.setToggleState(path.isCacheEnabled(), dontSendNotification);
+        path.setCacheEnabled(cacheToggle.getToggleState());
+
+        if (lodToggle.getToggleState())
+            levelOfDetail.build(path);
+        else
+            levelOfDetail.clear();
 
         repaint();
     }
@@ -240,6 +312,37 @@ private:
                 juce::PathStrokeType::EndCapStyle::rounded };
     }
 
+    PathLevelOfDetail levelOfDetail;
+
+    //
+    // With the compact path toggle on, the generated path is quantised and replaced by the path decoded
+    // from its compact form, once per createPath(), so what's drawn is the quantised geometry and the
+    // renderer can keep caching it between frames
+    //
+    static constexpr float maxCompactPathError = 0.1f;
+    CompactPath compactPath;
+    juce::StatisticsAccumulator<double> compactPathSize;
+    juce::StatisticsAccumulator<double> compactDecodeTime;
+
+    void decodeCompactPath()
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+
+        juce::Path decodedPath;
+        compactPath.decode(decodedPath);
+        path.swapWithPath(decodedPath);
+
+        compactDecodeTime.addValue(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0);
+    }
+
+    //
+    // The software renderer doesn't cache anything between frames, so keep the stroked outline
+    // and its coverage mask here instead
+    //
+    ParallelPathStroker parallelStroker;
+    PathOutlineCache outlineCache;
+    StatTable statTable{ this };
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CachedPathCreationTest)
 };
 
@@ -29,6 +29,7 @@
 
 #pragma once
 
+#include "MultichannelSpectrumAnalyser.h"
 
 //==============================================================================
 class Direct2DFFTDemo final : public AudioAppComponent
@@ -43,15 +44,42 @@ public:
     {
         setOpaque (true);
 
+        modeCombo.addItem ("Single channel", Mode::singleChannel);
+        modeCombo.addItem ("Multichannel", Mode::multichannel);
+        modeCombo.addItem ("Multichannel multi-resolution", Mode::multiResolution);
+        modeCombo.setSelectedId (Mode::singleChannel, dontSendNotification);
+        modeCombo.onChange = [this]
+        {
+            // the analyser isn't read in single-channel mode, so anything it's queued since is stale
+            analyser.reset();
+            resetDisplay();
+        };
+        addAndMakeVisible (modeCombo);
+
+        scaleCombo.addItem ("Linear (auto-scaled)", Scale::linear);
+        scaleCombo.addItem ("Decibels", Scale::decibels);
+        scaleCombo.setSelectedId (Scale::linear, dontSendNotification);
+        addAndMakeVisible (scaleCombo);
+
+        for (auto* toggle : { &smoothingToggle, &peakHoldToggle, &logFrequencyToggle })
+        {
+            toggle->onClick = [this] { resetDisplay(); };
+            addAndMakeVisible (toggle);
+        }
+
+        smoothingState.setSize (MultichannelSpectrumAnalyser::maxChannels, jmax (fftSize / 2 + 1, analyser.getNumBins (0)));
+        peakState.makeCopyOf (smoothingState);
+        resetDisplay();
+
        #ifndef JUCE_DEMO_RUNNER
         RuntimePermissions::request (RuntimePermissions::recordAudio,
                                      [this] (bool granted)
                                      {
-                                         int numInputChannels = granted ? 2 : 0;
+                                         int numInputChannels = granted ? MultichannelSpectrumAnalyser::maxChannels : 0;
                                          setAudioChannels (numInputChannels, 2);
                                      });
        #else
-        setAudioChannels (2, 2);
+        setAudioChannels (MultichannelSpectrumAnalyser::maxChannels, 2);
        #endif
 
         setSize (700, 500);
@@ -63,9 +91,9 @@ public:
     }
 
     //==============================================================================
-    void prepareToPlay (int /*samplesPerBlockExpected*/, double /*newSampleRate*/) override
+    void prepareToPlay (int /*samplesPerBlockExpected*/, double newSampleRate) override
     {
-        // (nothing to do here)
+        analyser.prepare (newSampleRate);
     }
 
     void releaseResources() override
@@ -82,6 +110,9 @@ public:
             for (auto i = 0; i < bufferToFill.numSamples; ++i)
                 pushNextSampleIntoFifo (channelData[i]);
 
+            // the multichannel analyser only copies the block here; its FFTs run on the message thread
+            analyser.pushBlock (*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+
             bufferToFill.clearActiveBufferRegion();
         }
     }
@@ -95,17 +126,52 @@ public:
         g.drawImage (spectrogramImage, getLocalBounds().toFloat());
     }
 
-#if 0
-    void timerCallback() override
+    void resized() override
     {
-        if (nextFFTBlockReady)
+        Rectangle<int> r { 10, 10, 250, 30 };
+        modeCombo.setBounds (r);
+
+        r.translate (0, 35);
+        scaleCombo.setBounds (r);
+
+        for (auto* toggle : { &smoothingToggle, &peakHoldToggle, &logFrequencyToggle })
         {
-            drawNextLineOfSpectrogram();
-            nextFFTBlockReady = false;
-            repaint();
+            r.translate (0, 35);
+            toggle->setBounds (r);
         }
     }
-#endif
+
+    void resetDisplay()
+    {
+        spectrogramImage.clear (spectrogramImage.getBounds());
+        smoothingState.clear();
+        peakState.clear();
+    }
+
+    void onVblank()
+    {
+        if (modeCombo.getSelectedId() == Mode::singleChannel)
+        {
+            if (nextFFTBlockReady)
+            {
+                drawNextLineOfSpectrogram();
+                nextFFTBlockReady = false;
+                repaint();
+            }
+
+            return;
+        }
+
+        bool frameReady = false;
+        while (analyser.processNextFrame())
+        {
+            drawNextMultichannelLineOfSpectrogram();
+            frameReady = true;
+        }
+
+        if (frameReady)
+            repaint();
+    }
 
     void pushNextSampleIntoFifo (float sample) noexcept
     {
@@ -134,20 +200,120 @@ public:
         // first, shuffle our image leftwards by 1 pixel..
         spectrogramImage.moveImageSection (0, 0, 1, 0, rightHandEdge, imageHeight);
 
-        // then render our FFT data..
-        forwardFFT.performFrequencyOnlyForwardTransform (fftData);
+        // then render our FFT data, converting the complex bins to magnitudes in place..
+        // windowed and scaled like the multichannel analyser, so a full-scale sine reads
+        // close to 0 dB rather than saturating the decibel scale
+        auto numBins = fftSize / 2 + 1;
+        window.multiplyWithWindowingTable (fftData, (size_t) fftSize);
+        forwardFFT.performRealOnlyForwardTransform (fftData, true);
+        SpectrumKernels::complexToMagnitude (fftData, fftData, numBins);
+        FloatVectorOperations::multiply (fftData, 4.0f / (float) fftSize, numBins);
+
+        auto bins = applyFrameProcessing (fftData, numBins, 0);
+        mapBinsToColumn (bins, numBins, imageHeight);
+        drawColumn (rightHandEdge, imageHeight - 1, imageHeight);
+    }
+
+    void drawNextMultichannelLineOfSpectrogram()
+    {
+        auto rightHandEdge = spectrogramImage.getWidth() - 1;
+        auto imageHeight   = spectrogramImage.getHeight();
+        auto numChannels   = analyser.getNumChannels();
+
+        spectrogramImage.moveImageSection (0, 0, 1, 0, rightHandEdge, imageHeight);
+
+        if (numChannels == 0)
+            return;
+
+        // each channel gets its own horizontal lane, lowest frequencies at the bottom
+        auto laneHeight = imageHeight / numChannels;
+
+        for (auto channel = 0; channel < numChannels; ++channel)
+        {
+            if (modeCombo.getSelectedId() == Mode::multiResolution)
+            {
+                // the multi-resolution spectrum is already on a log-frequency axis
+                column.resize ((size_t) laneHeight);
+                analyser.getMultiResolutionSpectrum (channel, column.data(), laneHeight);
+
+                auto points = applyFrameProcessing (column.data(), laneHeight, channel);
+                if (points != column.data())
+                    FloatVectorOperations::copy (column.data(), points, laneHeight);
+            }
+            else
+            {
+                auto numBins = analyser.getNumBins (0);
+                auto bins = applyFrameProcessing (analyser.getMagnitudes (0, channel), numBins, channel);
+                mapBinsToColumn (bins, numBins, laneHeight);
+            }
+
+            drawColumn (rightHandEdge, (channel + 1) * laneHeight - 1, laneHeight);
+        }
+    }
+
+    // runs the optional smoothing and peak-hold kernels, returning whichever buffer holds the result
+    const float* applyFrameProcessing (const float* bins, int numBins, int stateIndex)
+    {
+        auto result = bins;
+
+        if (smoothingToggle.getToggleState())
+        {
+            auto state = smoothingState.getWritePointer (stateIndex);
+            SpectrumKernels::smooth (state, result, 0.8f, numBins);
+            result = state;
+        }
+
+        if (peakHoldToggle.getToggleState())
+        {
+            auto peaks = peakState.getWritePointer (stateIndex);
+            SpectrumKernels::peakHold (peaks, result, 0.97f, numBins);
+            result = peaks;
+        }
+
+        return result;
+    }
 
-        // find the range of values produced, so we can scale our rendering to
-        // show up the detail clearly
-        auto maxLevel = FloatVectorOperations::findMinAndMax (fftData, fftSize / 2);
+    // fills column, bottom-up, with numPoints values taken from the FFT bins
+    void mapBinsToColumn (const float* bins, int numBins, int numPoints)
+    {
+        column.resize ((size_t) numPoints);
 
-        for (auto y = 1; y < imageHeight; ++y)
+        if (logFrequencyToggle.getToggleState())
         {
-            auto skewedProportionY = 1.0f - std::exp (std::log ((float) y / (float) imageHeight) * 0.2f);
-            auto fftDataIndex = jlimit (0, fftSize / 2, (int) (skewedProportionY * (int) fftSize / 2));
-            auto level = jmap (fftData[fftDataIndex], 0.0f, jmax (maxLevel.getEnd(), 1e-5f), 0.0f, 1.0f);
+            logFrequencyResampler.prepare (numBins, numPoints);
+            logFrequencyResampler.process (column.data(), bins);
+            return;
+        }
 
-            spectrogramImage.setPixelAt (rightHandEdge, y, Colour::fromHSV (level, 1.0f, level, 1.0f));
+        for (auto y = 0; y < numPoints; ++y)
+        {
+            auto skewedProportionY = 1.0f - std::exp (std::log ((float) (numPoints - y) / (float) numPoints) * 0.2f);
+            column[(size_t) y] = bins[jlimit (0, numBins - 1, (int) (skewedProportionY * (float) (numBins - 1)))];
+        }
+    }
+
+    void drawColumn (int x, int bottom, int height)
+    {
+        auto data = column.data();
+        auto minLevel = 0.0f, maxLevel = 1.0f;
+
+        if (scaleCombo.getSelectedId() == Scale::decibels)
+        {
+            SpectrumKernels::magnitudeToDecibels (data, data, height, floorDecibels);
+            minLevel = floorDecibels;
+            maxLevel = 0.0f;
+        }
+        else
+        {
+            // find the range of values produced, so we can scale our rendering to
+            // show up the detail clearly
+            maxLevel = jmax (FloatVectorOperations::findMaximum (data, height), 1e-5f);
+        }
+
+        for (auto y = 0; y < height; ++y)
+        {
+            auto level = jlimit (0.0f, 1.0f, jmap (data[y], minLevel, maxLevel, 0.0f, 1.0f));
+            spectrogramImage.setPixelAt (x, bottom - y, Colour::fromHSV (level, 1.0f, level, 1.0f));
         }
     }
 
@@ -158,7 +324,23 @@ public:
     };
 
 private:
+    enum Mode
+    {
+        singleChannel = 1,
+        multichannel,
+        multiResolution
+    };
+
+    enum Scale
+    {
+        linear = 1,
+        decibels
+    };
+
+    static constexpr float floorDecibels = -100.0f;
+
     dsp::FFT forwardFFT;
+    dsp::WindowingFunction<float> window { (size_t) fftSize, dsp::WindowingFunction<float>::hann, false };
     Image spectrogramImage;
 
     float fifo [fftSize];
@@ -166,5 +348,14 @@ private:
     int fifoIndex = 0;
     bool nextFFTBlockReady = false;
 
+    MultichannelSpectrumAnalyser analyser;
+    AudioBuffer<float> smoothingState, peakState;
+    SpectrumKernels::LogFrequencyResampler logFrequencyResampler;
+    std::vector<float> column;
+
+    ComboBox modeCombo, scaleCombo;
+    ToggleButton smoothingToggle { "Smoothing" }, peakHoldToggle { "Peak hold" }, logFrequencyToggle { "Log frequency" };
+    VBlankAttachment vblank { this, [this]() { onVblank(); } };
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Direct2DFFTDemo)
 };
@@ -21,6 +21,8 @@
 
 #pragma once
 
+#include "TextCache.h"
+
 class ComponentTransformAnimator
 {
 public:
@@ -134,13 +136,21 @@ private:
     {
         void resized() override
         {
-            path.clear();
+            //
+            // The unit star has an outer radius of 1, so it's built once and only scaled on each resize
+            //
+            auto numPoints = index + 2;
+            if (numPoints != unitStarPoints)
+            {
+                unitStar.clear();
+                unitStar.addStar({}, numPoints, 0.35f / 0.45f, 1.0f);
+                unitStarPoints = numPoints;
+            }
+
+            path = unitStar;
 
             auto r = getLocalBounds().toFloat();
-            path.addStar(r.getCentre(),
-                index + 2,
-                r.getWidth() * 0.35f,
-                r.getWidth() * 0.45f);
+            path.applyTransform(juce::AffineTransform::scale(r.getWidth() * 0.45f).translated(r.getCentre()));
         }
 
         void paint(juce::Graphics& g) override
@@ -149,11 +159,14 @@ private:
             g.fillPath(path);
 
             g.setColour(juce::Colours::black);
-            g.drawText(String{ index + 1 }, getLocalBounds(), juce::Justification::centred);
+            textCache->drawText(g, String{ index + 1 }, getLocalBounds(), juce::Justification::centred);
         }
 
         int index = -1;
         juce::Path path;
+        juce::Path unitStar;
+        int unitStarPoints = -1;
+        juce::SharedResourcePointer<TextCache> textCache;
 
         ComponentTransformAnimator animator{ *this };
     };
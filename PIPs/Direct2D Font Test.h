@@ -21,6 +21,10 @@
 
 #pragma once
 
+#include "StringWidthCache.h"
+#include "TextCache.h"
+#include "TypefaceWarmUp.h"
+
 class FontTest : public juce::Component, public juce::LookAndFeel_V4
 {
 public:
@@ -46,6 +50,14 @@ public:
             };
         addAndMakeVisible(direct2DToggle);
 
+        firstDrawButton.setEnabled(false);
+        firstDrawButton.onClick = [this]()
+            {
+                measureFirstDraw();
+                repaint();
+            };
+        addAndMakeVisible(firstDrawButton);
+
         setSize(512, 512);
     }
 
@@ -65,6 +77,7 @@ public:
         }
 
         direct2DToggle.setBounds(10, getHeight() - 40, 100, 30);
+        firstDrawButton.setBounds(direct2DToggle.getBounds().translated(direct2DToggle.getWidth() + 10, 0).withWidth(160));
     }
 
     void paint(juce::Graphics& g) override
@@ -75,36 +88,145 @@ public:
 
         auto paintText = [&](Typeface::Ptr typeface)
             {
-                auto font = juce::Font{ typeface }.withHeight(30.0f);
-                auto text = font.toString();
+                //
+                // Leave the row empty until the typeface has loaded
+                //
+                if (typeface != nullptr)
+                {
+                    auto font = juce::Font{ typeface }.withHeight(30.0f);
+                    auto text = font.toString();
 
-                auto width = font.getStringWidth(text);
-                r.setWidth(width);
+                    auto width = stringWidthCache->getStringWidth(font, text);
+                    r.setWidth(width);
 
-                g.setColour(juce::Colours::white);
-                g.drawText(text, r, juce::Justification::centred);
+                    g.setColour(juce::Colours::white);
+                    textCache->drawText(g, text, r, juce::Justification::centred);
 
-                g.setColour(juce::Colours::pink);
-                g.drawRect(r);
+                    g.setColour(juce::Colours::pink);
+                    g.drawRect(r);
+                }
 
                 r.translate(0, r.getHeight());
             };
 
         paintText(g.getCurrentFont().getTypefacePtr());
-        paintText(robotoTypeface);
-        paintText(openSansTypeface);
+        paintText(typefaceWarmUp.get(robotoTypeface));
+        paintText(typefaceWarmUp.get(openSansTypeface));
+
+        auto metrics = textCache->getMetrics();
+        auto warmUpMetrics = typefaceWarmUp.getMetrics();
+        g.setColour(juce::Colours::white);
+        g.setFont(14.0f);
+
+        juce::String warmUpText = "Warm-up: " + juce::String{ warmUpMetrics.numReady } + "/" + juce::String{ warmUpMetrics.numTypefaces } + " typefaces, "
+            + juce::String{ warmUpMetrics.numGlyphsWarmed } + " glyphs in " + juce::String{ warmUpMetrics.workerMilliseconds, 2 } + " ms on worker threads";
+        if (warmFirstDrawMilliseconds >= 0.0)
+        {
+            warmUpText << "; first draw " << juce::String{ warmFirstDrawMilliseconds, 2 } << " ms warmed, " << juce::String{ coldFirstDrawMilliseconds, 2 } << " ms cold";
+        }
+
+        g.drawText(warmUpText, getLocalBounds().removeFromBottom(95).removeFromTop(25).withTrimmedLeft(10), juce::Justification::centredLeft);
+
+        g.drawText("Text cache: runs " + juce::String{ metrics.getRunHitRate() * 100.0, 1 } + "% hit, glyphs " + juce::String{ metrics.getGlyphHitRate() * 100.0, 1 } + "% hit, "
+                + juce::String{ metrics.numGlyphs } + " glyphs in " + juce::String{ metrics.numAtlasPages } + " atlas pages, widths "
+                + juce::String{ stringWidthCache->getMetrics().getHitRate() * 100.0, 1 } + "% hit",
+            getLocalBounds().removeFromBottom(70).removeFromTop(25).withTrimmedLeft(10),
+            juce::Justification::centredLeft);
     }
 
+    //
+    // The default font until Open Sans has loaded; typefaceReady() lays the buttons out again then
+    //
     juce::Font getTextButtonFont(juce::TextButton&, int buttonHeight) override
     {
-        return juce::Font{ openSansTypeface }.withHeight(24.0f);
+        if (auto typeface = typefaceWarmUp.get(openSansTypeface))
+        {
+            return juce::Font{ typeface }.withHeight(24.0f);
+        }
+
+        return juce::Font{ 24.0f };
+    }
+
+    //
+    // Same as LookAndFeel_V2, with the width coming from the cache
+    //
+    int getTextButtonWidthToFitText(juce::TextButton& button, int buttonHeight) override
+    {
+        return stringWidthCache->getStringWidth(getTextButtonFont(button, buttonHeight), button.getButtonText()) + buttonHeight;
     }
 
-    juce::Typeface::Ptr robotoTypeface = juce::Typeface::createSystemTypefaceFor(BinaryData::RobotoMedium_ttf, BinaryData::RobotoMedium_ttfSize);
-    juce::Typeface::Ptr openSansTypeface = juce::Typeface::createSystemTypefaceFor(BinaryData::OpenSansRegular_ttf, BinaryData::OpenSansRegular_ttfSize);
+    void typefaceReady()
+    {
+        firstDrawButton.setEnabled(typefaceWarmUp.areAllReady());
+
+        resized();
+        repaint();
+    }
+
+    //
+    // Times the first offscreen draw of the typeface names, once with the warmed typefaces and once with
+    // typefaces loaded here on the message thread, as they were before the warm-up. The cold run fills each
+    // glyph's outline itself, as the renderer does on a glyph cache miss; drawing text with the cold
+    // typefaces would hit the glyphs the warm-up cached, because the glyph cache matches fonts by name.
+    //
+    // Loading the cold typefaces puts back the message thread work the warm-up removes, so this only runs
+    // when the button is clicked.
+    //
+    void measureFirstDraw()
+    {
+        juce::Image scratch{ juce::Image::ARGB, getWidth(), getHeight(), true, juce::SoftwareImageType{} };
+        juce::Graphics g{ scratch };
+        g.setColour(juce::Colours::white);
+
+        auto start = juce::Time::getHighResolutionTicks();
+        for (auto index : { robotoTypeface, openSansTypeface })
+        {
+            auto font = juce::Font{ typefaceWarmUp.get(index) }.withHeight(30.0f);
+            g.setFont(font);
+            g.drawText(font.toString(), getLocalBounds(), juce::Justification::centred);
+        }
+        warmFirstDrawMilliseconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+
+        start = juce::Time::getHighResolutionTicks();
+        for (auto [fontData, fontDataSize] : { std::pair{ BinaryData::RobotoMedium_ttf, BinaryData::RobotoMedium_ttfSize },
+                 std::pair{ BinaryData::OpenSansRegular_ttf, BinaryData::OpenSansRegular_ttfSize } })
+        {
+            auto font = juce::Font{ juce::Typeface::createSystemTypefaceFor(fontData, (size_t)fontDataSize) }.withHeight(30.0f);
+
+            juce::GlyphArrangement arrangement;
+            arrangement.addLineOfText(font, font.toString(), 10.0f, 50.0f);
+            for (int glyph = 0; glyph < arrangement.getNumGlyphs(); ++glyph)
+            {
+                juce::Path outline;
+                arrangement.getGlyph(glyph).createPath(outline);
+                g.fillPath(outline);
+            }
+        }
+        coldFirstDrawMilliseconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+    }
+
+    //
+    // The typefaces load on worker threads while the window is created, so nothing here waits for them
+    //
+    TypefaceWarmUp typefaceWarmUp;
+    std::function<void()> const onTypefaceReady = [safeThis = juce::Component::SafePointer<FontTest>{ this }]
+        {
+            if (safeThis)
+            {
+                safeThis->typefaceReady();
+            }
+        };
+    int const robotoTypeface = typefaceWarmUp.add(BinaryData::RobotoMedium_ttf, BinaryData::RobotoMedium_ttfSize, onTypefaceReady);
+    int const openSansTypeface = typefaceWarmUp.add(BinaryData::OpenSansRegular_ttf, BinaryData::OpenSansRegular_ttfSize, onTypefaceReady);
+    double warmFirstDrawMilliseconds = -1.0;
+    double coldFirstDrawMilliseconds = -1.0;
+
+    juce::SharedResourcePointer<TextCache> textCache;
+    juce::SharedResourcePointer<StringWidthCache> stringWidthCache;
 
     juce::OwnedArray<juce::TextButton> buttons;
     juce::ToggleButton direct2DToggle{ "D2D" };
+    juce::TextButton firstDrawButton{ "Measure first draw" };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FontTest)
 };
@@ -21,7 +21,15 @@
 
 #pragma once
 
-class ImageDrawTest : public juce::Component, public juce::ImagePixelData::Listener
+#include "AssetCache.h"
+#include "AsyncImageLoader.h"
+#include "DeferredGraphics.h"
+#include "ImageBlitter.h"
+#include "ImageBudget.h"
+#include "ImageMipmap.h"
+#include "TiledImage.h"
+
+class ImageDrawTest : public juce::Component
 {
 public:
     ImageDrawTest()
@@ -35,11 +43,23 @@ public:
         modeCombo.addItem("drawImageAt", Mode::drawImageAt);
         modeCombo.addItem("drawImageWithin", Mode::drawImageWithin);
         modeCombo.addItem("drawImageTransformed", Mode::drawImageTransformed);
+        modeCombo.addItem("Rotation benchmark", Mode::rotationBenchmark);
+        modeCombo.addItem("Stream image directory", Mode::streamDirectory);
         addAndMakeVisible(modeCombo);
         modeCombo.setSelectedId(Mode::drawImageTransformed, juce::dontSendNotification);
         modeCombo.onChange = [this]
             {
                 transformCombo.setEnabled(modeCombo.getSelectedId() == Mode::drawImageTransformed);
+
+                if (modeCombo.getSelectedId() == Mode::rotationBenchmark)
+                {
+                    runRotationBenchmark();
+                }
+
+                if (modeCombo.getSelectedId() == Mode::streamDirectory)
+                {
+                    chooseDirectoryToStream();
+                }
             };
 
         transformCombo.addItem("Translate", TransformType::translate);
@@ -49,6 +69,19 @@ public:
         addAndMakeVisible(transformCombo);
         transformCombo.setSelectedId(TransformType::translate, juce::dontSendNotification);
 
+        addAndMakeVisible(resamplerToggle);
+        addAndMakeVisible(mipmapToggle);
+        addAndMakeVisible(trilinearToggle);
+
+        addAndMakeVisible(blitterToggle);
+        blitterToggle.onClick = [this]()
+            {
+                if (blitterToggle.getToggleState())
+                {
+                    runBlitterVerification();
+                }
+            };
+
         setSize(1024, 1024);
     }
 
@@ -59,6 +92,10 @@ public:
         resamplingQualityCombo.setBounds(10, 10, 250, 30);
         modeCombo.setBounds(resamplingQualityCombo.getBounds().translated(0, resamplingQualityCombo.getHeight() + 5));
         transformCombo.setBounds(modeCombo.getBounds().translated(0, modeCombo.getHeight() + 5));
+        resamplerToggle.setBounds(transformCombo.getBounds().translated(0, transformCombo.getHeight() + 5));
+        mipmapToggle.setBounds(resamplerToggle.getBounds().translated(0, resamplerToggle.getHeight() + 5));
+        trilinearToggle.setBounds(mipmapToggle.getBounds().translated(0, mipmapToggle.getHeight() + 5));
+        blitterToggle.setBounds(trilinearToggle.getBounds().translated(0, trilinearToggle.getHeight() + 5));
 
         createCachedImage();
     }
@@ -66,9 +103,10 @@ public:
     void paint(juce::Graphics& g) override
     {
         //
-        // Check if the cachedImage is still valid; if it's not valid, then the Direct2D bitmap is no longer
-        // cached on the GPU and the image data is gone.
+        // Get the cached image for this paint only. The image budget may have evicted it, or remade it after
+        // the device was lost and the Direct2D bitmap's image data was gone.
         //
+        auto cachedImage = cachedImageHandle.get();
         if (cachedImage.isNull())
         {
             return;
@@ -80,6 +118,22 @@ public:
             getWidth() * 0.1f, getHeight() * 0.1f,
             Colours::lightgrey, Colours::darkgrey);
 
+        if (modeCombo.getSelectedId() == Mode::rotationBenchmark)
+        {
+            g.setColour(juce::Colours::black);
+            g.setFont(16.0f);
+            g.drawMultiLineText(benchmarkResults.joinIntoString("\n"), 280, 40, getWidth() - 300);
+            return;
+        }
+
+        if (modeCombo.getSelectedId() == Mode::streamDirectory)
+        {
+            paintStreamedImages(g);
+            return;
+        }
+
+        auto useSoftwareRenderer = dynamic_cast<juce::LowLevelGraphicsSoftwareRenderer*>(&g.getInternalContext()) != nullptr;
+        auto useMipmap = mipmapToggle.getToggleState() && useSoftwareRenderer;
         auto mousePos = getMouseXYRelative();
         mousePos.x = juce::jlimit(imagePaintArea.getX(), imagePaintArea.getRight(), mousePos.x);
         mousePos.y = juce::jlimit(imagePaintArea.getY(), imagePaintArea.getBottom(), mousePos.y);
@@ -97,6 +151,35 @@ public:
         {
             Rectangle<int> r = imagePaintArea.withSizeKeepingCentre(std::abs(mousePos.x - imagePaintArea.getCentreX()) * 2,
                 std::abs(mousePos.y - imagePaintArea.getCentreY()) * 2);
+
+            if (useMipmap)
+            {
+                auto placement = juce::RectanglePlacement{ juce::RectanglePlacement::centred }.getTransformToFit(cachedImage.getBounds().toFloat(), r.toFloat());
+                mipmap.draw(g, getSoftwareImage(cachedImage), placement, trilinearToggle.getToggleState());
+                break;
+            }
+
+            //
+            // The software renderer filters every pixel through its generic transform path; for a plain
+            // scale it's quicker to resample to the final physical size and blit that
+            //
+            if (resamplerToggle.getToggleState() && useSoftwareRenderer)
+            {
+                auto placed = juce::RectanglePlacement{ juce::RectanglePlacement::centred }.appliedTo(cachedImage.getBounds().toFloat(), r.toFloat());
+                auto scaleFactor = g.getInternalContext().getPhysicalPixelScaleFactor();
+                auto width = juce::roundToInt(placed.getWidth() * scaleFactor);
+                auto height = juce::roundToInt(placed.getHeight() * scaleFactor);
+
+                if (width > 0 && height > 0)
+                {
+                    auto quality = (juce::Graphics::ResamplingQuality)(resamplingQualityCombo.getSelectedId() - 1);
+                    auto rescaledImage = resampler.rescaled(getSoftwareImage(cachedImage), width, height, quality);
+                    g.drawImageTransformed(rescaledImage, juce::AffineTransform::scale(1.0f / scaleFactor).translated(placed.getPosition()));
+                }
+
+                break;
+            }
+
             g.drawImageWithin(cachedImage, r.getX(), r.getY(), r.getWidth(), r.getHeight(),
                 juce::RectanglePlacement::centred);
             break;
@@ -104,6 +187,25 @@ public:
 
         case Mode::drawImageTransformed:
         {
+            if (useMipmap)
+            {
+                mipmap.draw(g, getSoftwareImage(cachedImage), animatedTransform, trilinearToggle.getToggleState());
+                break;
+            }
+
+            if (blitterToggle.getToggleState() && useSoftwareRenderer)
+            {
+                auto quality = (juce::Graphics::ResamplingQuality)(resamplingQualityCombo.getSelectedId() - 1);
+                auto path = blitter.draw(g, getSoftwareImage(cachedImage), animatedTransform, quality);
+
+                g.setColour(juce::Colours::black);
+                g.setFont(16.0f);
+                g.drawMultiLineText("Blitter path: " + ImageBlitter::getPathName(path) + ", average " + juce::String{ blitter.blitTime.getAverage(), 2 } + " ms\n"
+                    + blitterResults.joinIntoString("\n"),
+                    10, getHeight() - 120, getWidth() - 20);
+                break;
+            }
+
             g.drawImageTransformed(cachedImage, animatedTransform);
             break;
         }
@@ -124,61 +226,19 @@ public:
             phase = nextPhase;
         }
 
-        auto position = (float)std::sin(phase);
-        auto clampedPosition = juce::jlimit(0.0f, 1.0f, position * 0.5f + 0.5f);
-        auto imageCenter = cachedImage.getBounds().getCentre().toFloat();
-        auto componentCenter = getLocalBounds().getCentre().toFloat();
-        switch (transformCombo.getSelectedId())
-        {
-        case TransformType::scale:
-            animatedTransform = juce::AffineTransform::scale(clampedPosition, clampedPosition, imageCenter.x, imageCenter.y);
-            break;
-
-        case TransformType::translate:
-            animatedTransform = juce::AffineTransform::translation(position * 50.0f, position * 50.0f);
-            break;
-
-        case TransformType::shear:
-            animatedTransform = juce::AffineTransform::shear(position * 0.5f, position * 0.5f);
-            break;
-
-        case TransformType::rotate:
-            animatedTransform = juce::AffineTransform::rotation((float)phase, imageCenter.x, imageCenter.y);
-            break;
-        }
-
-        animatedTransform = animatedTransform.translated(componentCenter - imageCenter);
+        animatedTransform = createTransform(transformCombo.getSelectedId(), phase);
 
         repaint();
     }
 
-    void imageDataChanged(ImagePixelData*) override
-    {
-    }
-
-    void imageDataBeingDeleted(ImagePixelData*) override
-    {
-        //
-        // Cached image data can be deleted unexpectedly; when that happens, the bitmap data is gone
-        // and will need to be recreated.
-        //
-        // The renderer will call imageDataBeingDeleted for any listeners attached to the ImagePixelData
-        //
-        // Note that the DXGI adapter may not be available yet when this callback happens so you'll need to
-        // defer recreating your images later
-        //
-        // You can also call Image::isValid() or Image::isNull() to see if the bitmap data is still available.
-        //
-        // To test this, change the Windows display DPI while your app is running
-        //
-    }
-
 private:
     enum Mode
     {
         drawImageAt = 1,
         drawImageWithin,
-        drawImageTransformed
+        drawImageTransformed,
+        rotationBenchmark,
+        streamDirectory
     };
 
     enum TransformType
@@ -197,63 +257,357 @@ private:
     juce::ComboBox resamplingQualityCombo;
     juce::ComboBox modeCombo;
     juce::ComboBox transformCombo;
+    juce::ToggleButton resamplerToggle{ "Vectorised resampler" };
+    juce::ToggleButton mipmapToggle{ "Mipmaps" };
+    juce::ToggleButton trilinearToggle{ "Trilinear" };
+    juce::ToggleButton blitterToggle{ "Specialised blitters" };
+    ImageResampler resampler;
+    ImageMipmap mipmap{ resampler };
+    ImageBlitter blitter{ resampler };
+    juce::StringArray blitterResults;
 
     //
-    // Direct2D resources are generally more expensive to create than they are to draw.
-    // If you have an Image you want to use more than once, keep that image as a member
-    // variable, on the heap, or in the JUCE ImageCache. The renderer will keep the bitmap
-    // data cached on the GPU as long as the Image's internal data exists.
-    //
-    // Drawing a cached image is much faster than drawing a non-cached image.
+    // Thumbnails for the directory streaming mode, decoded off the message thread
     //
-    juce::Image cachedImage;
-    juce::Image polkaDotsImage;
+    static constexpr int thumbnailSize = 128;
+    AsyncImageLoader imageLoader;
+    std::vector<AsyncImageLoader::Request::Ptr> streamedImages;
+    std::unique_ptr<juce::FileChooser> directoryChooser;
+    juce::StringArray benchmarkResults;
+
     juce::Rectangle<int> imagePaintArea;
 
+    //
+    // Software copy of the cached image for the resampler, the blitters and the mip chain. If the cached
+    // image is already a software image it's used as it is; otherwise the copy is budgeted like the
+    // cached image, so it's freed when evicted.
+    //
+    juce::Image getSoftwareImage(juce::Image const& cachedImage)
+    {
+        if (cachedImage.isNull() || cachedImage.getPixelData()->createType()->getTypeID() == juce::SoftwareImageType{}.getTypeID())
+        {
+            return cachedImage;
+        }
+
+        return softwareImageHandle.get();
+    }
+
+    //
+    // Direct2D resources are generally more expensive to create than they are to draw. If you have an
+    // Image you want to use more than once, keep it somewhere that outlives each paint; the renderer
+    // keeps the bitmap data cached on the GPU as long as the Image's internal data exists. Drawing a
+    // cached image is much faster than drawing a non-cached image.
+    //
+    // Here the image budget holds it, and paint() gets it each time it draws, so evicting it really does
+    // free it. The cached image is also kept on disk between runs; the recipe describes everything that
+    // goes into it, so the polka dots use a fixed seed and palette.
+    //
+    static constexpr int polkaDotPaletteSize = 8;
+
+    juce::SharedResourcePointer<AssetCache> assetCache;
+    juce::SharedResourcePointer<ImageBudget> imageBudget;
+    ImageBudget::Handle cachedImageHandle;
+    ImageBudget::Handle softwareImageHandle;
+
+    juce::Rectangle<int> getCachedImageBounds() const
+    {
+        return imagePaintArea.withZeroOrigin();
+    }
+
     void createCachedImage()
     {
         imagePaintArea = getLocalBounds().reduced(100);
 
-        polkaDotsImage = juce::Image{ juce::Image::ARGB, imagePaintArea.getWidth(), imagePaintArea.getHeight(), true };
+        auto recipe = "ImageDrawTest cached image " + juce::String{ imagePaintArea.getWidth() } + "x" + juce::String{ imagePaintArea.getHeight() } + " seed 1 palette " + juce::String{ polkaDotPaletteSize };
+        //
+        // Cached image data can be deleted unexpectedly, for example when the Windows display DPI changes
+        // and the Direct2D device is lost. The budget listens for that and remakes the image on the next
+        // get(), so nothing here needs to listen to the pixel data.
+        //
+        cachedImageHandle = imageBudget->add([this, recipe]
+            {
+                return assetCache->getImage(recipe, [this]
+                    {
+                        auto polkaDotsImage = juce::Image{ juce::Image::ARGB, imagePaintArea.getWidth(), imagePaintArea.getHeight(), true, juce::SoftwareImageType{} };
+
+                        {
+                            //
+                            // The dots are recorded and played back into the software image when g goes out of
+                            // scope. Their hues come from a small palette, so dots that share a colour and don't
+                            // overlap are filled as one path.
+                            //
+                            DeferredGraphics g{ polkaDotsImage };
+                            juce::Random random{ 1 };
+
+                            auto r = polkaDotsImage.getBounds().reduced(20).toFloat();
+                            for (int i = 0; i < 100; ++i)
+                            {
+                                g.setColour(juce::Colour::fromHSV((float)random.nextInt(polkaDotPaletteSize) / (float)polkaDotPaletteSize, 1.0f, 1.0f, 0.5f));
+                                float size = random.nextFloat() * 100.0f;
+                                g.fillEllipse(random.nextFloat() * r.getWidth(),
+                                    random.nextFloat() * r.getHeight(),
+                                    size, size);
+                            }
+                        }
+
+                        auto image = juce::Image{ juce::Image::ARGB, imagePaintArea.getWidth(), imagePaintArea.getHeight(), true };
+
+                        {
+                            //
+                            // For DirectD images, drawing doesn't actually happen until the Graphics object goes
+                            // out of scope. So - surround the Graphics object with braces.
+                            //
+                            juce::Graphics g{ image };
+
+                            auto r = image.getBounds().reduced(10).toFloat();
+                            g.setColour(juce::Colours::white);
+                            g.fillEllipse(r.toFloat());
+                            g.setColour(juce::Colours::black);
+                            g.drawEllipse(r.toFloat(), 5.0f);
+
+                            g.drawImageAt(polkaDotsImage, 0, 0);
+                        }
+
+                        return image;
+                    }, juce::NativeImageType{});
+            });
+
+        softwareImageHandle = imageBudget->add([this]
+            {
+                return juce::SoftwareImageType{}.convert(cachedImageHandle.get());
+            });
+    }
 
+    juce::AffineTransform createTransform(int transformType, double transformPhase) const
+    {
+        auto position = (float)std::sin(transformPhase);
+        auto clampedPosition = juce::jlimit(0.0f, 1.0f, position * 0.5f + 0.5f);
+        auto imageCenter = getCachedImageBounds().getCentre().toFloat();
+        auto componentCenter = getLocalBounds().getCentre().toFloat();
+        juce::AffineTransform transform;
+
+        switch (transformType)
         {
-            juce::Graphics g{ polkaDotsImage };
-            juce::Random random;
+        case TransformType::scale:
+            transform = juce::AffineTransform::scale(clampedPosition, clampedPosition, imageCenter.x, imageCenter.y);
+            break;
+
+        case TransformType::translate:
+            transform = juce::AffineTransform::translation(position * 50.0f, position * 50.0f);
+            break;
+
+        case TransformType::shear:
+            transform = juce::AffineTransform::shear(position * 0.5f, position * 0.5f);
+            break;
 
-            auto r = polkaDotsImage.getBounds().reduced(20).toFloat();
-            for (int i = 0; i < 100; ++i)
+        case TransformType::rotate:
+            transform = juce::AffineTransform::rotation((float)transformPhase, imageCenter.x, imageCenter.y);
+            break;
+        }
+
+        return transform.translated(componentCenter - imageCenter);
+    }
+
+    //
+    // Draws each animated transform, plus a whole-pixel translation, with drawImageTransformed and with
+    // the specialised blitters into offscreen software images, and lists the largest and mean channel
+    // differences
+    //
+    void runBlitterVerification()
+    {
+        auto quality = (juce::Graphics::ResamplingQuality)(resamplingQualityCombo.getSelectedId() - 1);
+        std::pair<char const*, juce::AffineTransform> const transforms[] =
+        {
+            { "Whole-pixel translate", juce::AffineTransform::translation(50.0f, 50.0f) },
+            { "Translate", createTransform(TransformType::translate, 1.0) },
+            { "Scale", createTransform(TransformType::scale, 1.0) },
+            { "Shear", createTransform(TransformType::shear, 1.0) },
+            { "Rotate", createTransform(TransformType::rotate, 1.0) },
+        };
+
+        blitterResults.clear();
+
+        for (auto const& [name, transform] : transforms)
+        {
+            auto verification = blitter.verify(getSoftwareImage(cachedImageHandle.get()), transform, quality, getWidth(), getHeight());
+            blitterResults.add(juce::String{ name } + " (" + ImageBlitter::getPathName(verification.path) + "): max error "
+                + juce::String{ verification.maxError } + ", mean " + juce::String{ verification.meanError, 3 });
+        }
+
+        blitter.blitTime.reset();
+        repaint();
+    }
+
+    void chooseDirectoryToStream()
+    {
+        directoryChooser = std::make_unique<juce::FileChooser>("Choose a directory of images",
+            juce::File::getSpecialLocation(juce::File::userPicturesDirectory));
+
+        directoryChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectDirectories,
+            [this](juce::FileChooser const& chooser)
             {
-                g.setColour(juce::Colour::fromHSV(random.nextFloat(), 1.0f, 1.0f, 0.5f));
-                float size = random.nextFloat() * 100.0f;
-                g.fillEllipse(random.nextFloat() * r.getWidth(),
-                    random.nextFloat() * r.getHeight(),
-                    size, size);
+                if (chooser.getResult().isDirectory())
+                {
+                    streamDirectory(chooser.getResult());
+                }
+            });
+    }
+
+    //
+    // Queues every image in the directory at once; each cell shows a placeholder until its thumbnail
+    // has been decoded and downscaled on a worker thread
+    //
+    void streamDirectory(juce::File const& directory)
+    {
+        streamedImages.clear();
+
+        auto files = directory.findChildFiles(juce::File::findFiles, false, "*.png;*.jpg;*.jpeg;*.gif");
+        files.sort();
+
+        //
+        // Decode at twice the cell size so thumbnails stay sharp on high-DPI displays
+        //
+        AsyncImageLoader::Options options;
+        options.maxWidth = thumbnailSize * 2;
+        options.maxHeight = thumbnailSize * 2;
+
+        for (auto const& file : files)
+        {
+            streamedImages.push_back(imageLoader.load(file, options, [safeThis = juce::Component::SafePointer<ImageDrawTest>{ this }]
+                {
+                    if (safeThis)
+                    {
+                        safeThis->repaint();
+                    }
+                }));
+        }
+
+        repaint();
+    }
+
+    void paintStreamedImages(juce::Graphics& g)
+    {
+        int numReady = 0;
+        double totalDecodeMilliseconds = 0.0;
+        for (auto const& request : streamedImages)
+        {
+            if (request->isReady())
+            {
+                ++numReady;
+                totalDecodeMilliseconds += request->decodeMilliseconds;
             }
         }
 
-        cachedImage = juce::Image{ juce::Image::ARGB, imagePaintArea.getWidth(), imagePaintArea.getHeight(), true };
+        auto poolMetrics = PixelBufferPool::getMetrics();
+
+        g.setColour(juce::Colours::black);
+        g.setFont(16.0f);
+        g.drawMultiLineText(juce::String{ numReady } + " of " + juce::String{ (int)streamedImages.size() } + " images ready, "
+            + juce::String{ imageLoader.getNumPending() } + " queued\n"
+            + "Average decode " + juce::String{ totalDecodeMilliseconds / juce::jmax(1, numReady), 1 } + " ms\n"
+            + "Pixel buffers allocated " + juce::String{ poolMetrics.numAllocations } + ", reused " + juce::String{ poolMetrics.numAllocationsAvoided },
+            280, 40, getWidth() - 300);
 
+        auto cellSize = thumbnailSize + 10;
+        auto numColumns = juce::jmax(1, (getWidth() - 20) / cellSize);
+        auto top = 250;
+
+        for (size_t index = 0; index < streamedImages.size(); ++index)
         {
-            //
-            // For DirectD images, drawing doesn't actually happen until the Graphics object goes
-            // out of scope. So - surround the Graphics object with braces.
-            //
-            juce::Graphics g{ cachedImage };
+            auto column = (int)index % numColumns;
+            auto row = (int)index / numColumns;
+            juce::Rectangle<float> cell{ 10.0f + (float)(column * cellSize), (float)(top + row * cellSize), (float)thumbnailSize, (float)thumbnailSize };
 
-            auto r = cachedImage.getBounds().reduced(10).toFloat();
-            g.setColour(juce::Colours::white);
-            g.fillEllipse(r.toFloat());
-            g.setColour(juce::Colours::black);
-            g.drawEllipse(r.toFloat(), 5.0f);
+            if (cell.getY() > (float)getHeight())
+            {
+                break;
+            }
 
-            g.drawImageAt(polkaDotsImage, 0, 0);
+            streamedImages[index]->draw(g, cell);
         }
+    }
+
+    //
+    // Rotates and shears a large image into a window-sized software image, reading from a linear image
+    // directly, from a linear image a destination block at a time, and from a tiled image a block at a
+    // time, and reports destination megapixels per second
+    //
+    void runRotationBenchmark()
+    {
+        constexpr int sourceSize = 4096;
+        constexpr double secondsPerBenchmark = 0.25;
 
         //
-        // Attach a listener to the image to be notified if the cached image is
-        // unexpectedly deleted
+        // Copies of the cached image in a grid with transparent gaps, so some tiles are left out of the
+        // sparse tiled copy
         //
-        cachedImage.getPixelData()->listeners.add(this);
+        juce::Image linear{ juce::Image::ARGB, sourceSize, sourceSize, true, juce::SoftwareImageType{} };
+        {
+            auto tile = getSoftwareImage(cachedImageHandle.get());
+            juce::Graphics g{ linear };
+            for (int y = 0; y < sourceSize; y += 1024)
+            {
+                for (int x = 0; x < sourceSize; x += 1024)
+                {
+                    g.drawImageAt(tile, x, y);
+                }
+            }
+        }
+
+        auto tiled = TiledImage::createFrom(linear, true);
+        auto numTiles = (sourceSize / TiledImage::tileSize) * (sourceSize / TiledImage::tileSize);
+
+        juce::Image dest{ juce::Image::ARGB, 1024, 1024, false, juce::SoftwareImageType{} };
+        auto quality = (juce::Graphics::ResamplingQuality)(resamplingQualityCombo.getSelectedId() - 1);
+
+        auto measureMegapixelsPerSecond = [&](std::function<void(juce::Graphics&)> draw)
+            {
+                juce::int64 numPixels = 0;
+                auto start = juce::Time::getHighResolutionTicks();
+                double elapsedSeconds = 0.0;
+
+                do
+                {
+                    juce::Graphics g{ dest };
+                    g.setImageResamplingQuality(quality);
+                    draw(g);
+                    numPixels += (juce::int64)dest.getWidth() * dest.getHeight();
+                    elapsedSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+                } while (elapsedSeconds < secondsPerBenchmark);
+
+                return (double)numPixels / elapsedSeconds * 1.0e-6;
+            };
+
+        benchmarkResults.clear();
+        benchmarkResults.add("Source " + juce::String{ sourceSize } + "x" + juce::String{ sourceSize } + ", "
+            + juce::String{ TiledImage::getNumAllocatedTiles(tiled) } + " of " + juce::String{ numTiles } + " tiles allocated");
+        benchmarkResults.add("Destination " + juce::String{ dest.getWidth() } + "x" + juce::String{ dest.getHeight() } + ", MP/s");
+        benchmarkResults.add({});
+
+        auto sourceCentre = linear.getBounds().getCentre().toFloat();
+        auto destCentre = dest.getBounds().getCentre().toFloat();
+        std::pair<char const*, juce::AffineTransform> const transforms[] =
+        {
+            { "Rotate 10", juce::AffineTransform::rotation(juce::degreesToRadians(10.0f)) },
+            { "Rotate 45", juce::AffineTransform::rotation(juce::degreesToRadians(45.0f)) },
+            { "Rotate 90", juce::AffineTransform::rotation(juce::degreesToRadians(90.0f)) },
+            { "Shear", juce::AffineTransform::shear(0.5f, 0.25f) },
+        };
+
+        for (auto const& [name, transform] : transforms)
+        {
+            auto placement = juce::AffineTransform::translation(-sourceCentre).followedBy(transform).translated(destCentre);
+
+            auto linearRate = measureMegapixelsPerSecond([&](juce::Graphics& g) { g.drawImageTransformed(linear, placement); });
+            auto blockedRate = measureMegapixelsPerSecond([&](juce::Graphics& g) { TiledImage::drawTransformed(g, linear, placement); });
+            auto tiledRate = measureMegapixelsPerSecond([&](juce::Graphics& g) { TiledImage::drawTransformed(g, tiled, placement); });
+
+            benchmarkResults.add(juce::String{ name } + ": linear " + juce::String{ linearRate, 1 }
+                + ", linear blocked " + juce::String{ blockedRate, 1 }
+                + ", tiled " + juce::String{ tiledRate, 1 } + " (" + juce::String{ tiledRate / juce::jmax(linearRate, 1.0e-9), 1 } + "x)");
+        }
+
+        repaint();
     }
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ImageDrawTest)
@@ -21,6 +21,11 @@
 
 #pragma once
 
+#include "ImageResampler.h"
+#include "ImageConverter.h"
+#include "CopyOnWriteImage.h"
+#include "PixelBufferPool.h"
+
 class ImageEditTest : public juce::Component, public juce::ImagePixelData::Listener
 {
 public:
@@ -38,6 +43,8 @@ public:
         modeCombo.addItem("convertedToFormat", Mode::convertedToFormat);
         modeCombo.addItem("getClippedImage", Mode::getClippedImage);
         modeCombo.addItem("Clip copy and convert", Mode::clipCopyAndConvert);
+        modeCombo.addItem("rescaled benchmark", Mode::rescaledBenchmark);
+        modeCombo.addItem("Conversion benchmark", Mode::conversionBenchmark);
         addAndMakeVisible(modeCombo);
         modeCombo.setSelectedId(Mode::clear, juce::dontSendNotification);
         modeCombo.onChange = [this]
@@ -46,6 +53,20 @@ public:
                 repaint();
             };
 
+        addAndMakeVisible(vectorisedToggle);
+        vectorisedToggle.onClick = [this]()
+            {
+                createCachedImages();
+                repaint();
+            };
+
+        addAndMakeVisible(copyOnWriteToggle);
+        copyOnWriteToggle.onClick = [this]()
+            {
+                createCachedImages();
+                repaint();
+            };
+
         setSize(1024, 1024);
     }
 
@@ -55,6 +76,8 @@ public:
     {
         resamplingQualityCombo.setBounds(10, 10, 250, 30);
         modeCombo.setBounds(resamplingQualityCombo.getBounds().translated(0, resamplingQualityCombo.getHeight() + 5));
+        vectorisedToggle.setBounds(modeCombo.getBounds().translated(0, modeCombo.getHeight() + 5));
+        copyOnWriteToggle.setBounds(vectorisedToggle.getBounds().translated(0, vectorisedToggle.getHeight() + 5));
 
         createCachedImages();
     }
@@ -78,11 +101,37 @@ public:
             g.drawImageAt(cachedImage, leftRect.getX(), leftRect.getY());
         }
 
+        if (modeCombo.getSelectedId() == Mode::rescaledBenchmark || modeCombo.getSelectedId() == Mode::conversionBenchmark)
+        {
+            g.setColour(juce::Colours::white);
+            g.setFont(16.0f);
+            g.drawMultiLineText(benchmarkResults.joinIntoString("\n"), getWidth() / 2 + 20, 150, getWidth() / 2 - 40);
+            return;
+        }
+
         {
             auto rightRect = getLocalBounds().removeFromRight(getWidth() / 2);
             rightRect = rightRect.withSizeKeepingCentre(editedImage.getWidth(), editedImage.getHeight());
             g.drawImageAt(editedImage, rightRect.getX(), rightRect.getY());
         }
+
+        {
+            auto metrics = CopyOnWriteImage::getMetrics();
+            g.setColour(juce::Colours::white);
+            g.setFont(16.0f);
+            g.drawText("Copies: " + juce::String{ metrics.numCopies }
+                + ", rows copied: " + juce::String{ metrics.numRowsCopied }
+                + ", bytes copied: " + juce::File::descriptionOfSizeInBytes(metrics.numBytesCopied)
+                + ", views shared: " + juce::String{ metrics.numViewsShared },
+                getLocalBounds().removeFromBottom(40).reduced(10, 0), juce::Justification::centredLeft);
+
+            auto poolMetrics = PixelBufferPool::getMetrics();
+            g.drawText("Pixel buffers allocated: " + juce::String{ poolMetrics.numAllocations }
+                + ", allocations avoided: " + juce::String{ poolMetrics.numAllocationsAvoided }
+                + ", bytes reused: " + juce::File::descriptionOfSizeInBytes(poolMetrics.numBytesReused)
+                + ", pooled: " + juce::File::descriptionOfSizeInBytes((juce::int64)poolMetrics.pooledBytes),
+                getLocalBounds().removeFromBottom(70).removeFromTop(30).reduced(10, 0), juce::Justification::centredLeft);
+        }
     }
 
     void imageDataChanged(ImagePixelData*) override
@@ -114,11 +163,18 @@ private:
         createCopy,
         convertedToFormat,
         getClippedImage,
-        clipCopyAndConvert
+        clipCopyAndConvert,
+        rescaledBenchmark,
+        conversionBenchmark
     };
 
     juce::ComboBox resamplingQualityCombo;
     juce::ComboBox modeCombo;
+    juce::ToggleButton vectorisedToggle{ "Vectorised kernels" };
+    juce::ToggleButton copyOnWriteToggle{ "Copy-on-write images" };
+    ImageResampler resampler;
+    ImageConverter converter;
+    juce::StringArray benchmarkResults;
 
     //
     // Direct2D resources are generally more expensive to create than they are to draw.
@@ -163,11 +219,29 @@ private:
         //
         // Create the edited image
         //
+        // With copy-on-write images, the cached image is copied once into shared storage; clipping and
+        // copying from there is free, and writing copies just the rows written. Only the modes that read
+        // the copy-on-write image make it, so the other modes don't pay for that copy.
+        //
+        CopyOnWriteImage::resetMetrics();
+        auto copyOnWrite = copyOnWriteToggle.getToggleState();
+        auto getSource = [&]
+            {
+                return copyOnWrite ? CopyOnWriteImage::adopt(cachedImage) : cachedImage;
+            };
+
         switch (modeCombo.getSelectedId())
         {
         case Mode::clear:
         {
             editedImage = cachedImage.createCopy();
+
+            if (vectorisedToggle.getToggleState())
+            {
+                converter.clear(editedImage, editedImage.getBounds().reduced(50), juce::Colours::limegreen);
+                break;
+            }
+
             editedImage.clear(editedImage.getBounds().reduced(50), juce::Colours::limegreen);
             break;
         }
@@ -175,24 +249,44 @@ private:
         case Mode::rescaled:
         {
             imageSize *= 0.75f;
-            editedImage = cachedImage.rescaled(imageSize.getWidth(), imageSize.getHeight(), (juce::Graphics::ResamplingQuality)resamplingQualityCombo.getSelectedId());
+            auto quality = (juce::Graphics::ResamplingQuality)(resamplingQualityCombo.getSelectedId() - 1);
+
+            if (vectorisedToggle.getToggleState())
+            {
+                editedImage = resampler.rescaled(cachedImage, imageSize.getWidth(), imageSize.getHeight(), quality);
+                break;
+            }
+
+            editedImage = cachedImage.rescaled(imageSize.getWidth(), imageSize.getHeight(), quality);
             break;
         }
 
         case Mode::createCopy:
         {
-            editedImage = cachedImage.createCopy();
+            editedImage = getSource().createCopy();
             break;
         }
 
         case Mode::convertedToFormat:
         {
+            if (vectorisedToggle.getToggleState())
+            {
+                editedImage = converter.convertedToFormat(cachedImage, juce::Image::SingleChannel);
+                break;
+            }
+
             editedImage = cachedImage.convertedToFormat(juce::Image::SingleChannel);
             break;
         }
 
         case Mode::getClippedImage:
         {
+            if (copyOnWrite)
+            {
+                editedImage = CopyOnWriteImage::getClippedImage(getSource(), imageSize.removeFromTop(100));
+                break;
+            }
+
             editedImage = cachedImage.getClippedImage(imageSize.removeFromTop(100));
             break;
         }
@@ -200,15 +294,35 @@ private:
         case Mode::clipCopyAndConvert:
         {
             auto croppedSize = imageSize.removeFromTop(100);
+            int lineNumber = 33;
+
+            if (copyOnWrite)
+            {
+                //
+                // Copy-on-write images are already in memory, so there's no conversion; only the one
+                // row being written is copied
+                //
+                editedImage = CopyOnWriteImage::getClippedImage(getSource(), croppedSize);
+                editedImage = editedImage.createCopy();
+
+                Image::BitmapData bitmapData{ editedImage, 0, lineNumber, editedImage.getWidth(), 1, Image::BitmapData::readWrite };
+                PixelARGB* line = (PixelARGB*)bitmapData.getLinePointer(0);
+                for (int x = 0; x < bitmapData.width; ++x)
+                {
+                    line[x].setARGB(0xff, 0xff, 0, 0);
+                }
+
+                break;
+            }
+
             editedImage = cachedImage.getClippedImage(croppedSize);
             editedImage = editedImage.createCopy();
-            editedImage = juce::SoftwareImageType{} .convert(editedImage);
+            editedImage = vectorisedToggle.getToggleState() ? converter.convertedToSoftwareImage(editedImage) : PixelBufferPool::Type{}.convert(editedImage);
 
             Image::BitmapData bitmapData{ editedImage, Image::BitmapData::readWrite };
             jassert(bitmapData.width == croppedSize.getWidth());
             jassert(bitmapData.height == croppedSize.getHeight());
 
-            int lineNumber = 33;
             PixelARGB* line = (PixelARGB*)bitmapData.getLinePointer(lineNumber);
             for (int x = 0; x < bitmapData.width; ++x)
             {
@@ -217,6 +331,151 @@ private:
 
             break;
         }
+
+        case Mode::rescaledBenchmark:
+        {
+            editedImage = cachedImage;
+            runRescaledBenchmark();
+            break;
+        }
+
+        case Mode::conversionBenchmark:
+        {
+            editedImage = cachedImage;
+            runConversionBenchmark();
+            break;
+        }
+        }
+    }
+
+    static constexpr double secondsPerBenchmark = 0.25;
+
+    //
+    // Runs the operation repeatedly for secondsPerBenchmark and returns megapixels per second, counting
+    // the pixels in each returned image
+    //
+    static double measureMegapixelsPerSecond(std::function<juce::Image()> operation)
+    {
+        juce::int64 numPixels = 0;
+        auto start = juce::Time::getHighResolutionTicks();
+        double elapsedSeconds = 0.0;
+
+        do
+        {
+            auto result = operation();
+            numPixels += (juce::int64)result.getWidth() * result.getHeight();
+            elapsedSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        } while (elapsedSeconds < secondsPerBenchmark);
+
+        return (double)numPixels / elapsedSeconds / 1.0e6;
+    }
+
+    void addBenchmarkResult(juce::String const& name, juce::String const& juceName, double juceRate, double vectorisedRate)
+    {
+        benchmarkResults.add(name + ": " + juceName + " " + juce::String{ juceRate, 1 }
+            + " MP/s, vectorised " + juce::String{ vectorisedRate, 1 } + " MP/s ("
+            + juce::String{ vectorisedRate / juce::jmax(juceRate, 1.0e-9), 1 } + "x)");
+    }
+
+    //
+    // Shrinks and enlarges a software copy of the cached image at each resampling quality, with
+    // Image::rescaled and with the vectorised resampler, and reports destination megapixels per second
+    //
+    void runRescaledBenchmark()
+    {
+        auto source = juce::SoftwareImageType{}.convert(cachedImage);
+        std::pair<char const*, float> const scales[] = { { "shrink", 0.75f }, { "enlarge", 1.5f } };
+        juce::String const qualityNames[] = { "Low", "Medium", "High" };
+
+        benchmarkResults.clear();
+        benchmarkResults.add("Source " + juce::String{ source.getWidth() } + "x" + juce::String{ source.getHeight() } + ", "
+            + juce::String{ juce::SystemStats::getNumCpus() } + " CPUs");
+        benchmarkResults.add({});
+
+        for (auto const& [name, scale] : scales)
+        {
+            auto width = juce::roundToInt((float)source.getWidth() * scale);
+            auto height = juce::roundToInt((float)source.getHeight() * scale);
+
+            for (int quality = juce::Graphics::lowResamplingQuality; quality <= juce::Graphics::highResamplingQuality; ++quality)
+            {
+                auto resamplingQuality = (juce::Graphics::ResamplingQuality)quality;
+                auto juceRate = measureMegapixelsPerSecond([&] { return source.rescaled(width, height, resamplingQuality); });
+                auto vectorisedRate = measureMegapixelsPerSecond([&] { return resampler.rescaled(source, width, height, resamplingQuality); });
+                addBenchmarkResult(qualityNames[quality] + " " + name, "Image::rescaled", juceRate, vectorisedRate);
+            }
+        }
+    }
+
+    //
+    // Converts a camera-frame sized software image between every pair of formats, and clears one of
+    // each format, with Image and with the vectorised kernels
+    //
+    void runConversionBenchmark()
+    {
+        juce::Image argb{ juce::Image::ARGB, 3840, 2160, false, juce::SoftwareImageType{} };
+
+        {
+            juce::Graphics g{ argb };
+            g.drawImage(cachedImage, argb.getBounds().toFloat());
+        }
+
+        std::pair<juce::Image::PixelFormat, char const*> const formats[] =
+        {
+            { juce::Image::ARGB, "ARGB" },
+            { juce::Image::RGB, "RGB" },
+            { juce::Image::SingleChannel, "SingleChannel" }
+        };
+
+        benchmarkResults.clear();
+        benchmarkResults.add("Source " + juce::String{ argb.getWidth() } + "x" + juce::String{ argb.getHeight() } + ", "
+            + juce::String{ juce::SystemStats::getNumCpus() } + " CPUs");
+        benchmarkResults.add({});
+
+        for (auto const& [sourceFormat, sourceName] : formats)
+        {
+            auto source = argb.convertedToFormat(sourceFormat);
+
+            for (auto const& [destFormat, destName] : formats)
+            {
+                if (destFormat == sourceFormat)
+                {
+                    continue;
+                }
+
+                auto juceRate = measureMegapixelsPerSecond([&] { return source.convertedToFormat(destFormat); });
+                auto vectorisedRate = measureMegapixelsPerSecond([&] { return converter.convertedToFormat(source, destFormat); });
+                addBenchmarkResult(juce::String{ sourceName } + " to " + destName, "convertedToFormat", juceRate, vectorisedRate);
+            }
+        }
+
+        benchmarkResults.add({});
+
+        for (auto const& [format, name] : formats)
+        {
+            auto image = argb.convertedToFormat(format);
+            auto colour = juce::Colours::limegreen.withAlpha(0.5f);
+
+            auto juceRate = measureMegapixelsPerSecond([&] { image.clear(image.getBounds(), colour); return image; });
+            auto vectorisedRate = measureMegapixelsPerSecond([&] { converter.clear(image, image.getBounds(), colour); return image; });
+            addBenchmarkResult(juce::String{ "clear " } + name, "Image::clear", juceRate, vectorisedRate);
+        }
+
+        {
+            auto juceRate = measureMegapixelsPerSecond([&]
+                {
+                    juce::Image::BitmapData bitmap{ argb, juce::Image::BitmapData::readWrite };
+                    for (int y = 0; y < bitmap.height; ++y)
+                    {
+                        for (int x = 0; x < bitmap.width; ++x)
+                        {
+                            ((juce::PixelARGB*)bitmap.getPixelPointer(x, y))->premultiply();
+                        }
+                    }
+                    return argb;
+                });
+            auto vectorisedRate = measureMegapixelsPerSecond([&] { converter.premultiply(argb); return argb; });
+            addBenchmarkResult("premultiply", "PixelARGB::premultiply", juceRate, vectorisedRate);
         }
     }
 
@@ -21,6 +21,11 @@
 
 #pragma once
 
+#include "StatTable.h"
+#include "PathOutlineCache.h"
+#include "SVGAssetLoader.h"
+#include "SpatialPathIndex.h"
+
 class SVGPathTest : public juce::Component, public juce::FileDragAndDropTarget
 {
 public:
@@ -64,6 +69,48 @@ public:
                 repaint();
             };
 
+        addAndMakeVisible(outlineCacheToggle);
+        outlineCacheToggle.onClick = [this]()
+            {
+                outlineCache.clear();
+                repaint();
+            };
+
+        addAndMakeVisible(lodToggle);
+        lodToggle.onClick = [this]()
+            {
+                updateLevelOfDetail();
+                repaint();
+            };
+
+        addAndMakeVisible(spatialIndexToggle);
+        spatialIndexToggle.onClick = [this]()
+            {
+                updateSpatialIndex();
+                repaint();
+            };
+
+        addAndMakeVisible(loadInfoLabel);
+        addChildComponent(progressBar);
+
+        fileCombo.setTextWhenNothingSelected("Drop SVG files here");
+        addAndMakeVisible(fileCombo);
+        fileCombo.onChange = [this] { showAsset(fileCombo.getSelectedItemIndex()); };
+
+        assetLoader.onAssetLoaded = [this](std::unique_ptr<SVGAssetLoader::Asset> asset)
+            {
+                addAsset(std::move(asset));
+            };
+
+        statTable.addAccumulator("SVG parse (ms)", parseTime);
+        statTable.addAccumulator("SVG parse peak (KB)", parsePeakKilobytes);
+        statTable.addAccumulator("SVG cache load (ms)", cacheLoadTime);
+        statTable.addAccumulator("LOD points drawn", levelOfDetail.pointsDrawn);
+        statTable.addAccumulator("Indexed elements drawn", spatialIndex.elementsDrawn);
+        statTable.addAccumulator("Outline cache hits (%)", outlineCache.outlineHitRate);
+        statTable.addAccumulator("Mask cache hits (%)", outlineCache.maskHitRate);
+        statTable.addAccumulator("Create outline (ms)", outlineCache.createOutlineTime);
+
         setSize(1024, 1024);
     }
 
@@ -78,13 +125,23 @@ public:
             strokeThicknessLabel.setBounds(r.withWidth(120));
             strokeThicknessSlider.setBounds(r.withX(strokeThicknessLabel.getRight()).withWidth(getWidth() - strokeThicknessLabel.getRight()));
 
-            r.translate(0, 30);
-            cacheToggle.setBounds(strokeThicknessSlider.getX(), r.getY(), 120, 30);
+            juce::Rectangle<int> toggleArea{ r.getX(), r.getBottom(), getWidth() - r.getX(), 60 };
+            auto toggleRow = toggleArea.removeFromTop(30);
+            cacheToggle.setBounds(toggleRow.removeFromLeft(120));
+            outlineCacheToggle.setBounds(toggleRow);
+            lodToggle.setBounds(toggleArea.removeFromLeft(120));
+            spatialIndexToggle.setBounds(toggleArea);
         }
 
         transformScaleLabel.setBounds(0, getHeight() - 30, 50, 30);
         yScaleSlider.setBounds(0, 0, 50, transformScaleLabel.getY());
         xScaleSlider.setBounds(transformScaleLabel.getRight(), transformScaleLabel.getY(), getWidth() - transformScaleLabel.getRight(), transformScaleLabel.getHeight());
+
+        fileCombo.setBounds(yScaleSlider.getRight() + 5, 10, 300, 30);
+        loadInfoLabel.setBounds(fileCombo.getBounds().translated(0, 35).withWidth(400));
+        progressBar.setBounds(fileCombo.getBounds().translated(0, 70));
+
+        statTable.setTopLeftPosition(getScreenPosition().translated(getWidth() - statTable.getWidth() - 5, getHeight() - statTable.getHeight() - 40));
     }
 
     void paint(juce::Graphics& g) override
@@ -98,16 +155,30 @@ public:
         auto xScale = (float)xScaleSlider.getValue();
         auto yScale = (float)yScaleSlider.getValue();
         auto localBounds = getLocalBounds().toFloat();
-        auto pathBounds = path.getBounds();
         auto transform = juce::AffineTransform::translation(getLocalBounds().getCentre().toFloat() - pathBounds.getCentre()).
             scaled(xScale, yScale, localBounds.getCentreX(), localBounds.getCentreY());
 
+        //
+        // When zoomed out, draw the coarsest simplified version of the path that's still within half a pixel
+        //
+        auto const& drawPath = lodToggle.getToggleState() ? levelOfDetail.select(path, g, transform) : path;
+
+        //
+        // When zoomed in, only draw the part of the path that's on screen
+        //
+        bool useSpatialIndex = spatialIndexToggle.getToggleState() && &drawPath == &path;
+
         switch (modeCombo.getSelectedId())
         {
         case Mode::fillPath:
         {
             g.setColour(juce::Colours::orchid);
-            g.fillPath(path, transform);
+            if (useSpatialIndex)
+                spatialIndex.fillPath(g, path, transform);
+            else if (outlineCacheToggle.getToggleState())
+                outlineCache.fillPath(g, drawPath, pathVersion, transform);
+            else
+                g.fillPath(drawPath, transform);
             break;
         }
 
@@ -115,7 +186,12 @@ public:
         {
             auto strokeType = createStrokeType();
             g.setColour(juce::Colours::cyan);
-            g.strokePath(path, strokeType, transform);
+            if (useSpatialIndex)
+                spatialIndex.strokePath(g, path, strokeType, transform);
+            else if (outlineCacheToggle.getToggleState())
+                outlineCache.strokePath(g, drawPath, pathVersion, strokeType, transform);
+            else
+                g.strokePath(drawPath, strokeType, transform);
             break;
         }
         }
@@ -123,22 +199,54 @@ public:
 
     void animate()
     {
+        progressBar.setVisible(assetLoader.isLoading());
+        loadProgress = assetLoader.getProgress();
+
         repaint();
     }
 
     bool isInterestedInFileDrag(const StringArray& files) override
     {
-        File file{ files[0] };
-        return file.hasFileExtension("svg");
+        for (auto const& filename : files)
+        {
+            if (File{ filename }.hasFileExtension("svg"))
+            {
+                return true;
+            }
+        }
+
+        return false;
     }
 
     void filesDropped(const StringArray& files, int, int) override
     {
-        File file{ files[0] };
-        auto svg = juce::Drawable::createFromImageFile(file);
-        if (svg)
+        //
+        // Parse and prepare the files on worker threads; each one is handed back to addAsset when it's ready
+        //
+        juce::Array<File> svgFiles;
+        for (auto const& filename : files)
         {
-            path = svg->getOutlineAsPath();
+            File file{ filename };
+            if (file.hasFileExtension("svg"))
+            {
+                svgFiles.add(file);
+            }
+        }
+
+        assetLoader.load(svgFiles, lodToggle.getToggleState());
+        progressBar.setVisible(true);
+    }
+
+    void parentHierarchyChanged() override
+    {
+        if (auto peer = getPeer())
+        {
+            statTable.addToDesktop(0, nullptr);
+            statTable.setAlwaysOnTop(true);
+        }
+        else
+        {
+            statTable.removeFromDesktop();
         }
     }
 
@@ -156,6 +264,13 @@ private:
     juce::Slider xScaleSlider{ juce::Slider::LinearHorizontal, juce::Slider::TextBoxLeft };
     juce::Slider yScaleSlider{ juce::Slider::LinearVertical, juce::Slider::TextBoxBelow };
     juce::ToggleButton cacheToggle{ "Cached" };
+    juce::ToggleButton outlineCacheToggle{ "Outline cache" };
+    juce::ToggleButton lodToggle{ "Level of detail" };
+    juce::ToggleButton spatialIndexToggle{ "Spatial index" };
+    juce::Label loadInfoLabel;
+    juce::ComboBox fileCombo;
+    double loadProgress = 0.0;
+    juce::ProgressBar progressBar{ loadProgress };
     juce::VBlankAttachment attachment{ this, [this]() { animate(); } };
     double lastMsec = juce::Time::getMillisecondCounterHiRes();
 
@@ -168,8 +283,111 @@ private:
     // Drawing a cached geometry realization is much faster than drawing a non-cached Path.
     //
     juce::Path path;
+    juce::uint64 pathVersion = 0;
+    juce::Rectangle<float> pathBounds;
     juce::Rectangle<int> pathPaintArea;
 
+    //
+    // Loaded files that aren't being shown. The one on screen has its path and level-of-detail
+    // hierarchy swapped into the members above, and swapped back out when another is selected.
+    //
+    SVGAssetLoader assetLoader;
+    std::vector<std::unique_ptr<SVGAssetLoader::Asset>> assets;
+    int currentAssetIndex = -1;
+
+    void addAsset(std::unique_ptr<SVGAssetLoader::Asset> asset)
+    {
+        if (asset->loadedFromCache)
+        {
+            cacheLoadTime.addValue(asset->parseMs);
+        }
+        else
+        {
+            parseTime.addValue(asset->parseMs);
+            if (! asset->usedDrawableFallback)
+            {
+                parsePeakKilobytes.addValue((double)asset->peakBytes / 1024.0);
+            }
+        }
+
+        assets.push_back(std::move(asset));
+        fileCombo.addItem(assets.back()->file.getFileName(), (int)assets.size());
+
+        //
+        // Show the first file that finishes; the rest wait in the combo box
+        //
+        if (currentAssetIndex < 0)
+        {
+            fileCombo.setSelectedItemIndex((int)assets.size() - 1, juce::sendNotificationSync);
+        }
+    }
+
+    void showAsset(int index)
+    {
+        if (index == currentAssetIndex || index < 0 || index >= (int)assets.size())
+        {
+            return;
+        }
+
+        if (currentAssetIndex >= 0)
+        {
+            auto& previous = *assets[(size_t)currentAssetIndex];
+            path.swapWithPath(previous.path);
+            levelOfDetail.swapLevels(previous.levelOfDetail);
+        }
+
+        auto& asset = *assets[(size_t)index];
+        path.swapWithPath(asset.path);
+        levelOfDetail.swapLevels(asset.levelOfDetail);
+        pathBounds = asset.bounds;
+        currentAssetIndex = index;
+        ++pathVersion;
+
+        //
+        // The level-of-detail toggle may have changed since this file was loaded
+        //
+        if (lodToggle.getToggleState() != (levelOfDetail.getNumLevels() > 0))
+        {
+            updateLevelOfDetail();
+        }
+
+        updateSpatialIndex();
+
+        if (asset.loadedFromCache)
+        {
+            loadInfoLabel.setText("Asset cache: " + juce::String{ asset.parseMs, 1 } + " ms, prepared in " + juce::String{ asset.prepareMs, 1 } + " ms",
+                juce::dontSendNotification);
+        }
+        else if (asset.usedDrawableFallback)
+        {
+            loadInfoLabel.setText("Drawable fallback (" + asset.fallbackReason + "): " + juce::String{ asset.parseMs, 1 } + " ms", juce::dontSendNotification);
+        }
+        else
+        {
+            loadInfoLabel.setText("Streamed: " + juce::String{ asset.parseMs, 1 } + " ms, peak " + juce::File::descriptionOfSizeInBytes((juce::int64)asset.peakBytes)
+                + ", prepared in " + juce::String{ asset.prepareMs, 1 } + " ms",
+                juce::dontSendNotification);
+        }
+
+        repaint();
+    }
+
+    void updateLevelOfDetail()
+    {
+        if (lodToggle.getToggleState())
+            levelOfDetail.build(path);
+        else
+            levelOfDetail.clear();
+    }
+
+    void updateSpatialIndex()
+    {
+        if (spatialIndexToggle.getToggleState())
+            spatialIndex.build(path);
+        else
+            spatialIndex.clear();
+    }
+
     juce::PathStrokeType createStrokeType() const noexcept
     {
         return juce::PathStrokeType{ (float)strokeThicknessSlider.getValue(),
@@ -177,6 +395,19 @@ private:
                 juce::PathStrokeType::EndCapStyle::rounded };
     }
 
+    PathLevelOfDetail levelOfDetail;
+    SpatialPathIndex spatialIndex;
+    juce::StatisticsAccumulator<double> parseTime;
+    juce::StatisticsAccumulator<double> parsePeakKilobytes;
+    juce::StatisticsAccumulator<double> cacheLoadTime;
+
+    //
+    // The software renderer doesn't cache anything between frames, so keep the stroked outline
+    // and its coverage mask here instead
+    //
+    PathOutlineCache outlineCache;
+    StatTable statTable{ this };
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SVGPathTest)
 };
 
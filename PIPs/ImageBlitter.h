@@ -0,0 +1,332 @@
+#pragma once
+
+#include "ImageResampler.h"
+
+//
+// Specialised software paths for drawing an ARGB image with an affine transform
+//
+// The software renderer sends every drawImageTransformed through its generic transformed-image filler,
+// whatever the transform. draw() looks at the transform first and picks one of:
+//
+//  translate    whole-pixel translation; drawn as a plain blit with drawImageAt
+//  scale        axis-aligned scale; rescaled to the destination size with the separable resampler's
+//               per-axis weight tables, snapped to whole pixels, then blitted
+//  span         anything else; each destination row walks the source with 16.16 fixed-point steps
+//               and samples bilinearly (SSE2 on Intel) into a destination-sized image, which is
+//               then blitted
+//
+// Anything the paths don't cover - other image formats, other renderers, fractional scale factors - goes
+// to Graphics::drawImageTransformed. Low resampling quality samples the nearest pixel, the same as the
+// renderer.
+//
+// The span walker treats pixels outside the image as transparent, so the image's edges come out soft
+// from the filter rather than from the renderer's antialiased outline. verify() draws both ways and
+// reports how far apart they are.
+//
+class ImageBlitter
+{
+public:
+    explicit ImageBlitter(ImageResampler& resampler_) :
+        resampler(resampler_),
+        rows(resampler_.getRows())
+    {
+    }
+
+    ~ImageBlitter() = default;
+
+    enum class Path
+    {
+        generic,
+        translate,
+        scale,
+        span
+    };
+
+    static juce::String getPathName(Path path)
+    {
+        switch (path)
+        {
+        case Path::generic: return "generic";
+        case Path::translate: return "translate";
+        case Path::scale: return "scale";
+        case Path::span: return "span";
+        }
+
+        return {};
+    }
+
+    //
+    // Draws like Graphics::drawImageTransformed and returns the path that was taken
+    //
+    Path draw(juce::Graphics& g, juce::Image const& image, juce::AffineTransform const& transform, juce::Graphics::ResamplingQuality quality)
+    {
+        auto& context = g.getInternalContext();
+        auto scaleFactor = context.getPhysicalPixelScaleFactor();
+
+        if (image.isNull()
+            || image.getFormat() != juce::Image::ARGB
+            || transform.isSingularity()
+            || dynamic_cast<juce::LowLevelGraphicsSoftwareRenderer*>(&context) == nullptr
+            || scaleFactor != std::floor(scaleFactor))
+        {
+            g.drawImageTransformed(image, transform);
+            return Path::generic;
+        }
+
+        auto start = juce::Time::getHighResolutionTicks();
+        auto physicalTransform = transform.scaled(scaleFactor);
+        auto destArea = image.getBounds().toFloat().transformedBy(physicalTransform).getSmallestIntegerContainer()
+            .getIntersection((g.getClipBounds().toFloat() * scaleFactor).getSmallestIntegerContainer());
+
+        auto path = Path::span;
+
+        if (physicalTransform.isOnlyTranslation() && isWholeNumber(physicalTransform.getTranslationX()) && isWholeNumber(physicalTransform.getTranslationY()))
+        {
+            path = Path::translate;
+            drawPhysical(g, image, { (int)physicalTransform.getTranslationX(), (int)physicalTransform.getTranslationY() }, scaleFactor);
+        }
+        else if (physicalTransform.mat01 == 0.0f && physicalTransform.mat10 == 0.0f && physicalTransform.mat00 > 0.0f && physicalTransform.mat11 > 0.0f)
+        {
+            //
+            // Rescaling the whole image only pays off if most of it is visible
+            //
+            auto placed = image.getBounds().toFloat().transformedBy(physicalTransform).toNearestInt();
+            if (! placed.isEmpty() && (juce::int64)placed.getWidth() * placed.getHeight() <= (juce::int64)destArea.getWidth() * destArea.getHeight() * 2)
+            {
+                path = Path::scale;
+                drawPhysical(g, resampler.rescaled(image, placed.getWidth(), placed.getHeight(), quality), placed.getPosition(), scaleFactor);
+            }
+        }
+
+        if (path == Path::span && ! destArea.isEmpty())
+        {
+            drawPhysical(g, transformed(image, physicalTransform, destArea, quality), destArea.getPosition(), scaleFactor);
+        }
+
+        blitTime.addValue(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0);
+        return path;
+    }
+
+    //
+    // The part of the transformed ARGB image that lands in destArea, as a software image the size of destArea
+    //
+    juce::Image transformed(juce::Image const& source, juce::AffineTransform const& transform, juce::Rectangle<int> destArea, juce::Graphics::ResamplingQuality quality)
+    {
+        juce::Image result{ juce::Image::ARGB, destArea.getWidth(), destArea.getHeight(), false, PixelBufferPool::Type{} };
+
+        juce::Image::BitmapData sourceData{ source, juce::Image::BitmapData::readOnly };
+        juce::Image::BitmapData destData{ result, juce::Image::BitmapData::writeOnly };
+
+        auto inverse = transform.inverted();
+        auto bilinear = quality != juce::Graphics::lowResamplingQuality;
+        auto stepX = toFixedPoint(inverse.mat00);
+        auto stepY = toFixedPoint(inverse.mat10);
+        auto multithreaded = (juce::int64)destArea.getWidth() * destArea.getHeight() >= ParallelRows::minPixelsToSplit;
+
+        rows.forEachRow(destArea.getHeight(), multithreaded, [&](int y)
+            {
+                //
+                // Source position of the first pixel centre in the row
+                //
+                auto destX = (double)destArea.getX() + 0.5;
+                auto destY = (double)(destArea.getY() + y) + 0.5;
+                auto sourceX = toFixedPoint(inverse.mat00 * destX + inverse.mat01 * destY + inverse.mat02);
+                auto sourceY = toFixedPoint(inverse.mat10 * destX + inverse.mat11 * destY + inverse.mat12);
+
+                auto destRow = reinterpret_cast<juce::uint32*>(destData.getLinePointer(y));
+                if (bilinear)
+                {
+                    sampleSpanBilinear(sourceData, destRow, destArea.getWidth(), sourceX, sourceY, stepX, stepY);
+                }
+                else
+                {
+                    sampleSpanNearest(sourceData, destRow, destArea.getWidth(), sourceX, sourceY, stepX, stepY);
+                }
+            });
+
+        return result;
+    }
+
+    struct Verification
+    {
+        Path path = Path::generic;
+        int maxError = 0;
+        double meanError = 0.0;
+    };
+
+    //
+    // Draws the image into two transparent software images of the given size, once with
+    // Graphics::drawImageTransformed and once with draw(), and compares them channel by channel
+    //
+    Verification verify(juce::Image const& image, juce::AffineTransform const& transform, juce::Graphics::ResamplingQuality quality, int width, int height)
+    {
+        juce::Image generic{ juce::Image::ARGB, width, height, true, juce::SoftwareImageType{} };
+        juce::Image specialised{ juce::Image::ARGB, width, height, true, juce::SoftwareImageType{} };
+        Verification verification;
+
+        {
+            juce::Graphics g{ generic };
+            g.setImageResamplingQuality(quality);
+            g.drawImageTransformed(image, transform);
+        }
+
+        {
+            juce::Graphics g{ specialised };
+            g.setImageResamplingQuality(quality);
+            verification.path = draw(g, image, transform, quality);
+        }
+
+        juce::Image::BitmapData genericData{ generic, juce::Image::BitmapData::readOnly };
+        juce::Image::BitmapData specialisedData{ specialised, juce::Image::BitmapData::readOnly };
+        juce::int64 totalError = 0;
+
+        for (int y = 0; y < height; ++y)
+        {
+            auto genericRow = genericData.getLinePointer(y);
+            auto specialisedRow = specialisedData.getLinePointer(y);
+
+            for (int index = 0; index < width * 4; ++index)
+            {
+                auto error = std::abs((int)genericRow[index] - (int)specialisedRow[index]);
+                verification.maxError = juce::jmax(verification.maxError, error);
+                totalError += error;
+            }
+        }
+
+        verification.meanError = (double)totalError / ((double)width * height * 4.0);
+        return verification;
+    }
+
+    juce::StatisticsAccumulator<double> blitTime;
+
+private:
+    ImageResampler& resampler;
+    ParallelRows& rows;
+
+    static constexpr int fixedPointBits = 16;
+
+    static juce::int64 toFixedPoint(double value) noexcept
+    {
+        return (juce::int64)std::floor(value * (double)(1 << fixedPointBits));
+    }
+
+    static bool isWholeNumber(float value) noexcept
+    {
+        return value == std::floor(value);
+    }
+
+    static void drawPhysical(juce::Graphics& g, juce::Image const& image, juce::Point<int> physicalPosition, float scaleFactor)
+    {
+        if (scaleFactor == 1.0f)
+        {
+            g.drawImageAt(image, physicalPosition.x, physicalPosition.y);
+            return;
+        }
+
+        juce::Graphics::ScopedSaveState saveState{ g };
+        g.addTransform(juce::AffineTransform::scale(1.0f / scaleFactor));
+        g.drawImageAt(image, physicalPosition.x, physicalPosition.y);
+    }
+
+    static juce::uint32 getPixel(juce::Image::BitmapData const& source, int x, int y) noexcept
+    {
+        if (x < 0 || y < 0 || x >= source.width || y >= source.height)
+        {
+            return 0;
+        }
+
+        return juce::readUnaligned<juce::uint32>(source.getPixelPointer(x, y));
+    }
+
+    static void sampleSpanNearest(juce::Image::BitmapData const& source, juce::uint32* dest, int numPixels,
+        juce::int64 sourceX, juce::int64 sourceY, juce::int64 stepX, juce::int64 stepY) noexcept
+    {
+        for (int x = 0; x < numPixels; ++x)
+        {
+            dest[x] = getPixel(source, (int)(sourceX >> fixedPointBits), (int)(sourceY >> fixedPointBits));
+            sourceX += stepX;
+            sourceY += stepY;
+        }
+    }
+
+    static void sampleSpanBilinear(juce::Image::BitmapData const& source, juce::uint32* dest, int numPixels,
+        juce::int64 sourceX, juce::int64 sourceY, juce::int64 stepX, juce::int64 stepY) noexcept
+    {
+        //
+        // Pixel centres are at half-pixel positions, so step back half a pixel to get the top-left tap
+        //
+        constexpr juce::int64 half = 1 << (fixedPointBits - 1);
+        sourceX -= half;
+        sourceY -= half;
+
+        for (int x = 0; x < numPixels; ++x)
+        {
+            auto left = (int)(sourceX >> fixedPointBits);
+            auto top = (int)(sourceY >> fixedPointBits);
+            auto fractionX = (int)(sourceX >> (fixedPointBits - 8)) & 255;
+            auto fractionY = (int)(sourceY >> (fixedPointBits - 8)) & 255;
+
+            juce::uint32 topLeft, topRight, bottomLeft, bottomRight;
+            if (left >= 0 && top >= 0 && left + 1 < source.width && top + 1 < source.height)
+            {
+                auto topRow = source.getPixelPointer(left, top);
+                auto bottomRow = topRow + source.lineStride;
+                topLeft = juce::readUnaligned<juce::uint32>(topRow);
+                topRight = juce::readUnaligned<juce::uint32>(topRow + 4);
+                bottomLeft = juce::readUnaligned<juce::uint32>(bottomRow);
+                bottomRight = juce::readUnaligned<juce::uint32>(bottomRow + 4);
+            }
+            else
+            {
+                topLeft = getPixel(source, left, top);
+                topRight = getPixel(source, left + 1, top);
+                bottomLeft = getPixel(source, left, top + 1);
+                bottomRight = getPixel(source, left + 1, top + 1);
+            }
+
+            dest[x] = blend(topLeft, topRight, bottomLeft, bottomRight, fractionX, fractionY);
+            sourceX += stepX;
+            sourceY += stepY;
+        }
+    }
+
+    //
+    // Horizontal then vertical lerp with 8-bit weights, rounding after each; each stage stays within 16 bits
+    //
+    static juce::uint32 blend(juce::uint32 topLeft, juce::uint32 topRight, juce::uint32 bottomLeft, juce::uint32 bottomRight,
+        int fractionX, int fractionY) noexcept
+    {
+#if JUCE_INTEL
+        auto const zero = _mm_setzero_si128();
+        auto const rounding = _mm_set1_epi16(128);
+        auto weightsX = _mm_unpacklo_epi64(_mm_set1_epi16((short)(256 - fractionX)), _mm_set1_epi16((short)fractionX));
+
+        auto lerpPair = [&](juce::uint32 a, juce::uint32 b)
+            {
+                auto pair = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128((int)a), _mm_cvtsi32_si128((int)b)), zero);
+                auto products = _mm_mullo_epi16(pair, weightsX);
+                return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(products, _mm_srli_si128(products, 8)), rounding), 8);
+            };
+
+        auto upper = _mm_mullo_epi16(lerpPair(topLeft, topRight), _mm_set1_epi16((short)(256 - fractionY)));
+        auto lower = _mm_mullo_epi16(lerpPair(bottomLeft, bottomRight), _mm_set1_epi16((short)fractionY));
+        auto result = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(upper, lower), rounding), 8);
+        return (juce::uint32)_mm_cvtsi128_si32(_mm_packus_epi16(result, zero));
+#else
+        juce::uint32 result = 0;
+
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            auto channel = [&](juce::uint32 pixel) { return (int)((pixel >> shift) & 0xff); };
+            auto upper = (channel(topLeft) * (256 - fractionX) + channel(topRight) * fractionX + 128) >> 8;
+            auto lower = (channel(bottomLeft) * (256 - fractionX) + channel(bottomRight) * fractionX + 128) >> 8;
+            auto value = (upper * (256 - fractionY) + lower * fractionY + 128) >> 8;
+            result |= (juce::uint32)value << shift;
+        }
+
+        return result;
+#endif
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ImageBlitter)
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+//
+// Keeps regenerable images under a memory budget, evicting the least recently used
+//
+// Each image is added as a regeneration callback and comes back as a Handle. Handle::get() returns
+// the image, calling the callback first if the image hasn't been made yet or has been evicted. Making an
+// image that takes the resident total over the budget evicts the least recently used images until it
+// fits again; the image being returned is never evicted, so an image bigger than the whole budget still
+// works.
+//
+// Eviction only drops the budget's reference. The memory is freed once nothing else holds the image, so
+// callers should get() the image when they draw it rather than keeping it in a member.
+//
+// The budget also listens to each image's pixel data. When the renderer reports the data as deleted,
+// for example when the Direct2D device is lost, the image is marked lost and remade on the next get().
+// The callback isn't run from the listener because the pixel data is still being torn down then.
+//
+// Share one budget across the app with SharedResourcePointer<ImageBudget>, declared before any
+// Handles so it outlives them. Everything here runs on the message thread.
+//
+class ImageBudget : public juce::ImagePixelData::Listener
+{
+public:
+    using Regenerate = std::function<juce::Image()>;
+
+    static constexpr size_t defaultBudgetBytes = 512 * 1024 * 1024;
+
+    ImageBudget() = default;
+
+    ~ImageBudget() override
+    {
+        for (auto& [pixelData, id] : idsByPixelData)
+        {
+            pixelData->listeners.remove(this);
+        }
+    }
+
+    class Handle
+    {
+    public:
+        Handle() = default;
+
+        Handle(Handle&& other) noexcept :
+            budget(std::exchange(other.budget, nullptr)),
+            id(other.id)
+        {
+        }
+
+        Handle& operator=(Handle&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                budget = std::exchange(other.budget, nullptr);
+                id = other.id;
+            }
+
+            return *this;
+        }
+
+        ~Handle()
+        {
+            reset();
+        }
+
+        juce::Image get() const
+        {
+            return budget != nullptr ? budget->use(id) : juce::Image{};
+        }
+
+        bool isResident() const
+        {
+            return budget != nullptr && budget->isResident(id);
+        }
+
+        void reset()
+        {
+            if (budget != nullptr)
+            {
+                budget->remove(id);
+                budget = nullptr;
+            }
+        }
+
+    private:
+        friend class ImageBudget;
+
+        Handle(ImageBudget& budget_, int id_) :
+            budget(&budget_),
+            id(id_)
+        {
+        }
+
+        ImageBudget* budget = nullptr;
+        int id = 0;
+
+        JUCE_DECLARE_NON_COPYABLE(Handle)
+    };
+
+    //
+    // Nothing is made until the first get()
+    //
+    Handle add(Regenerate regenerate)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        auto id = nextId++;
+        entries[id].regenerate = std::move(regenerate);
+        return Handle{ *this, id };
+    }
+
+    void setBudget(size_t newBudgetBytes)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        budgetBytes = newBudgetBytes;
+        evict(-1);
+    }
+
+    size_t getBudget() const noexcept { return budgetBytes; }
+
+    struct Metrics
+    {
+        int numImages = 0;
+        int numResident = 0;
+        size_t residentBytes = 0;
+        juce::int64 numRegenerations = 0;
+        juce::int64 numEvictions = 0;
+    };
+
+    Metrics getMetrics() const noexcept
+    {
+        return { (int)entries.size(), (int)leastRecentlyUsed.size(), residentBytes, numRegenerations, numEvictions };
+    }
+
+    void imageDataChanged(juce::ImagePixelData*) override
+    {
+    }
+
+    void imageDataBeingDeleted(juce::ImagePixelData* pixelData) override
+    {
+        if (auto found = idsByPixelData.find(pixelData); found != idsByPixelData.end())
+        {
+            entries[found->second].lost = true;
+        }
+    }
+
+private:
+    struct Entry
+    {
+        Regenerate regenerate;
+        juce::Image image;
+        size_t bytes = 0;
+        bool lost = false;
+        std::list<int>::iterator position;
+    };
+
+    std::map<int, Entry> entries;
+    std::map<juce::ImagePixelData*, int> idsByPixelData;
+
+    //
+    // Resident images, most recently used first
+    //
+    std::list<int> leastRecentlyUsed;
+
+    size_t budgetBytes = defaultBudgetBytes;
+    size_t residentBytes = 0;
+    int nextId = 1;
+    juce::int64 numRegenerations = 0;
+    juce::int64 numEvictions = 0;
+
+    static size_t getSizeInBytes(juce::Image const& image) noexcept
+    {
+        auto pixelStride = image.getFormat() == juce::Image::RGB ? 3 : (image.getFormat() == juce::Image::ARGB ? 4 : 1);
+        return (size_t)image.getWidth() * (size_t)image.getHeight() * (size_t)pixelStride;
+    }
+
+    bool isResident(int id) const
+    {
+        auto found = entries.find(id);
+        return found != entries.end() && found->second.image.isValid() && ! found->second.lost;
+    }
+
+    juce::Image use(int id)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        auto& entry = entries.at(id);
+
+        if (entry.image.isValid() && ! entry.lost)
+        {
+            leastRecentlyUsed.splice(leastRecentlyUsed.begin(), leastRecentlyUsed, entry.position);
+            return entry.image;
+        }
+
+        if (entry.image.getPixelData() != nullptr)
+        {
+            release(entry);
+        }
+
+        entry.image = entry.regenerate();
+        entry.lost = false;
+        ++numRegenerations;
+
+        if (auto pixelData = entry.image.getPixelData())
+        {
+            entry.bytes = getSizeInBytes(entry.image);
+            residentBytes += entry.bytes;
+            leastRecentlyUsed.push_front(id);
+            entry.position = leastRecentlyUsed.begin();
+
+            pixelData->listeners.add(this);
+            idsByPixelData[pixelData] = id;
+
+            evict(id);
+        }
+
+        return entry.image;
+    }
+
+    void evict(int idToKeep)
+    {
+        while (residentBytes > budgetBytes && ! leastRecentlyUsed.empty() && leastRecentlyUsed.back() != idToKeep)
+        {
+            auto id = leastRecentlyUsed.back();
+            release(entries.at(id));
+            ++numEvictions;
+        }
+    }
+
+    void release(Entry& entry)
+    {
+        if (auto pixelData = entry.image.getPixelData())
+        {
+            pixelData->listeners.remove(this);
+            idsByPixelData.erase(pixelData);
+
+            residentBytes -= entry.bytes;
+            leastRecentlyUsed.erase(entry.position);
+        }
+
+        entry.image = {};
+        entry.bytes = 0;
+    }
+
+    void remove(int id)
+    {
+        if (auto found = entries.find(id); found != entries.end())
+        {
+            release(found->second);
+            entries.erase(found);
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ImageBudget)
+};
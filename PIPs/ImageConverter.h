@@ -0,0 +1,520 @@
+#pragma once
+
+#include "ParallelRows.h"
+#include "PixelBufferPool.h"
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+//
+// Row-at-a-time pixel format conversion, clearing and premultiplication for software images
+//
+// Image::convertedToFormat and Image::clear go through per-pixel loops or the renderer. These kernels
+// work on whole rows instead: ARGB <-> SingleChannel, premultiplication and unpremultiplication use
+// SSE2 on Intel, the three-byte RGB conversions move four pixels at a time through 32-bit words, and
+// rows are split across threads for large images.
+//
+// Conversions match Image::convertedToFormat, except SingleChannel -> RGB:
+//
+//  ARGB -> RGB              premultiplied colour, as if drawn over black
+//  RGB -> ARGB              opaque
+//  ARGB -> SingleChannel    alpha
+//  RGB -> SingleChannel     opaque
+//  SingleChannel -> ARGB    white, premultiplied by the alpha, as PixelARGB::set(PixelAlpha) gives
+//  SingleChannel -> RGB     grey, the same as SingleChannel -> ARGB drawn over black
+//
+// Image::convertedToFormat makes SingleChannel -> RGB by drawing the mask in the default colour, black,
+// over a cleared image, so it always comes out black. Here the mask stays visible instead.
+//
+// Non-software sources are read through BitmapData and the result converted back to the source's
+// image type, the same as ImageResampler. clear() leaves non-software images to Image::clear, since
+// those are filled on the GPU.
+//
+class ImageConverter
+{
+public:
+    ImageConverter(int numThreads = juce::jmax(1, juce::SystemStats::getNumCpus() - 1)) :
+        rows(numThreads)
+    {
+    }
+
+    ~ImageConverter() = default;
+
+    juce::Image convertedToFormat(juce::Image const& source, juce::Image::PixelFormat newFormat)
+    {
+        if (source.isNull() || source.getFormat() == newFormat)
+        {
+            return source;
+        }
+
+        auto result = copyRows(source, newFormat);
+
+        if (! isSoftwareImage(source))
+        {
+            result = source.getPixelData()->createType()->convert(result);
+        }
+
+        return result;
+    }
+
+    //
+    // Same as ImageType::convert for a software destination, with the rows copied in parallel
+    //
+    juce::Image convertedToSoftwareImage(juce::Image const& source)
+    {
+        if (source.isNull() || isSoftwareImage(source))
+        {
+            return source;
+        }
+
+        return copyRows(source, source.getFormat());
+    }
+
+    void clear(juce::Image& image, juce::Rectangle<int> area, juce::Colour colour = {})
+    {
+        area = area.getIntersection(image.getBounds());
+        if (area.isEmpty())
+        {
+            return;
+        }
+
+        if (! isSoftwareImage(image))
+        {
+            image.clear(area, colour);
+            return;
+        }
+
+        auto start = juce::Time::getHighResolutionTicks();
+
+        {
+            juce::Image::BitmapData bitmap{ image, area.getX(), area.getY(), area.getWidth(), area.getHeight(), juce::Image::BitmapData::writeOnly };
+            auto pixel = colour.getPixelARGB();
+
+            rows.forEachRow(area.getHeight(), isWorthSplitting(area.getWidth(), area.getHeight()), [&](int y)
+                {
+                    fillRow(bitmap.getLinePointer(y), bitmap.pixelFormat, bitmap.pixelStride, area.getWidth(), pixel);
+                });
+        }
+
+        clearTime.addValue(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0);
+    }
+
+    //
+    // For moving ARGB pixels to and from straight-alpha buffers, such as camera frames; the image is
+    // modified in place, so an unpremultiplied image must be premultiplied again before it's drawn
+    //
+    void premultiply(juce::Image& image)
+    {
+        forEachARGBRow(image, [](juce::uint8* row, int width) { premultiplyRow(row, width); });
+    }
+
+    void unpremultiply(juce::Image& image)
+    {
+        forEachARGBRow(image, [](juce::uint8* row, int width) { unpremultiplyRow(row, width); });
+    }
+
+    juce::StatisticsAccumulator<double> convertTime;
+    juce::StatisticsAccumulator<double> clearTime;
+
+    //==============================================================================
+    static void convertRow(juce::uint8 const* source, juce::Image::PixelFormat sourceFormat, int sourcePixelStride,
+        juce::uint8* dest, juce::Image::PixelFormat destFormat, int destPixelStride, int width) noexcept
+    {
+        if (sourceFormat == destFormat && sourcePixelStride == destPixelStride)
+        {
+            std::memcpy(dest, source, (size_t)(width * destPixelStride));
+            return;
+        }
+
+        switch (destFormat)
+        {
+        case juce::Image::ARGB:
+            if (sourceFormat == juce::Image::SingleChannel)
+            {
+                alphaToARGB(source, sourcePixelStride, dest, width);
+            }
+            else
+            {
+                rgbToARGB(source, sourcePixelStride, dest, width);
+            }
+            break;
+
+        case juce::Image::RGB:
+            if (sourceFormat == juce::Image::SingleChannel)
+            {
+                alphaToRGB(source, sourcePixelStride, dest, width);
+            }
+            else
+            {
+                argbToRGB(source, sourcePixelStride, dest, width);
+            }
+            break;
+
+        case juce::Image::SingleChannel:
+            if (sourceFormat == juce::Image::ARGB)
+            {
+                argbToAlpha(source, sourcePixelStride, dest, width);
+            }
+            else
+            {
+                std::memset(dest, 0xff, (size_t)width);
+            }
+            break;
+
+        case juce::Image::UnknownFormat:
+            break;
+        }
+    }
+
+    static void premultiplyRow(juce::uint8* pixels, int width) noexcept
+    {
+        int x = 0;
+
+#if JUCE_INTEL
+        auto const zero = _mm_setzero_si128();
+        auto const rounding = _mm_set1_epi16(128);
+        auto const alphaMask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+
+        for (; x + 4 <= width; x += 4)
+        {
+            auto source = _mm_loadu_si128(reinterpret_cast<__m128i const*>(pixels + x * 4));
+            auto low = premultiplyPair(_mm_unpacklo_epi8(source, zero), rounding, alphaMask);
+            auto high = premultiplyPair(_mm_unpackhi_epi8(source, zero), rounding, alphaMask);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + x * 4), _mm_packus_epi16(low, high));
+        }
+#endif
+
+        for (; x < width; ++x)
+        {
+            auto pixel = pixels + x * 4;
+            auto alpha = (juce::uint32)pixel[juce::PixelARGB::indexA];
+
+            for (auto channel : { juce::PixelARGB::indexR, juce::PixelARGB::indexG, juce::PixelARGB::indexB })
+            {
+                auto product = pixel[channel] * alpha + 128;
+                pixel[channel] = (juce::uint8)((product + (product >> 8)) >> 8);
+            }
+        }
+    }
+
+    //
+    // Division doesn't vectorise in SSE2, so this uses a per-alpha 16.16 reciprocal instead. On Intel the
+    // reciprocals for four pixels are looked up and each channel is scaled four pixels at a time, giving
+    // the same result as the scalar loop.
+    //
+    static void unpremultiplyRow(juce::uint8* pixels, int width) noexcept
+    {
+        static auto const reciprocals = []
+            {
+                std::array<juce::uint32, 256> table{};
+                for (juce::uint32 alpha = 1; alpha < 256; ++alpha)
+                {
+                    table[alpha] = ((255u << 16) + alpha / 2) / alpha;
+                }
+                return table;
+            }();
+
+        int x = 0;
+
+#if JUCE_INTEL
+        auto const byteMask = _mm_set1_epi32(0xff);
+        auto const rounding = _mm_set1_epi32(0x8000);
+        auto const alphaMask = _mm_set1_epi32((int)(0xffu << (juce::PixelARGB::indexA * 8)));
+
+        for (; x + 4 <= width; x += 4)
+        {
+            auto pixel = pixels + x * 4;
+            auto source = _mm_loadu_si128(reinterpret_cast<__m128i const*>(pixel));
+            auto reciprocal = _mm_set_epi32((int)reciprocals[pixel[12 + juce::PixelARGB::indexA]],
+                (int)reciprocals[pixel[8 + juce::PixelARGB::indexA]],
+                (int)reciprocals[pixel[4 + juce::PixelARGB::indexA]],
+                (int)reciprocals[pixel[juce::PixelARGB::indexA]]);
+
+            auto result = _mm_and_si128(source, alphaMask);
+
+            for (auto channel : { juce::PixelARGB::indexR, juce::PixelARGB::indexG, juce::PixelARGB::indexB })
+            {
+                auto shift = _mm_cvtsi32_si128(channel * 8);
+                auto value = _mm_and_si128(_mm_srl_epi32(source, shift), byteMask);
+                auto scaled = _mm_srli_epi32(_mm_add_epi32(multiply32(value, reciprocal), rounding), 16);
+
+                auto overflow = _mm_cmpgt_epi32(scaled, byteMask);
+                scaled = _mm_or_si128(_mm_andnot_si128(overflow, scaled), _mm_and_si128(overflow, byteMask));
+                result = _mm_or_si128(result, _mm_sll_epi32(scaled, shift));
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pixel), result);
+        }
+#endif
+
+        for (; x < width; ++x)
+        {
+            auto pixel = pixels + x * 4;
+            auto reciprocal = reciprocals[pixel[juce::PixelARGB::indexA]];
+
+            for (auto channel : { juce::PixelARGB::indexR, juce::PixelARGB::indexG, juce::PixelARGB::indexB })
+            {
+                pixel[channel] = (juce::uint8)juce::jmin(255u, (pixel[channel] * reciprocal + 0x8000) >> 16);
+            }
+        }
+    }
+
+private:
+    ParallelRows rows;
+
+    static bool isSoftwareImage(juce::Image const& image)
+    {
+        return dynamic_cast<juce::SoftwareImageType*>(image.getPixelData()->createType().get()) != nullptr;
+    }
+
+    static bool isWorthSplitting(int width, int height) noexcept
+    {
+        return (juce::int64)width * height >= ParallelRows::minPixelsToSplit;
+    }
+
+    juce::Image copyRows(juce::Image const& source, juce::Image::PixelFormat newFormat)
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+        juce::Image result{ newFormat, source.getWidth(), source.getHeight(), false, PixelBufferPool::Type{} };
+
+        {
+            juce::Image::BitmapData sourceData{ source, juce::Image::BitmapData::readOnly };
+            juce::Image::BitmapData destData{ result, juce::Image::BitmapData::writeOnly };
+
+            rows.forEachRow(source.getHeight(), isWorthSplitting(source.getWidth(), source.getHeight()), [&](int y)
+                {
+                    convertRow(sourceData.getLinePointer(y), sourceData.pixelFormat, sourceData.pixelStride,
+                        destData.getLinePointer(y), destData.pixelFormat, destData.pixelStride, source.getWidth());
+                });
+        }
+
+        convertTime.addValue(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0);
+        return result;
+    }
+
+    template <typename RowFunction>
+    void forEachARGBRow(juce::Image& image, RowFunction&& rowFunction)
+    {
+        if (image.getFormat() != juce::Image::ARGB)
+        {
+            return;
+        }
+
+        juce::Image::BitmapData bitmap{ image, juce::Image::BitmapData::readWrite };
+        rows.forEachRow(image.getHeight(), isWorthSplitting(image.getWidth(), image.getHeight()), [&](int y)
+            {
+                rowFunction(bitmap.getLinePointer(y), image.getWidth());
+            });
+    }
+
+    //==============================================================================
+    //
+    // The RGB and ARGB layouts only line up for the word-at-a-time paths when RGB is the first three bytes
+    // of ARGB, which is the case everywhere except macOS
+    //
+#if JUCE_LITTLE_ENDIAN
+    static constexpr bool rgbMatchesARGB = (int)juce::PixelRGB::indexR == (int)juce::PixelARGB::indexR
+        && (int)juce::PixelRGB::indexG == (int)juce::PixelARGB::indexG
+        && (int)juce::PixelRGB::indexB == (int)juce::PixelARGB::indexB;
+#else
+    static constexpr bool rgbMatchesARGB = false;
+#endif
+
+    static void argbToRGB(juce::uint8 const* source, int sourcePixelStride, juce::uint8* dest, int width) noexcept
+    {
+        int x = 0;
+
+        if (rgbMatchesARGB && sourcePixelStride == 4)
+        {
+            for (; x + 4 <= width; x += 4)
+            {
+                auto p0 = juce::readUnaligned<juce::uint32>(source + x * 4);
+                auto p1 = juce::readUnaligned<juce::uint32>(source + x * 4 + 4);
+                auto p2 = juce::readUnaligned<juce::uint32>(source + x * 4 + 8);
+                auto p3 = juce::readUnaligned<juce::uint32>(source + x * 4 + 12);
+
+                juce::writeUnaligned<juce::uint32>(dest + x * 3, (p0 & 0xffffff) | (p1 << 24));
+                juce::writeUnaligned<juce::uint32>(dest + x * 3 + 4, ((p1 >> 8) & 0xffff) | (p2 << 16));
+                juce::writeUnaligned<juce::uint32>(dest + x * 3 + 8, ((p2 >> 16) & 0xff) | (p3 << 8));
+            }
+        }
+
+        for (; x < width; ++x)
+        {
+            auto pixel = source + x * sourcePixelStride;
+            dest[x * 3 + juce::PixelRGB::indexR] = pixel[juce::PixelARGB::indexR];
+            dest[x * 3 + juce::PixelRGB::indexG] = pixel[juce::PixelARGB::indexG];
+            dest[x * 3 + juce::PixelRGB::indexB] = pixel[juce::PixelARGB::indexB];
+        }
+    }
+
+    static void rgbToARGB(juce::uint8 const* source, int sourcePixelStride, juce::uint8* dest, int width) noexcept
+    {
+        int x = 0;
+
+        if (rgbMatchesARGB && sourcePixelStride == 3)
+        {
+            auto const opaque = 0xff000000u;
+
+            for (; x + 4 <= width; x += 4)
+            {
+                auto w0 = juce::readUnaligned<juce::uint32>(source + x * 3);
+                auto w1 = juce::readUnaligned<juce::uint32>(source + x * 3 + 4);
+                auto w2 = juce::readUnaligned<juce::uint32>(source + x * 3 + 8);
+
+                juce::writeUnaligned<juce::uint32>(dest + x * 4, w0 | opaque);
+                juce::writeUnaligned<juce::uint32>(dest + x * 4 + 4, (w0 >> 24) | (w1 << 8) | opaque);
+                juce::writeUnaligned<juce::uint32>(dest + x * 4 + 8, (w1 >> 16) | (w2 << 16) | opaque);
+                juce::writeUnaligned<juce::uint32>(dest + x * 4 + 12, (w2 >> 8) | opaque);
+            }
+        }
+
+        for (; x < width; ++x)
+        {
+            auto pixel = source + x * sourcePixelStride;
+            auto destPixel = dest + x * 4;
+            destPixel[juce::PixelARGB::indexA] = 0xff;
+            destPixel[juce::PixelARGB::indexR] = pixel[juce::PixelRGB::indexR];
+            destPixel[juce::PixelARGB::indexG] = pixel[juce::PixelRGB::indexG];
+            destPixel[juce::PixelARGB::indexB] = pixel[juce::PixelRGB::indexB];
+        }
+    }
+
+    static void argbToAlpha(juce::uint8 const* source, int sourcePixelStride, juce::uint8* dest, int width) noexcept
+    {
+        int x = 0;
+
+#if JUCE_INTEL
+        if (sourcePixelStride == 4)
+        {
+            for (; x + 16 <= width; x += 16)
+            {
+                auto a = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(source + x * 4)), 24);
+                auto b = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(source + x * 4 + 16)), 24);
+                auto c = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(source + x * 4 + 32)), 24);
+                auto d = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(source + x * 4 + 48)), 24);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+            }
+        }
+#endif
+
+        for (; x < width; ++x)
+        {
+            dest[x] = source[x * sourcePixelStride + juce::PixelARGB::indexA];
+        }
+    }
+
+    static void alphaToARGB(juce::uint8 const* source, int sourcePixelStride, juce::uint8* dest, int width) noexcept
+    {
+        int x = 0;
+
+#if JUCE_INTEL
+        if (sourcePixelStride == 1)
+        {
+            for (; x + 16 <= width; x += 16)
+            {
+                //
+                // Duplicating each byte twice turns a into (a, a, a, a)
+                //
+                auto alpha = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + x));
+                auto low = _mm_unpacklo_epi8(alpha, alpha);
+                auto high = _mm_unpackhi_epi8(alpha, alpha);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x * 4), _mm_unpacklo_epi16(low, low));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x * 4 + 16), _mm_unpackhi_epi16(low, low));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x * 4 + 32), _mm_unpacklo_epi16(high, high));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x * 4 + 48), _mm_unpackhi_epi16(high, high));
+            }
+        }
+#endif
+
+        for (; x < width; ++x)
+        {
+            juce::writeUnaligned<juce::uint32>(dest + x * 4, source[x * sourcePixelStride] * 0x01010101u);
+        }
+    }
+
+    static void alphaToRGB(juce::uint8 const* source, int sourcePixelStride, juce::uint8* dest, int width) noexcept
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            auto alpha = source[x * sourcePixelStride];
+            dest[x * 3] = alpha;
+            dest[x * 3 + 1] = alpha;
+            dest[x * 3 + 2] = alpha;
+        }
+    }
+
+#if JUCE_INTEL
+    //
+    // Two pixels as 16-bit channels; c * a / 255 rounded, computed as (t + (t >> 8)) >> 8 with t = c * a + 128
+    //
+    static __m128i premultiplyPair(__m128i pixels, __m128i rounding, __m128i alphaMask) noexcept
+    {
+        auto alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        auto product = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), rounding);
+        auto scaled = _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+        return _mm_or_si128(_mm_andnot_si128(alphaMask, scaled), _mm_and_si128(alphaMask, pixels));
+    }
+
+    //
+    // Low 32 bits of each lane's product; SSE2 only multiplies the even lanes, so the odd lanes are
+    // shifted down and multiplied separately
+    //
+    static __m128i multiply32(__m128i a, __m128i b) noexcept
+    {
+        auto even = _mm_mul_epu32(a, b);
+        auto odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+#endif
+
+    static void fillRow(juce::uint8* dest, juce::Image::PixelFormat format, int pixelStride, int width, juce::PixelARGB pixel) noexcept
+    {
+        switch (format)
+        {
+        case juce::Image::ARGB:
+        {
+            int x = 0;
+            auto value = pixel.getNativeARGB();
+
+#if JUCE_INTEL
+            auto pattern = _mm_set1_epi32((int)value);
+            for (; x + 4 <= width; x += 4)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x * 4), pattern);
+            }
+#endif
+
+            for (; x < width; ++x)
+            {
+                juce::writeUnaligned<juce::uint32>(dest + x * 4, value);
+            }
+            break;
+        }
+
+        case juce::Image::RGB:
+        {
+            juce::uint8 rgb[3];
+            rgb[juce::PixelRGB::indexR] = pixel.getRed();
+            rgb[juce::PixelRGB::indexG] = pixel.getGreen();
+            rgb[juce::PixelRGB::indexB] = pixel.getBlue();
+
+            for (int x = 0; x < width; ++x)
+            {
+                std::memcpy(dest + x * pixelStride, rgb, 3);
+            }
+            break;
+        }
+
+        case juce::Image::SingleChannel:
+            std::memset(dest, pixel.getAlpha(), (size_t)width);
+            break;
+
+        case juce::Image::UnknownFormat:
+            break;
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ImageConverter)
+};
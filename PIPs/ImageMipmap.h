@@ -0,0 +1,163 @@
+#pragma once
+
+#include "ImageResampler.h"
+
+//
+// Lazily built mip chain for an image that's drawn at many sizes
+//
+// Each level is half the size of the one above it, box filtered from it, down to 1x1. Levels are only
+// built when a draw first needs them, and the whole chain is thrown away when the image's pixel data
+// reports a change through ImagePixelData::Listener, so editing the image can't leave stale levels.
+//
+// The image is passed to each draw() rather than kept, so the chain never holds the full-size image
+// alive; drawing a different image, or the image's pixel data being deleted, starts a new chain.
+//
+// draw() picks the level whose size is nearest above the destination size and lets the renderer do the
+// remaining (less than 2x) scaling. With trilinear on, the next smaller level is drawn over it with an
+// opacity given by the fractional level; that's an exact blend for opaque images and close for
+// translucent ones.
+//
+// This is meant for the software renderer; Direct2D does its own filtering on the GPU.
+//
+class ImageMipmap : public juce::ImagePixelData::Listener
+{
+public:
+    explicit ImageMipmap(ImageResampler& resampler_) :
+        resampler(resampler_)
+    {
+    }
+
+    ~ImageMipmap() override
+    {
+        setSource(nullptr);
+    }
+
+    int getNumLevelsBuilt() const noexcept { return (int)levels.size(); }
+
+    void draw(juce::Graphics& g, juce::Image const& image, juce::AffineTransform const& transform, bool trilinear)
+    {
+        if (image.isNull())
+        {
+            return;
+        }
+
+        setSource(image.getPixelData());
+
+        //
+        // The larger of the two axis scales, so neither axis ever gets magnified from a smaller level
+        //
+        auto xScale = std::hypot(transform.mat00, transform.mat10);
+        auto yScale = std::hypot(transform.mat01, transform.mat11);
+        auto scale = juce::jmax(xScale, yScale) * g.getInternalContext().getPhysicalPixelScaleFactor();
+
+        if (scale >= 1.0f || scale <= 0.0f)
+        {
+            g.drawImageTransformed(image, transform);
+            return;
+        }
+
+        auto levelPosition = std::log2(1.0f / scale);
+        auto index = (int)levelPosition;
+        auto level = getLevel(image, index);
+        drawLevel(g, image, level, transform);
+
+        auto fraction = levelPosition - (float)index;
+        if (trilinear && fraction > 0.0f)
+        {
+            auto smallerLevel = getLevel(image, index + 1);
+            if (smallerLevel.getPixelData() != level.getPixelData())
+            {
+                juce::Graphics::ScopedSaveState saveState{ g };
+                g.setOpacity(fraction);
+                drawLevel(g, image, smallerLevel, transform);
+            }
+        }
+    }
+
+    void imageDataChanged(juce::ImagePixelData*) override
+    {
+        levels.clear();
+    }
+
+    void imageDataBeingDeleted(juce::ImagePixelData*) override
+    {
+        levels.clear();
+        source = nullptr;
+    }
+
+    juce::StatisticsAccumulator<double> buildTime;
+
+private:
+    ImageResampler& resampler;
+
+    //
+    // The pixel data the levels were built from; only compared and listened to, never dereferenced
+    // after it's been deleted
+    //
+    juce::ImagePixelData* source = nullptr;
+
+    //
+    // levels[0] is half the size of the image
+    //
+    std::vector<juce::Image> levels;
+
+    //
+    void setSource(juce::ImagePixelData* newSource)
+    {
+        if (newSource == source)
+        {
+            return;
+        }
+
+        if (source != nullptr)
+        {
+            source->listeners.remove(this);
+        }
+
+        source = newSource;
+        levels.clear();
+
+        if (source != nullptr)
+        {
+            source->listeners.add(this);
+        }
+    }
+
+    //
+    // Level 0 is the image itself; asking for a level past the 1x1 level returns the 1x1 level
+    //
+    juce::Image getLevel(juce::Image const& image, int index)
+    {
+        while ((int)levels.size() < index)
+        {
+            auto larger = levels.empty() ? image : levels.back();
+            if (larger.getWidth() == 1 && larger.getHeight() == 1)
+            {
+                break;
+            }
+
+            auto start = juce::Time::getHighResolutionTicks();
+            levels.push_back(resampler.rescaled(larger,
+                juce::jmax(1, larger.getWidth() / 2),
+                juce::jmax(1, larger.getHeight() / 2),
+                juce::Graphics::lowResamplingQuality));
+            buildTime.addValue(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0);
+        }
+
+        if (index <= 0 || levels.empty())
+        {
+            return image;
+        }
+
+        return levels[(size_t)juce::jmin(index, (int)levels.size()) - 1];
+    }
+
+    static void drawLevel(juce::Graphics& g, juce::Image const& image, juce::Image const& level, juce::AffineTransform const& transform)
+    {
+        auto levelToImage = juce::AffineTransform::scale((float)image.getWidth() / (float)level.getWidth(),
+            (float)image.getHeight() / (float)level.getHeight());
+        g.drawImageTransformed(level, levelToImage.followedBy(transform));
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ImageMipmap)
+};
@@ -0,0 +1,461 @@
+#pragma once
+
+#include "ParallelRows.h"
+#include "PixelBufferPool.h"
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+//
+// Separable, multithreaded replacement for Image::rescaled
+//
+// The image is resampled in two passes: each source row is filtered horizontally into an intermediate
+// buffer, then each destination row is filtered vertically from the intermediate rows. The filter taps
+// for every destination column and row are worked out once per call as 14-bit fixed-point weights, so
+// the inner loops are just multiply-adds; on Intel they use SSE2 madd on pairs of taps.
+//
+// The filter depends on the resampling quality:
+//
+//  lowResamplingQuality       box
+//  mediumResamplingQuality    bilinear (triangle)
+//  highResamplingQuality      Lanczos, three lobes
+//
+// When shrinking, the filter is widened by the scale factor so every source pixel contributes. ARGB
+// pixels are premultiplied, so after each pass the colour channels are clamped to alpha; Lanczos
+// overshoot would otherwise produce invalid pixels.
+//
+// Both passes are split across threads by rows once the image is large enough to be worth it.
+//
+class ImageResampler
+{
+public:
+    ImageResampler(int numThreads = juce::jmax(1, juce::SystemStats::getNumCpus() - 1)) :
+        rows(numThreads)
+    {
+    }
+
+    ~ImageResampler() = default;
+
+    //
+    // The resampler's thread pool; helpers that work alongside the resampler share it rather than
+    // starting their own
+    //
+    ParallelRows& getRows() noexcept
+    {
+        return rows;
+    }
+
+    enum class Filter
+    {
+        box,
+        bilinear,
+        lanczos3
+    };
+
+    static Filter getFilter(juce::Graphics::ResamplingQuality quality) noexcept
+    {
+        switch (quality)
+        {
+        case juce::Graphics::lowResamplingQuality: return Filter::box;
+        case juce::Graphics::mediumResamplingQuality: return Filter::bilinear;
+        case juce::Graphics::highResamplingQuality: break;
+        }
+
+        return Filter::lanczos3;
+    }
+
+    //
+    // Same contract as Image::rescaled; the result has the same format and image type as the source
+    //
+    juce::Image rescaled(juce::Image const& source, int newWidth, int newHeight, juce::Graphics::ResamplingQuality quality)
+    {
+        if (source.isNull() || (source.getWidth() == newWidth && source.getHeight() == newHeight))
+        {
+            return source;
+        }
+
+        if (newWidth <= 0 || newHeight <= 0)
+        {
+            return {};
+        }
+
+        juce::Image result{ source.getFormat(), newWidth, newHeight, false, PixelBufferPool::Type{} };
+        rescaleInto(source, result, quality);
+
+        if (dynamic_cast<juce::SoftwareImageType*>(source.getPixelData()->createType().get()) == nullptr)
+        {
+            result = source.getPixelData()->createType()->convert(result);
+        }
+
+        return result;
+    }
+
+    //
+    // Resamples the whole source to fill an existing image of the same format, such as a pooled buffer
+    //
+    void rescaleInto(juce::Image const& source, juce::Image& dest, juce::Graphics::ResamplingQuality quality)
+    {
+        jassert(source.getFormat() == dest.getFormat());
+
+        auto newWidth = dest.getWidth();
+        auto newHeight = dest.getHeight();
+        auto start = juce::Time::getHighResolutionTicks();
+        auto filter = getFilter(quality);
+        auto horizontal = createWeights(source.getWidth(), newWidth, filter);
+        auto vertical = createWeights(source.getHeight(), newHeight, filter);
+
+        {
+            juce::Image::BitmapData sourceData{ source, juce::Image::BitmapData::readOnly };
+            juce::Image::BitmapData destData{ dest, juce::Image::BitmapData::writeOnly };
+
+            auto numChannels = destData.pixelStride;
+            auto premultiplied = source.getFormat() == juce::Image::ARGB;
+            auto rowBytes = newWidth * numChannels;
+            auto intermediateStride = (size_t)(rowBytes + 15) & ~(size_t)15;
+            intermediate.malloc(intermediateStride * (size_t)source.getHeight());
+
+            auto multithreaded = (juce::int64)newWidth * juce::jmax(newHeight, source.getHeight()) >= ParallelRows::minPixelsToSplit;
+
+            rows.forEachRow(source.getHeight(), multithreaded, [&](int y)
+                {
+                    auto sourceRow = sourceData.getLinePointer(y);
+                    auto intermediateRow = intermediate.get() + intermediateStride * (size_t)y;
+
+#if JUCE_INTEL
+                    if (premultiplied && sourceData.pixelStride == 4)
+                    {
+                        resampleRowARGB(sourceRow, intermediateRow, horizontal, newWidth);
+                        return;
+                    }
+#endif
+                    resampleRow(sourceRow, sourceData.pixelStride, intermediateRow, numChannels, premultiplied, horizontal, newWidth);
+                });
+
+            rows.forEachRow(newHeight, multithreaded, [&](int y)
+                {
+                    resampleColumns(intermediate.get() + intermediateStride * (size_t)vertical.starts[(size_t)y], intermediateStride,
+                        destData.getLinePointer(y), rowBytes, premultiplied, vertical.get(y), vertical.counts[(size_t)y]);
+                });
+        }
+
+        rescaleTime.addValue(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0);
+    }
+
+    juce::StatisticsAccumulator<double> rescaleTime;
+
+private:
+    static constexpr int weightBits = 14;
+    static constexpr int weightOne = 1 << weightBits;
+
+    ParallelRows rows;
+    juce::HeapBlock<juce::uint8> intermediate;
+
+    //
+    // Filter taps for each destination pixel along one axis; every pixel gets maxTaps coefficients,
+    // of which the first counts[i] are used
+    //
+    struct Weights
+    {
+        std::vector<int> starts;
+        std::vector<int> counts;
+        std::vector<juce::int16> coefficients;
+        int maxTaps = 0;
+
+        juce::int16 const* get(int index) const noexcept
+        {
+            return coefficients.data() + (size_t)index * (size_t)maxTaps;
+        }
+    };
+
+    static double getSupport(Filter filter) noexcept
+    {
+        switch (filter)
+        {
+        case Filter::box: return 0.5;
+        case Filter::bilinear: return 1.0;
+        case Filter::lanczos3: break;
+        }
+
+        return 3.0;
+    }
+
+    static double evaluate(Filter filter, double x) noexcept
+    {
+        switch (filter)
+        {
+        case Filter::box:
+            return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+
+        case Filter::bilinear:
+            return juce::jmax(0.0, 1.0 - std::abs(x));
+
+        case Filter::lanczos3:
+            break;
+        }
+
+        if (x == 0.0)
+        {
+            return 1.0;
+        }
+
+        if (std::abs(x) >= 3.0)
+        {
+            return 0.0;
+        }
+
+        auto piX = juce::MathConstants<double>::pi * x;
+        return 3.0 * std::sin(piX) * std::sin(piX / 3.0) / (piX * piX);
+    }
+
+    static Weights createWeights(int sourceSize, int destSize, Filter filter)
+    {
+        auto scale = (double)sourceSize / (double)destSize;
+        auto filterScale = juce::jmax(1.0, scale);
+        auto support = getSupport(filter) * filterScale;
+
+        Weights weights;
+        weights.maxTaps = (int)std::ceil(support * 2.0) + 2;
+        weights.starts.resize((size_t)destSize);
+        weights.counts.resize((size_t)destSize);
+        weights.coefficients.resize((size_t)destSize * (size_t)weights.maxTaps);
+
+        std::vector<double> taps((size_t)weights.maxTaps);
+
+        for (int index = 0; index < destSize; ++index)
+        {
+            //
+            // Pixel centres are at +0.5, so source pixel j contributes if |j + 0.5 - centre| < support
+            //
+            auto centre = ((double)index + 0.5) * scale;
+            auto first = juce::jmax(0, (int)std::floor(centre - support + 0.5));
+            auto end = juce::jmin(sourceSize, (int)std::ceil(centre + support + 0.5));
+            auto count = juce::jmin(end - first, weights.maxTaps);
+
+            double sum = 0.0;
+            for (int tap = 0; tap < count; ++tap)
+            {
+                taps[(size_t)tap] = evaluate(filter, ((double)(first + tap) + 0.5 - centre) / filterScale);
+                sum += taps[(size_t)tap];
+            }
+
+            //
+            // Trim zero taps off both ends; if nothing's left, take the nearest pixel
+            //
+            while (count > 0 && taps[(size_t)count - 1] == 0.0)
+            {
+                --count;
+            }
+
+            int leading = 0;
+            while (leading < count && taps[(size_t)leading] == 0.0)
+            {
+                ++leading;
+            }
+
+            if (count == 0 || sum == 0.0)
+            {
+                first = juce::jlimit(0, sourceSize - 1, (int)centre);
+                count = 1;
+                leading = 0;
+                taps[0] = sum = 1.0;
+            }
+
+            first += leading;
+            count -= leading;
+
+            auto coefficients = weights.coefficients.data() + (size_t)index * (size_t)weights.maxTaps;
+            int total = 0;
+            int largest = 0;
+            for (int tap = 0; tap < count; ++tap)
+            {
+                auto tapWeight = taps[(size_t)(tap + leading)];
+                coefficients[tap] = (juce::int16)juce::roundToInt(tapWeight / sum * weightOne);
+                total += coefficients[tap];
+
+                if (tapWeight > taps[(size_t)(largest + leading)])
+                {
+                    largest = tap;
+                }
+            }
+
+            //
+            // Put the rounding error on the largest tap so the weights sum to exactly one
+            //
+            coefficients[largest] = (juce::int16)(coefficients[largest] + weightOne - total);
+
+            weights.starts[(size_t)index] = first;
+            weights.counts[(size_t)index] = count;
+        }
+
+        return weights;
+    }
+
+    //==============================================================================
+    static juce::uint8 clampToByte(int value) noexcept
+    {
+        return (juce::uint8)juce::jlimit(0, 255, (value + (weightOne >> 1)) >> weightBits);
+    }
+
+    //
+    // Colour channels of a premultiplied pixel can't exceed its alpha
+    //
+    static void clampToAlpha(juce::uint8* pixel) noexcept
+    {
+        auto alpha = pixel[juce::PixelARGB::indexA];
+        for (int channel = 0; channel < 4; ++channel)
+        {
+            pixel[channel] = juce::jmin(pixel[channel], alpha);
+        }
+    }
+
+    static void resampleRow(juce::uint8 const* source, int sourcePixelStride, juce::uint8* dest, int numChannels, bool premultiplied,
+        Weights const& weights, int destWidth) noexcept
+    {
+        for (int x = 0; x < destWidth; ++x)
+        {
+            auto sourcePixel = source + weights.starts[(size_t)x] * sourcePixelStride;
+            auto coefficients = weights.get(x);
+            auto count = weights.counts[(size_t)x];
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                int sum = 0;
+                for (int tap = 0; tap < count; ++tap)
+                {
+                    sum += sourcePixel[tap * sourcePixelStride + channel] * coefficients[tap];
+                }
+
+                dest[channel] = clampToByte(sum);
+            }
+
+            if (premultiplied)
+            {
+                clampToAlpha(dest);
+            }
+
+            dest += numChannels;
+        }
+    }
+
+    //
+    // Filters rows of bytes vertically; the channel layout doesn't matter except for the alpha clamp
+    //
+    static void resampleColumns(juce::uint8 const* source, size_t sourceStride, juce::uint8* dest, int rowBytes, bool premultiplied,
+        juce::int16 const* coefficients, int count) noexcept
+    {
+        int x = 0;
+
+#if JUCE_INTEL
+        auto const zero = _mm_setzero_si128();
+        auto const rounding = _mm_set1_epi32(weightOne >> 1);
+        auto const maxByte = _mm_set1_epi16(255);
+
+        for (; x + 16 <= rowBytes; x += 16)
+        {
+            __m128i sums[4] = { rounding, rounding, rounding, rounding };
+
+            for (int tap = 0; tap < count; tap += 2)
+            {
+                auto a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + sourceStride * (size_t)tap + (size_t)x));
+                auto b = zero;
+                auto weightPair = (juce::uint32)(juce::uint16)coefficients[tap];
+
+                if (tap + 1 < count)
+                {
+                    b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + sourceStride * (size_t)(tap + 1) + (size_t)x));
+                    weightPair |= (juce::uint32)(juce::uint16)coefficients[tap + 1] << 16;
+                }
+
+                //
+                // Interleave the two rows so madd multiplies each byte by its row's weight and adds the pair
+                //
+                auto weight = _mm_set1_epi32((int)weightPair);
+                auto low = _mm_unpacklo_epi8(a, b);
+                auto high = _mm_unpackhi_epi8(a, b);
+                sums[0] = _mm_add_epi32(sums[0], _mm_madd_epi16(_mm_unpacklo_epi8(low, zero), weight));
+                sums[1] = _mm_add_epi32(sums[1], _mm_madd_epi16(_mm_unpackhi_epi8(low, zero), weight));
+                sums[2] = _mm_add_epi32(sums[2], _mm_madd_epi16(_mm_unpacklo_epi8(high, zero), weight));
+                sums[3] = _mm_add_epi32(sums[3], _mm_madd_epi16(_mm_unpackhi_epi8(high, zero), weight));
+            }
+
+            auto first = _mm_packs_epi32(_mm_srai_epi32(sums[0], weightBits), _mm_srai_epi32(sums[1], weightBits));
+            auto second = _mm_packs_epi32(_mm_srai_epi32(sums[2], weightBits), _mm_srai_epi32(sums[3], weightBits));
+            first = _mm_max_epi16(_mm_min_epi16(first, maxByte), zero);
+            second = _mm_max_epi16(_mm_min_epi16(second, maxByte), zero);
+
+            if (premultiplied)
+            {
+                first = clampToAlpha(first);
+                second = clampToAlpha(second);
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x), _mm_packus_epi16(first, second));
+        }
+#endif
+
+        for (; x < rowBytes; ++x)
+        {
+            int sum = 0;
+            for (int tap = 0; tap < count; ++tap)
+            {
+                sum += source[sourceStride * (size_t)tap + (size_t)x] * coefficients[tap];
+            }
+
+            dest[x] = clampToByte(sum);
+
+            if (premultiplied && (x & 3) == 3)
+            {
+                clampToAlpha(dest + x - 3);
+            }
+        }
+    }
+
+#if JUCE_INTEL
+    //
+    // Two ARGB pixels as 16-bit channels; alpha is channel 3 on little-endian
+    //
+    static __m128i clampToAlpha(__m128i pixels) noexcept
+    {
+        auto alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm_min_epi16(pixels, alpha);
+    }
+
+    static void resampleRowARGB(juce::uint8 const* source, juce::uint8* dest, Weights const& weights, int destWidth) noexcept
+    {
+        auto const zero = _mm_setzero_si128();
+        auto const rounding = _mm_set1_epi32(weightOne >> 1);
+        auto const maxByte = _mm_set1_epi16(255);
+
+        for (int x = 0; x < destWidth; ++x)
+        {
+            auto sourcePixel = source + weights.starts[(size_t)x] * 4;
+            auto coefficients = weights.get(x);
+            auto count = weights.counts[(size_t)x];
+            auto sum = rounding;
+
+            int tap = 0;
+            for (; tap + 2 <= count; tap += 2)
+            {
+                auto pair = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(sourcePixel + tap * 4));
+                auto interleaved = _mm_unpacklo_epi8(_mm_unpacklo_epi8(pair, _mm_srli_si128(pair, 4)), zero);
+                auto weightPair = (juce::uint32)(juce::uint16)coefficients[tap] | ((juce::uint32)(juce::uint16)coefficients[tap + 1] << 16);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(interleaved, _mm_set1_epi32((int)weightPair)));
+            }
+
+            if (tap < count)
+            {
+                auto pixel = _mm_cvtsi32_si128((int)juce::readUnaligned<juce::uint32>(sourcePixel + tap * 4));
+                auto interleaved = _mm_unpacklo_epi8(_mm_unpacklo_epi8(pixel, zero), zero);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(interleaved, _mm_set1_epi32((int)(juce::uint16)coefficients[tap])));
+            }
+
+            auto channels = _mm_packs_epi32(_mm_srai_epi32(sum, weightBits), zero);
+            channels = clampToAlpha(_mm_max_epi16(_mm_min_epi16(channels, maxByte), zero));
+            juce::writeUnaligned<juce::uint32>(dest + x * 4, (juce::uint32)_mm_cvtsi128_si32(_mm_packus_epi16(channels, zero)));
+        }
+    }
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ImageResampler)
+};
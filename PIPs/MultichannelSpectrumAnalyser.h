@@ -0,0 +1,312 @@
+#pragma once
+
+#include "SpectrumKernels.h"
+
+//
+// Multichannel, multi-resolution spectrum analyser
+//
+// The audio thread only copies incoming samples into a lock-free FIFO. All the FFT work happens
+// on the reader thread in processNextFrame(), so the audio callback's cost is one copy per channel,
+// however many resolutions are being analysed.
+//
+// Transforms are batched by size: every channel's transform of a given order runs back to back
+// through the same dsp::FFT object, so its twiddle tables stay hot in the cache.
+//
+class MultichannelSpectrumAnalyser
+{
+public:
+    static constexpr int maxChannels = 16;
+    static constexpr int hopSize = 512;
+
+    //
+    // fftOrders lists the resolutions to compute for each channel; the defaults give a
+    // high-resolution 4096-point FFT for the low end and a low-latency 512-point FFT for the top end
+    //
+    explicit MultichannelSpectrumAnalyser(std::initializer_list<int> fftOrders = { 12, 9 })
+    {
+        for (auto order : fftOrders)
+        {
+            jassert(order >= 0 && (1 << order) >= hopSize);
+            resolutions.add(new Resolution{ order });
+        }
+
+        //
+        // Keep the resolutions sorted from largest to smallest FFT
+        //
+        std::sort(resolutions.begin(), resolutions.end(), [](Resolution const* a, Resolution const* b)
+            {
+                return a->fftSize > b->fftSize;
+            });
+
+        maxFFTSize = resolutions.getFirst()->fftSize;
+
+        historyBuffer.setSize(maxChannels, maxFFTSize);
+        historyBuffer.clear();
+
+        fifoBuffer.setSize(maxChannels, fifoSize);
+        fifoBuffer.clear();
+
+        workBuffer.calloc((size_t)maxFFTSize * 2);
+    }
+
+    ~MultichannelSpectrumAnalyser() = default;
+
+    //
+    // Audio device thread, from prepareToPlay. The reader may be mid-frame, so this only records the
+    // new rate; the reader applies it and clears its state at the start of its next call.
+    //
+    void prepare(double newSampleRate) noexcept
+    {
+        pendingSampleRate.store(newSampleRate);
+        resetPending.store(true);
+    }
+
+    //
+    // Any thread; drops whatever is waiting in the FIFO and the analysis so far, in the same way as
+    // prepare(), for when the reader has stopped reading for a while and the backlog is stale
+    //
+    void reset() noexcept
+    {
+        resetPending.store(true);
+    }
+
+    //
+    // Audio thread; copies the samples into the FIFO and nothing else. If the reader has fallen
+    // behind, the samples that don't fit are dropped.
+    //
+    void pushBlock(juce::AudioBuffer<float> const& buffer, int startSample, int numSamples) noexcept
+    {
+        auto channels = juce::jmin(buffer.getNumChannels(), maxChannels);
+        numChannels.store(channels);
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+        for (int channel = 0; channel < channels; ++channel)
+        {
+            auto source = buffer.getReadPointer(channel, startSample);
+
+            if (size1 > 0)
+                fifoBuffer.copyFrom(channel, start1, source, size1);
+
+            if (size2 > 0)
+                fifoBuffer.copyFrom(channel, start2, source + size1, size2);
+        }
+
+        fifo.finishedWrite(size1 + size2);
+    }
+
+    //
+    // Reader thread; consumes one hop of samples and recalculates the spectra for every channel
+    // and resolution. Returns false if there isn't a full hop waiting in the FIFO.
+    //
+    bool processNextFrame()
+    {
+        applyPendingReset();
+
+        if (fifo.getNumReady() < hopSize)
+        {
+            return false;
+        }
+
+        auto channels = numChannels.load();
+
+        {
+            int start1, size1, start2, size2;
+            fifo.prepareToRead(hopSize, start1, size1, start2, size2);
+
+            for (int channel = 0; channel < channels; ++channel)
+            {
+                auto history = historyBuffer.getWritePointer(channel);
+                std::memmove(history, history + hopSize, sizeof(float) * (size_t)(maxFFTSize - hopSize));
+
+                auto tail = history + maxFFTSize - hopSize;
+                juce::FloatVectorOperations::copy(tail, fifoBuffer.getReadPointer(channel, start1), size1);
+
+                if (size2 > 0)
+                    juce::FloatVectorOperations::copy(tail + size1, fifoBuffer.getReadPointer(channel, start2), size2);
+            }
+
+            fifo.finishedRead(size1 + size2);
+        }
+
+        //
+        // Resolutions in the outer loop, channels in the inner loop
+        //
+        auto data = workBuffer.get();
+        for (auto resolution : resolutions)
+        {
+            auto fftSize = resolution->fftSize;
+
+            //
+            // A full-scale sine reads close to 1.0 at every resolution with a Hann window
+            //
+            auto normalisation = 4.0f / (float)fftSize;
+
+            for (int channel = 0; channel < channels; ++channel)
+            {
+                auto history = historyBuffer.getReadPointer(channel, maxFFTSize - fftSize);
+                juce::FloatVectorOperations::copy(data, history, fftSize);
+                juce::FloatVectorOperations::clear(data + fftSize, fftSize);
+
+                resolution->window.multiplyWithWindowingTable(data, (size_t)fftSize);
+                resolution->fft.performRealOnlyForwardTransform(data, true);
+
+                auto magnitudes = resolution->magnitudes.getWritePointer(channel);
+                SpectrumKernels::complexToMagnitude(magnitudes, data, resolution->getNumBins());
+                juce::FloatVectorOperations::multiply(magnitudes, normalisation, resolution->getNumBins());
+            }
+        }
+
+        processedChannels = channels;
+        return true;
+    }
+
+    int getNumChannels() const noexcept { return processedChannels; }
+    int getNumResolutions() const noexcept { return resolutions.size(); }
+    int getFFTSize(int resolutionIndex) const noexcept { return resolutions[resolutionIndex]->fftSize; }
+    int getNumBins(int resolutionIndex) const noexcept { return resolutions[resolutionIndex]->getNumBins(); }
+    double getSampleRate() const noexcept { return sampleRate; }
+
+    float const* getMagnitudes(int resolutionIndex, int channel) const noexcept
+    {
+        return resolutions[resolutionIndex]->magnitudes.getReadPointer(channel);
+    }
+
+    //
+    // Reader thread; fills dest with numPoints magnitudes spaced logarithmically from minFrequency
+    // to Nyquist. Each point reads from the lowest-latency FFT whose bin spacing is fine enough for the
+    // point's bandwidth, so the low end gets the long FFT and the top end gets the short one.
+    //
+    void getMultiResolutionSpectrum(int channel, float* dest, int numPoints, float minFrequency = 20.0f)
+    {
+        applyPendingReset();
+
+        if (multiResolutionMap.size() != (size_t)numPoints || minFrequency != multiResolutionMinFrequency)
+        {
+            buildMultiResolutionMap(numPoints, minFrequency);
+        }
+
+        for (int point = 0; point < numPoints; ++point)
+        {
+            auto const& entry = multiResolutionMap[(size_t)point];
+            auto magnitudes = resolutions[entry.resolutionIndex]->magnitudes.getReadPointer(channel);
+            dest[point] = magnitudes[entry.bin] + entry.fraction * (magnitudes[entry.bin + 1] - magnitudes[entry.bin]);
+        }
+    }
+
+private:
+    static constexpr int fifoSize = 1 << 15;
+
+    struct Resolution
+    {
+        explicit Resolution(int order) :
+            fftSize(1 << order),
+            fft(order),
+            window((size_t)fftSize, juce::dsp::WindowingFunction<float>::hann, false)
+        {
+            magnitudes.setSize(maxChannels, getNumBins());
+            magnitudes.clear();
+        }
+
+        int getNumBins() const noexcept
+        {
+            return fftSize / 2 + 1;
+        }
+
+        int const fftSize;
+        juce::dsp::FFT fft;
+        juce::dsp::WindowingFunction<float> window;
+        juce::AudioBuffer<float> magnitudes;
+    };
+
+    struct MapEntry
+    {
+        int resolutionIndex;
+        int bin;
+        float fraction;
+    };
+
+    juce::OwnedArray<Resolution> resolutions;
+    int maxFFTSize = 0;
+    double sampleRate = 44100.0;
+    std::atomic<double> pendingSampleRate{ 44100.0 };
+    std::atomic<bool> resetPending{ false };
+
+    juce::AbstractFifo fifo{ fifoSize };
+    juce::AudioBuffer<float> fifoBuffer;
+    std::atomic<int> numChannels{ 0 };
+
+    juce::AudioBuffer<float> historyBuffer;
+    juce::HeapBlock<float> workBuffer;
+    int processedChannels = 0;
+
+    std::vector<MapEntry> multiResolutionMap;
+    float multiResolutionMinFrequency = 0.0f;
+
+    //
+    // Reader thread. Samples already in the FIFO are read out and dropped rather than resetting the
+    // FIFO, since the audio thread may be writing to it.
+    //
+    void applyPendingReset()
+    {
+        if (! resetPending.exchange(false))
+        {
+            return;
+        }
+
+        sampleRate = pendingSampleRate.load();
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+        fifo.finishedRead(size1 + size2);
+
+        historyBuffer.clear();
+
+        for (auto resolution : resolutions)
+        {
+            resolution->magnitudes.clear();
+        }
+
+        multiResolutionMap.clear();
+    }
+
+    void buildMultiResolutionMap(int numPoints, float minFrequency)
+    {
+        multiResolutionMap.resize((size_t)numPoints);
+        multiResolutionMinFrequency = minFrequency;
+
+        auto nyquist = (float)sampleRate * 0.5f;
+        auto ratio = nyquist / minFrequency;
+        auto pointStep = std::pow(ratio, 1.0f / (float)juce::jmax(1, numPoints - 1));
+
+        for (int point = 0; point < numPoints; ++point)
+        {
+            auto frequency = minFrequency * std::pow(ratio, (float)point / (float)juce::jmax(1, numPoints - 1));
+            auto bandwidth = frequency * (pointStep - 1.0f);
+
+            //
+            // Resolutions are sorted largest first, so search backwards for the shortest FFT that
+            // resolves this bandwidth; fall back to the longest FFT
+            //
+            int resolutionIndex = 0;
+            for (int index = resolutions.size() - 1; index > 0; --index)
+            {
+                auto binWidth = (float)sampleRate / (float)resolutions[index]->fftSize;
+                if (binWidth <= bandwidth)
+                {
+                    resolutionIndex = index;
+                    break;
+                }
+            }
+
+            auto resolution = resolutions[resolutionIndex];
+            auto exactBin = juce::jlimit(0.0f, (float)(resolution->getNumBins() - 2), frequency * (float)resolution->fftSize / (float)sampleRate);
+            auto bin = (int)exactBin;
+
+            multiResolutionMap[(size_t)point] = { resolutionIndex, bin, exactBin - (float)bin };
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MultichannelSpectrumAnalyser)
+};
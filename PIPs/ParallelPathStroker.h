@@ -0,0 +1,297 @@
+#pragma once
+
+//
+// Multithreaded replacement for PathStrokeType::createStrokedPath, for very large paths
+//
+// The source path is flattened once, then each long subpath is split into chunks of
+// segmentsPerChunk line segments. Chunks are stroked on worker threads with butt ends and
+// stitched back together in order.
+//
+// Each chunk overlaps the next by one segment, so every interior vertex is still the middle
+// of some chunk and gets the same joint the serial stroker would give it; the butt ends at
+// the seams lie flush against the neighbouring chunk's outline. The real end caps of open
+// subpaths are added separately. The filled result covers the same area as the serial
+// stroke, give or take the flattening tolerance on rounded caps.
+//
+// Subpaths shorter than a chunk are stroked whole with the original stroke type; they still
+// run in parallel with each other.
+//
+class ParallelPathStroker
+{
+public:
+    ParallelPathStroker(int numThreads = juce::jmax(1, juce::SystemStats::getNumCpus() - 1), int segmentsPerChunk_ = 4096) :
+        segmentsPerChunk(juce::jmax(2, segmentsPerChunk_)),
+        numWorkers(numThreads),
+        pool(numThreads)
+    {
+    }
+
+    ~ParallelPathStroker() = default;
+
+    void createStrokedPath(juce::Path& dest, juce::Path const& source, juce::PathStrokeType const& strokeType,
+        juce::AffineTransform const& transform = {}, float extraAccuracy = 1.0f)
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+
+        std::vector<Job> jobs;
+        std::vector<Cap> caps;
+        createJobs(source, strokeType, transform, extraAccuracy, jobs, caps);
+        runJobs(jobs);
+
+        dest.clear();
+        dest.setUsingNonZeroWinding(true);
+
+        for (auto const& job : jobs)
+        {
+            dest.addPath(job.result);
+        }
+
+        for (auto const& cap : caps)
+        {
+            addCap(dest, cap, strokeType, extraAccuracy);
+        }
+
+        strokeTime.addValue(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0);
+    }
+
+    juce::StatisticsAccumulator<double> strokeTime;
+
+private:
+    struct Job
+    {
+        juce::Path source;
+        juce::PathStrokeType strokeType;
+        juce::Path result;
+    };
+
+    struct Cap
+    {
+        juce::Point<float> end;
+        juce::Point<float> previous;
+    };
+
+    int const segmentsPerChunk;
+    int const numWorkers;
+    juce::ThreadPool pool;
+
+    void createJobs(juce::Path const& source, juce::PathStrokeType const& strokeType, juce::AffineTransform const& transform, float extraAccuracy,
+        std::vector<Job>& jobs, std::vector<Cap>& caps) const
+    {
+        juce::PathStrokeType chunkStrokeType{ strokeType.getStrokeThickness(), strokeType.getJointStyle(), juce::PathStrokeType::butt };
+
+        std::vector<juce::Point<float>> points;
+        bool closed = false;
+
+        auto flushSubPath = [&]()
+            {
+                auto numSegments = (int)points.size() - 1;
+                if (numSegments < 1)
+                {
+                    return;
+                }
+
+                if (numSegments <= segmentsPerChunk)
+                {
+                    jobs.push_back({ createPolyline(points, 0, numSegments, closed), strokeType, {} });
+                    return;
+                }
+
+                for (int first = 0; first < numSegments; first += segmentsPerChunk)
+                {
+                    auto last = juce::jmin(first + segmentsPerChunk + 1, numSegments);
+                    auto polyline = createPolyline(points, first, last, false);
+
+                    //
+                    // The last chunk of a closed subpath wraps round by one segment so that the
+                    // joint at the start vertex gets drawn
+                    //
+                    if (closed && last == numSegments)
+                    {
+                        polyline.lineTo(points[1]);
+                    }
+
+                    jobs.push_back({ std::move(polyline), chunkStrokeType, {} });
+                }
+
+                if (! closed)
+                {
+                    caps.push_back({ points.front(), points[1] });
+                    caps.push_back({ points.back(), points[points.size() - 2] });
+                }
+            };
+
+        juce::PathFlatteningIterator it{ source, transform, juce::PathFlatteningIterator::defaultTolerance / extraAccuracy };
+        int subPathIndex = -1;
+
+        while (it.next())
+        {
+            if (it.subPathIndex != subPathIndex)
+            {
+                flushSubPath();
+
+                points.clear();
+                points.push_back({ it.x1, it.y1 });
+                closed = false;
+                subPathIndex = it.subPathIndex;
+            }
+
+            points.push_back({ it.x2, it.y2 });
+            closed = closed || it.closesSubPath;
+        }
+
+        flushSubPath();
+    }
+
+    static juce::Path createPolyline(std::vector<juce::Point<float>> const& points, int first, int last, bool closed)
+    {
+        juce::Path polyline;
+        polyline.preallocateSpace((last - first + 1) * 3 + 1);
+
+        polyline.startNewSubPath(points[(size_t)first]);
+        for (int index = first + 1; index <= last; ++index)
+        {
+            polyline.lineTo(points[(size_t)index]);
+        }
+
+        if (closed)
+        {
+            polyline.closeSubPath();
+        }
+
+        return polyline;
+    }
+
+    //
+    // Workers and the calling thread all pull jobs from a shared counter, so a few slow chunks
+    // don't leave the other threads idle
+    //
+    void runJobs(std::vector<Job>& jobs)
+    {
+        std::atomic<size_t> nextJob{ 0 };
+        auto processJobs = [&]()
+            {
+                for (auto index = nextJob++; index < jobs.size(); index = nextJob++)
+                {
+                    auto& job = jobs[index];
+                    job.strokeType.createStrokedPath(job.result, job.source);
+                }
+            };
+
+        auto numHelpers = (int)juce::jmin((size_t)numWorkers, jobs.size() - juce::jmin(jobs.size(), (size_t)1));
+        std::atomic<int> helpersRemaining{ numHelpers };
+        juce::WaitableEvent helpersFinished;
+
+        for (int helper = 0; helper < numHelpers; ++helper)
+        {
+            pool.addJob([&]()
+                {
+                    processJobs();
+
+                    if (--helpersRemaining == 0)
+                        helpersFinished.signal();
+                });
+        }
+
+        processJobs();
+
+        if (numHelpers > 0)
+        {
+            helpersFinished.wait();
+        }
+    }
+
+    //
+    // End caps for the open ends of chunked subpaths. The cap polygons are wound the same way as
+    // the stroker's own outlines so the non-zero winding fill adds them instead of cancelling them.
+    //
+    void addCap(juce::Path& dest, Cap const& cap, juce::PathStrokeType const& strokeType, float extraAccuracy) const
+    {
+        auto halfWidth = strokeType.getStrokeThickness() * 0.5f;
+        auto direction = cap.end - cap.previous;
+        auto length = direction.getDistanceFromOrigin();
+
+        if (strokeType.getEndStyle() == juce::PathStrokeType::butt || length <= 0.0f)
+        {
+            return;
+        }
+
+        direction /= length;
+        juce::Point<float> normal{ -direction.y * halfWidth, direction.x * halfWidth };
+
+        std::vector<juce::Point<float>> polygon;
+        polygon.push_back(cap.end + normal);
+
+        if (strokeType.getEndStyle() == juce::PathStrokeType::square)
+        {
+            polygon.push_back(cap.end + normal + direction * halfWidth);
+            polygon.push_back(cap.end - normal + direction * halfWidth);
+        }
+        else
+        {
+            //
+            // Same tolerance as the segments are flattened to, so caps are as smooth as the rest of the stroke
+            //
+            auto tolerance = juce::PathFlatteningIterator::defaultTolerance / extraAccuracy;
+            auto numSteps = juce::jlimit(4, 256, (int)std::ceil(juce::MathConstants<float>::pi / std::acos(juce::jmax(0.0f, 1.0f - tolerance / halfWidth))));
+            for (int step = 1; step < numSteps; ++step)
+            {
+                auto angle = juce::MathConstants<float>::pi * (float)step / (float)numSteps;
+                polygon.push_back(cap.end + normal * std::cos(angle) + direction * (halfWidth * std::sin(angle)));
+            }
+        }
+
+        polygon.push_back(cap.end - normal);
+
+        if ((getSignedArea(polygon) > 0.0f) != strokerWindsPositive())
+        {
+            std::reverse(polygon.begin(), polygon.end());
+        }
+
+        dest.startNewSubPath(polygon.front());
+        for (size_t index = 1; index < polygon.size(); ++index)
+        {
+            dest.lineTo(polygon[index]);
+        }
+        dest.closeSubPath();
+    }
+
+    static float getSignedArea(std::vector<juce::Point<float>> const& polygon)
+    {
+        auto area = 0.0f;
+        for (size_t index = 0; index < polygon.size(); ++index)
+        {
+            auto const& a = polygon[index];
+            auto const& b = polygon[(index + 1) % polygon.size()];
+            area += a.x * b.y - b.x * a.y;
+        }
+
+        return area * 0.5f;
+    }
+
+    //
+    // Find out once which way round the stroker winds its outlines by stroking a single segment
+    //
+    static bool strokerWindsPositive()
+    {
+        static bool const windsPositive = []
+            {
+                juce::Path line, outline;
+                line.startNewSubPath(0.0f, 0.0f);
+                line.lineTo(10.0f, 0.0f);
+                juce::PathStrokeType{ 2.0f, juce::PathStrokeType::mitered, juce::PathStrokeType::butt }.createStrokedPath(outline, line);
+
+                std::vector<juce::Point<float>> polygon;
+                juce::PathFlatteningIterator it{ outline };
+                while (it.next())
+                {
+                    polygon.push_back({ it.x1, it.y1 });
+                }
+
+                return getSignedArea(polygon) > 0.0f;
+            }();
+
+        return windsPositive;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParallelPathStroker)
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+//
+// Runs a per-row function over an image's rows on a thread pool
+//
+// Rows are handed out in bands, several per worker, from a shared counter; the calling thread works
+// through bands too rather than just waiting. Small jobs aren't worth waking the pool for, so callers
+// pass multithreaded = false for those and the rows run inline.
+//
+class ParallelRows
+{
+public:
+    ParallelRows(int numThreads = juce::jmax(1, juce::SystemStats::getNumCpus() - 1)) :
+        numWorkers(numThreads),
+        pool(numThreads)
+    {
+    }
+
+    ~ParallelRows() = default;
+
+    //
+    // Images at least this many pixels are worth splitting
+    //
+    static constexpr juce::int64 minPixelsToSplit = 256 * 256;
+
+    template <typename RowFunction>
+    void forEachRow(int numRows, bool multithreaded, RowFunction&& rowFunction)
+    {
+        if (! multithreaded || numWorkers <= 0)
+        {
+            for (int y = 0; y < numRows; ++y)
+            {
+                rowFunction(y);
+            }
+
+            return;
+        }
+
+        auto rowsPerBand = juce::jmax(1, numRows / ((numWorkers + 1) * 4));
+        std::atomic<int> nextRow{ 0 };
+        auto processBands = [&]()
+            {
+                for (auto first = nextRow.fetch_add(rowsPerBand); first < numRows; first = nextRow.fetch_add(rowsPerBand))
+                {
+                    for (int y = first; y < juce::jmin(numRows, first + rowsPerBand); ++y)
+                    {
+                        rowFunction(y);
+                    }
+                }
+            };
+
+        auto numHelpers = juce::jmin(numWorkers, (numRows + rowsPerBand - 1) / rowsPerBand - 1);
+        std::atomic<int> helpersRemaining{ numHelpers };
+        juce::WaitableEvent helpersFinished;
+
+        for (int helper = 0; helper < numHelpers; ++helper)
+        {
+            pool.addJob([&]()
+                {
+                    processBands();
+
+                    if (--helpersRemaining == 0)
+                        helpersFinished.signal();
+                });
+        }
+
+        processBands();
+
+        if (numHelpers > 0)
+        {
+            helpersFinished.wait();
+        }
+    }
+
+private:
+    int const numWorkers;
+    juce::ThreadPool pool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParallelRows)
+};
@@ -21,7 +21,10 @@
 
 #pragma once
 
-class Particles : public Component, public ImagePixelData::Listener
+#include "AssetCache.h"
+#include "ImageBudget.h"
+
+class Particles : public Component
 {
 public:
     Particles()
@@ -142,22 +145,39 @@ public:
 
     void createSpriteImages()
     {
-        images.clear();
+        spriteImages.clear();
+
+        //
+        // The recipe includes a hash of the sprite geometry, so changing the star or the circle doesn't
+        // serve stale sprites from disk
+        //
+        auto geometry = String::toHexString((starPath.toString() + "|" + circlePath.toString()).hashCode64());
 
         for (auto const& color : colors)
         {
-            Image image{ Image::ARGB, spriteSize, spriteSize, true };
-            image.getPixelData()->listeners.add(this);
-            images.add(image);
-
-            {
-                Graphics g{ image };
-                g.setColour(color);
-                g.fillPath(starPath);
-                g.setColour(Colours::darkgrey);
-                g.strokePath(starPath, PathStrokeType{ 1.0f });
-                g.fillPath(circlePath);
-            }
+            //
+            // Sprites come from the on-disk asset cache, so recreating them after the device is lost or
+            // after the image budget evicts them is just a copy from the mapped file
+            //
+            auto recipe = "Particles sprite " + String{ spriteSize } + " " + color.toDisplayString(true) + " geometry " + geometry;
+            spriteImages.push_back(imageBudget->add([this, color, recipe]
+                {
+                    return assetCache->getImage(recipe, [this, color]
+                        {
+                            Image sprite{ Image::ARGB, spriteSize, spriteSize, true };
+
+                            {
+                                Graphics g{ sprite };
+                                g.setColour(color);
+                                g.fillPath(starPath);
+                                g.setColour(Colours::darkgrey);
+                                g.strokePath(starPath, PathStrokeType{ 1.0f });
+                                g.fillPath(circlePath);
+                            }
+
+                            return sprite;
+                        }, NativeImageType{});
+                }));
         }
     }
 
@@ -170,6 +190,12 @@ public:
         {
         case paintImages:
             {
+                Array<Image> images;
+                for (auto const& spriteImage : spriteImages)
+                {
+                    images.add(spriteImage.get());
+                }
+
                 int index = 0;
 	            for (auto sprite : sprites)
 	            {
@@ -232,13 +258,6 @@ public:
         modeComboBox.setBounds(spriteCountSlider.getBounds().translated(spriteCountSlider.getWidth() + 10, 0).withWidth(300));
     }
 
-    void imageDataChanged(ImagePixelData*) override {}
-
-    void imageDataBeingDeleted(ImagePixelData*) override
-    {
-        MessageManager::callAsync([this] { createSpriteImages(); });
-    }
-
 private:
     VBlankAttachment attachment{ this, [this]() { animate(); } };
     double lastMsec = Time::getMillisecondCounterHiRes();
@@ -246,7 +265,9 @@ private:
     Path starPath;
     Path circlePath;
     Array<Colour> const colors{ Colours::aquamarine, Colours::yellow, Colours::orange, Colours::coral };
-    Array<Image> images;
+    SharedResourcePointer<AssetCache> assetCache;
+    SharedResourcePointer<ImageBudget> imageBudget;
+    std::vector<ImageBudget::Handle> spriteImages;
 
     static int constexpr spriteSize = 256;
     struct Sprite
@@ -0,0 +1,294 @@
+#pragma once
+
+//
+// Scale-aware level-of-detail hierarchy for large Paths
+//
+// build() flattens the source path once, then builds a ladder of Douglas-Peucker simplifications.
+// Each level is simplified from the level before it with twice the tolerance, and keeps track of its
+// worst-case distance from the original path in path units.
+//
+// At draw time, select() takes the largest scale factor of the transform and picks the coarsest
+// level whose error stays under maxDeviceError device pixels. With the default of half a pixel,
+// a 100,000 segment path drawn a few hundred pixels across gets drawn with a few hundred points.
+// If no simplified level is accurate enough, the original path comes back unchanged.
+//
+class PathLevelOfDetail
+{
+public:
+    PathLevelOfDetail() = default;
+    ~PathLevelOfDetail() = default;
+
+    void build(juce::Path const& source)
+    {
+        levels.clear();
+
+        auto bounds = source.getBounds();
+        auto diagonal = juce::Point<float>{ bounds.getWidth(), bounds.getHeight() }.getDistanceFromOrigin();
+        if (diagonal <= 0.0f)
+        {
+            return;
+        }
+
+        //
+        // The finest level is accurate to 1/16384 of the path's diagonal; flattening curves uses a
+        // quarter of that
+        //
+        auto finestTolerance = diagonal / 16384.0f;
+        auto flatteningTolerance = finestTolerance * 0.25f;
+
+        auto polylines = flatten(source, flatteningTolerance);
+        auto numSourcePoints = countPoints(polylines);
+        auto errorBound = flatteningTolerance;
+
+        for (auto tolerance = finestTolerance; tolerance < diagonal * 0.25f; tolerance *= 2.0f)
+        {
+            for (auto& polyline : polylines)
+            {
+                simplify(polyline, tolerance);
+            }
+
+            errorBound += tolerance;
+
+            auto numPoints = countPoints(polylines);
+            if (numPoints >= numSourcePoints)
+            {
+                //
+                // Nothing to gain from this level yet
+                //
+                continue;
+            }
+
+            auto level = std::make_unique<Level>();
+            level->errorBound = errorBound;
+            level->numPoints = numPoints;
+            level->path = createPath(polylines, source.isUsingNonZeroWinding());
+            levels.add(level.release());
+
+            numSourcePoints = numPoints;
+        }
+    }
+
+    void clear()
+    {
+        levels.clear();
+    }
+
+    int getNumLevels() const noexcept { return levels.size(); }
+
+    //
+    // Exchanges levels with another hierarchy, so levels built on a worker thread can be handed over
+    // without copying; accumulated statistics stay put
+    //
+    void swapLevels(PathLevelOfDetail& other) noexcept
+    {
+        levels.swapWith(other.levels);
+    }
+
+    //
+    // Returns the coarsest level that's within maxDeviceError device pixels of the original once transformed,
+    // or the original path if none of them are
+    //
+    juce::Path const& select(juce::Path const& original, juce::AffineTransform const& transform, float physicalPixelScaleFactor = 1.0f, float maxDeviceError = 0.5f)
+    {
+        auto scale = getMaximumScaleFactor(transform) * physicalPixelScaleFactor;
+
+        for (int index = levels.size() - 1; index >= 0; --index)
+        {
+            auto level = levels[index];
+            if (level->errorBound * scale < maxDeviceError)
+            {
+                pointsDrawn.addValue((double)level->numPoints);
+                return level->path;
+            }
+        }
+
+        return original;
+    }
+
+    juce::Path const& select(juce::Path const& original, juce::Graphics& g, juce::AffineTransform const& transform)
+    {
+        return select(original, transform, g.getInternalContext().getPhysicalPixelScaleFactor());
+    }
+
+    juce::StatisticsAccumulator<double> pointsDrawn;
+
+private:
+    struct Level
+    {
+        juce::Path path;
+        float errorBound = 0.0f;
+        int numPoints = 0;
+    };
+
+    struct Polyline
+    {
+        std::vector<juce::Point<float>> points;
+        bool closed = false;
+    };
+
+    juce::OwnedArray<Level> levels;
+
+    //
+    // The largest singular value of the transform's 2x2 part; no point moves further than this
+    // times its distance in path units
+    //
+    static float getMaximumScaleFactor(juce::AffineTransform const& t)
+    {
+        auto sumOfSquares = t.mat00 * t.mat00 + t.mat01 * t.mat01 + t.mat10 * t.mat10 + t.mat11 * t.mat11;
+        auto determinant = t.mat00 * t.mat11 - t.mat01 * t.mat10;
+        auto discriminant = juce::jmax(0.0f, sumOfSquares * sumOfSquares - 4.0f * determinant * determinant);
+        return std::sqrt((sumOfSquares + std::sqrt(discriminant)) * 0.5f);
+    }
+
+    static std::vector<Polyline> flatten(juce::Path const& source, float tolerance)
+    {
+        std::vector<Polyline> polylines;
+        juce::PathFlatteningIterator it{ source, {}, tolerance };
+        int subPathIndex = -1;
+
+        while (it.next())
+        {
+            if (it.subPathIndex != subPathIndex)
+            {
+                polylines.emplace_back();
+                polylines.back().points.push_back({ it.x1, it.y1 });
+                subPathIndex = it.subPathIndex;
+            }
+
+            auto& polyline = polylines.back();
+            polyline.points.push_back({ it.x2, it.y2 });
+            polyline.closed = polyline.closed || it.closesSubPath;
+        }
+
+        return polylines;
+    }
+
+    static int countPoints(std::vector<Polyline> const& polylines)
+    {
+        int numPoints = 0;
+        for (auto const& polyline : polylines)
+        {
+            numPoints += (int)polyline.points.size();
+        }
+
+        return numPoints;
+    }
+
+    static juce::Path createPath(std::vector<Polyline> const& polylines, bool nonZeroWinding)
+    {
+        juce::Path path;
+        path.setUsingNonZeroWinding(nonZeroWinding);
+        path.preallocateSpace(countPoints(polylines) * 3 + (int)polylines.size());
+
+        for (auto const& polyline : polylines)
+        {
+            path.startNewSubPath(polyline.points.front());
+
+            for (size_t index = 1; index < polyline.points.size(); ++index)
+            {
+                path.lineTo(polyline.points[index]);
+            }
+
+            if (polyline.closed)
+            {
+                path.closeSubPath();
+            }
+        }
+
+        return path;
+    }
+
+    static float getDistanceFromSegment(juce::Point<float> point, juce::Point<float> start, juce::Point<float> end)
+    {
+        auto delta = end - start;
+        auto lengthSquared = delta.x * delta.x + delta.y * delta.y;
+        if (lengthSquared <= 0.0f)
+        {
+            return point.getDistanceFrom(start);
+        }
+
+        auto proportion = juce::jlimit(0.0f, 1.0f, ((point - start).x * delta.x + (point - start).y * delta.y) / lengthSquared);
+        return point.getDistanceFrom(start + delta * proportion);
+    }
+
+    //
+    // Douglas-Peucker, with an explicit stack so long polylines can't overflow the call stack.
+    // Closed polylines are split at the point furthest from the start so both halves keep their shape.
+    //
+    static void simplify(Polyline& polyline, float tolerance)
+    {
+        auto& points = polyline.points;
+        auto numPoints = (int)points.size();
+        if (numPoints <= 2)
+        {
+            return;
+        }
+
+        std::vector<bool> keep((size_t)numPoints, false);
+        keep.front() = true;
+        keep.back() = true;
+
+        std::vector<std::pair<int, int>> stack;
+
+        if (polyline.closed)
+        {
+            int furthest = 0;
+            auto furthestDistance = -1.0f;
+            for (int index = 1; index < numPoints - 1; ++index)
+            {
+                auto distance = points[(size_t)index].getDistanceFrom(points.front());
+                if (distance > furthestDistance)
+                {
+                    furthest = index;
+                    furthestDistance = distance;
+                }
+            }
+
+            keep[(size_t)furthest] = true;
+            stack.push_back({ 0, furthest });
+            stack.push_back({ furthest, numPoints - 1 });
+        }
+        else
+        {
+            stack.push_back({ 0, numPoints - 1 });
+        }
+
+        while (! stack.empty())
+        {
+            auto [first, last] = stack.back();
+            stack.pop_back();
+
+            int furthest = -1;
+            auto furthestDistance = tolerance;
+            for (int index = first + 1; index < last; ++index)
+            {
+                auto distance = getDistanceFromSegment(points[(size_t)index], points[(size_t)first], points[(size_t)last]);
+                if (distance > furthestDistance)
+                {
+                    furthest = index;
+                    furthestDistance = distance;
+                }
+            }
+
+            if (furthest >= 0)
+            {
+                keep[(size_t)furthest] = true;
+                stack.push_back({ first, furthest });
+                stack.push_back({ furthest, last });
+            }
+        }
+
+        size_t kept = 0;
+        for (size_t index = 0; index < points.size(); ++index)
+        {
+            if (keep[index])
+            {
+                points[kept++] = points[index];
+            }
+        }
+
+        points.resize(kept);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PathLevelOfDetail)
+};
@@ -0,0 +1,316 @@
+#pragma once
+
+#include "ParallelPathStroker.h"
+
+//
+// Bounded cache of stroked outlines and rasterised coverage masks for the software renderer
+//
+// Graphics::strokePath re-runs the stroker and rebuilds the edge table on every call, even if
+// nothing but a repaint happened. This cache keys each entry on the Path's identity and version,
+// the stroke type, and the scale/shear part of the transform. It keeps:
+//
+//  - the stroked (or transformed, for fills) outline, so the stroker only runs on a miss
+//  - a single-channel coverage mask rendered from that outline, so the edge table is only built on a miss
+//
+// Translation isn't part of the key; translate-only changes reuse both the outline and the mask.
+// The mask is rendered at a quarter-pixel subpixel offset, so cached drawing can differ from
+// uncached drawing by up to 1/8 pixel.
+//
+// Direct2D has its own geometry realisation cache, so for any other renderer the calls are simply
+// forwarded to Graphics.
+//
+class PathOutlineCache
+{
+public:
+    PathOutlineCache(size_t maxBytes_ = 64 * 1024 * 1024, int maxEntries_ = 32) :
+        maxBytes(maxBytes_),
+        maxEntries(maxEntries_)
+    {
+    }
+
+    ~PathOutlineCache() = default;
+
+    //
+    // pathVersion must change whenever the Path's contents change
+    //
+    void strokePath(juce::Graphics& g, juce::Path const& path, juce::uint64 pathVersion, juce::PathStrokeType const& strokeType, juce::AffineTransform const& transform)
+    {
+        if (! isSoftwareRenderer(g))
+        {
+            g.strokePath(path, strokeType, transform);
+            return;
+        }
+
+        draw(g, path, pathVersion, strokeType, transform);
+    }
+
+    void fillPath(juce::Graphics& g, juce::Path const& path, juce::uint64 pathVersion, juce::AffineTransform const& transform)
+    {
+        if (! isSoftwareRenderer(g))
+        {
+            g.fillPath(path, transform);
+            return;
+        }
+
+        draw(g, path, pathVersion, {}, transform);
+    }
+
+    void clear()
+    {
+        entries.clear();
+        totalBytes = 0;
+    }
+
+    size_t getTotalBytes() const noexcept { return totalBytes; }
+
+    //
+    // Approximate memory used by a Path's coordinate and marker data
+    //
+    static size_t countPathBytes(juce::Path const& path)
+    {
+        size_t numFloats = 0;
+        juce::Path::Iterator it{ path };
+
+        while (it.next())
+        {
+            switch (it.elementType)
+            {
+            case juce::Path::Iterator::startNewSubPath:
+            case juce::Path::Iterator::lineTo:
+                numFloats += 3;
+                break;
+
+            case juce::Path::Iterator::quadraticTo:
+                numFloats += 5;
+                break;
+
+            case juce::Path::Iterator::cubicTo:
+                numFloats += 7;
+                break;
+
+            case juce::Path::Iterator::closePath:
+                numFloats += 1;
+                break;
+            }
+        }
+
+        return numFloats * sizeof(float);
+    }
+
+    //
+    // Stroke outlines on a cache miss with a ParallelPathStroker instead of PathStrokeType;
+    // pass nullptr to go back to the serial stroker
+    //
+    void setParallelStroker(ParallelPathStroker* stroker_)
+    {
+        stroker = stroker_;
+        clear();
+    }
+
+    //
+    // Hit rates are accumulated as 100 for a hit and 0 for a miss, so the average is a percentage
+    //
+    juce::StatisticsAccumulator<double> outlineHitRate;
+    juce::StatisticsAccumulator<double> maskHitRate;
+    juce::StatisticsAccumulator<double> createOutlineTime;
+
+private:
+    static constexpr int subpixelSteps = 4;
+    static constexpr int maxMaskPixels = 2048 * 2048;
+
+    struct Entry
+    {
+        juce::Path const* pathPointer = nullptr;
+        juce::uint64 pathVersion = 0;
+        juce::Rectangle<float> pathBounds;
+        std::optional<juce::PathStrokeType> strokeType;
+        juce::AffineTransform linearTransform;
+        float physicalPixelScaleFactor = 1.0f;
+
+        juce::Path outline;
+        size_t outlineBytes = 0;
+
+        juce::Image mask;
+        juce::Point<int> maskSubpixelOffset;
+        juce::Point<int> maskOrigin;
+
+        juce::uint64 lastUsed = 0;
+
+        size_t getBytes() const noexcept
+        {
+            return outlineBytes + (mask.isValid() ? (size_t)(mask.getWidth() * mask.getHeight()) : 0);
+        }
+    };
+
+    size_t const maxBytes;
+    int const maxEntries;
+    ParallelPathStroker* stroker = nullptr;
+    size_t totalBytes = 0;
+    juce::uint64 useCounter = 0;
+    juce::OwnedArray<Entry> entries;
+
+    static bool isSoftwareRenderer(juce::Graphics& g)
+    {
+        return dynamic_cast<juce::LowLevelGraphicsSoftwareRenderer*>(&g.getInternalContext()) != nullptr;
+    }
+
+    void draw(juce::Graphics& g, juce::Path const& path, juce::uint64 pathVersion, std::optional<juce::PathStrokeType> strokeType, juce::AffineTransform const& transform)
+    {
+        //
+        // Split the transform into the scale/shear part, which goes into the key, and the translation,
+        // which doesn't
+        //
+        juce::AffineTransform linearTransform{ transform.mat00, transform.mat01, 0.0f, transform.mat10, transform.mat11, 0.0f };
+        juce::Point<float> translation{ transform.mat02, transform.mat12 };
+        auto physicalPixelScaleFactor = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+        auto entry = findEntry(path, pathVersion, strokeType, linearTransform, physicalPixelScaleFactor);
+        outlineHitRate.addValue(entry ? 100.0 : 0.0);
+
+        if (entry == nullptr)
+        {
+            entry = createEntry(path, pathVersion, strokeType, linearTransform, physicalPixelScaleFactor);
+        }
+
+        entry->lastUsed = ++useCounter;
+
+        //
+        // Masks are only used at 1:1 physical scale, and only for outlines small enough to be worth keeping
+        //
+        auto outlineBounds = entry->outline.getBounds();
+        if (physicalPixelScaleFactor != 1.0f || outlineBounds.getWidth() * outlineBounds.getHeight() > (float)maxMaskPixels)
+        {
+            g.fillPath(entry->outline, juce::AffineTransform::translation(translation));
+            trim(entry);
+            return;
+        }
+
+        juce::Point<int> integerTranslation{ (int)std::floor(translation.x), (int)std::floor(translation.y) };
+        juce::Point<int> subpixelOffset{ juce::roundToInt((translation.x - (float)integerTranslation.x) * subpixelSteps),
+            juce::roundToInt((translation.y - (float)integerTranslation.y) * subpixelSteps) };
+
+        bool maskHit = entry->mask.isValid() && entry->maskSubpixelOffset == subpixelOffset;
+        maskHitRate.addValue(maskHit ? 100.0 : 0.0);
+
+        if (! maskHit)
+        {
+            renderMask(*entry, subpixelOffset);
+        }
+
+        if (entry->mask.isValid())
+        {
+            auto position = integerTranslation + entry->maskOrigin;
+            g.drawImageAt(entry->mask, position.x, position.y, true);
+        }
+
+        trim(entry);
+    }
+
+    Entry* findEntry(juce::Path const& path, juce::uint64 pathVersion, std::optional<juce::PathStrokeType> const& strokeType, juce::AffineTransform const& linearTransform, float physicalPixelScaleFactor) const
+    {
+        auto pathBounds = path.getBounds();
+
+        for (auto entry : entries)
+        {
+            if (entry->pathPointer == &path
+                && entry->pathVersion == pathVersion
+                && entry->pathBounds == pathBounds
+                && entry->strokeType == strokeType
+                && entry->linearTransform == linearTransform
+                && entry->physicalPixelScaleFactor == physicalPixelScaleFactor)
+            {
+                return entry;
+            }
+        }
+
+        return nullptr;
+    }
+
+    Entry* createEntry(juce::Path const& path, juce::uint64 pathVersion, std::optional<juce::PathStrokeType> const& strokeType, juce::AffineTransform const& linearTransform, float physicalPixelScaleFactor)
+    {
+        auto entry = std::make_unique<Entry>();
+        entry->pathPointer = &path;
+        entry->pathVersion = pathVersion;
+        entry->pathBounds = path.getBounds();
+        entry->strokeType = strokeType;
+        entry->linearTransform = linearTransform;
+        entry->physicalPixelScaleFactor = physicalPixelScaleFactor;
+
+        {
+            auto start = juce::Time::getHighResolutionTicks();
+
+            if (strokeType.has_value() && stroker)
+            {
+                stroker->createStrokedPath(entry->outline, path, *strokeType, linearTransform, physicalPixelScaleFactor);
+            }
+            else if (strokeType.has_value())
+            {
+                strokeType->createStrokedPath(entry->outline, path, linearTransform, physicalPixelScaleFactor);
+            }
+            else
+            {
+                entry->outline = path;
+                entry->outline.applyTransform(linearTransform);
+            }
+
+            createOutlineTime.addValue(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0);
+        }
+
+        entry->outlineBytes = countPathBytes(entry->outline);
+        totalBytes += entry->outlineBytes;
+
+        return entries.add(entry.release());
+    }
+
+    void renderMask(Entry& entry, juce::Point<int> subpixelOffset)
+    {
+        totalBytes -= entry.getBytes() - entry.outlineBytes;
+
+        auto offset = subpixelOffset.toFloat() / (float)subpixelSteps;
+        auto area = entry.outline.getBounds().translated(offset.x, offset.y).getSmallestIntegerContainer();
+
+        entry.mask = {};
+        entry.maskSubpixelOffset = subpixelOffset;
+        entry.maskOrigin = area.getPosition();
+
+        if (area.isEmpty())
+        {
+            return;
+        }
+
+        entry.mask = juce::Image{ juce::Image::SingleChannel, area.getWidth(), area.getHeight(), true, juce::SoftwareImageType{} };
+
+        {
+            juce::Graphics g{ entry.mask };
+            g.setColour(juce::Colours::white);
+            g.fillPath(entry.outline, juce::AffineTransform::translation(offset - area.getPosition().toFloat()));
+        }
+
+        totalBytes += entry.getBytes() - entry.outlineBytes;
+    }
+
+    //
+    // Evict least recently used entries until the cache is back within budget, keeping the entry that
+    // was just drawn
+    //
+    void trim(Entry const* keep)
+    {
+        while (entries.size() > 1 && (totalBytes > maxBytes || entries.size() > maxEntries))
+        {
+            int oldestIndex = -1;
+            for (int index = 0; index < entries.size(); ++index)
+            {
+                auto entry = entries[index];
+                if (entry != keep && (oldestIndex < 0 || entry->lastUsed < entries[oldestIndex]->lastUsed))
+                {
+                    oldestIndex = index;
+                }
+            }
+
+            totalBytes -= entries[oldestIndex]->getBytes();
+            entries.remove(oldestIndex);
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PathOutlineCache)
+};
@@ -0,0 +1,235 @@
+#pragma once
+
+//
+// Software images whose pixel buffers are recycled through a size-class pool
+//
+// Resizing a window or changing a setting often throws away an image and makes another of almost the
+// same size, so the allocator ends up handing back the memory it was just given. An image made with
+// PixelBufferPool::Type takes its buffer from the pool and returns it when the image's pixel data is
+// deleted.
+//
+// Buffers are grouped into size classes: a power of two plus a whole number of quarters of it. A
+// request rounds up to its class and takes any free buffer of that class, so slightly different image
+// sizes share buffers and at most a quarter of a buffer goes unused. Recycled buffers aren't cleared
+// unless the image asks for it. Once the pool holds maxPooledBytes, returned buffers are freed instead.
+//
+// Type derives from SoftwareImageType and keeps its type ID, so pooled images count as software images
+// everywhere, and converting between the two doesn't copy anything.
+//
+class PixelBufferPool
+{
+public:
+    class Type : public juce::SoftwareImageType
+    {
+    public:
+        juce::ImagePixelData::Ptr create(juce::Image::PixelFormat format, int width, int height, bool clearImage) const override
+        {
+            return new PixelData{ format, width, height, clearImage };
+        }
+    };
+
+    struct Metrics
+    {
+        juce::int64 numAllocations = 0;
+        juce::int64 numAllocationsAvoided = 0;
+        juce::int64 numBytesReused = 0;
+        size_t pooledBytes = 0;
+    };
+
+    static Metrics getMetrics()
+    {
+        auto pool = getPool();
+        juce::ScopedLock locker{ pool->lock };
+        return { numAllocations.load(), numAllocationsAvoided.load(), numBytesReused.load(), pool->pooledBytes };
+    }
+
+    static void resetMetrics() noexcept
+    {
+        numAllocations = 0;
+        numAllocationsAvoided = 0;
+        numBytesReused = 0;
+    }
+
+    static void setMaxPooledBytes(size_t newMaxPooledBytes)
+    {
+        auto pool = getPool();
+        juce::ScopedLock locker{ pool->lock };
+        pool->maxPooledBytes = newMaxPooledBytes;
+        pool->trim();
+    }
+
+    //
+    // Frees every buffer the pool is holding
+    //
+    static void releaseAll()
+    {
+        auto pool = getPool();
+        juce::ScopedLock locker{ pool->lock };
+        pool->freeBuffers.clear();
+        pool->pooledBytes = 0;
+    }
+
+private:
+    static inline std::atomic<juce::int64> numAllocations{ 0 };
+    static inline std::atomic<juce::int64> numAllocationsAvoided{ 0 };
+    static inline std::atomic<juce::int64> numBytesReused{ 0 };
+
+    static constexpr size_t minimumSizeClass = 4096;
+
+    static size_t getSizeClass(size_t numBytes) noexcept
+    {
+        if (numBytes <= minimumSizeClass)
+        {
+            return minimumSizeClass;
+        }
+
+        size_t powerOfTwo = minimumSizeClass;
+        while (powerOfTwo * 2 <= numBytes)
+        {
+            powerOfTwo *= 2;
+        }
+
+        auto quarter = powerOfTwo / 4;
+        return (numBytes + quarter - 1) / quarter * quarter;
+    }
+
+    //
+    // Every pixel data holds a reference, so the pool outlives images that are still around at shutdown
+    //
+    struct Pool
+    {
+        juce::CriticalSection lock;
+        std::map<size_t, std::vector<juce::HeapBlock<juce::uint8>>> freeBuffers;
+        size_t pooledBytes = 0;
+        size_t maxPooledBytes = 256 * 1024 * 1024;
+
+        juce::HeapBlock<juce::uint8> take(size_t sizeClass, bool clearImage)
+        {
+            juce::HeapBlock<juce::uint8> buffer;
+
+            {
+                juce::ScopedLock locker{ lock };
+
+                auto& buffers = freeBuffers[sizeClass];
+                if (! buffers.empty())
+                {
+                    buffer = std::move(buffers.back());
+                    buffers.pop_back();
+                    pooledBytes -= sizeClass;
+                }
+            }
+
+            if (buffer == nullptr)
+            {
+                ++numAllocations;
+                buffer.allocate(sizeClass, clearImage);
+                return buffer;
+            }
+
+            ++numAllocationsAvoided;
+            numBytesReused += (juce::int64)sizeClass;
+
+            if (clearImage)
+            {
+                std::memset(buffer, 0, sizeClass);
+            }
+
+            return buffer;
+        }
+
+        void give(juce::HeapBlock<juce::uint8> buffer, size_t sizeClass)
+        {
+            juce::ScopedLock locker{ lock };
+
+            if (pooledBytes + sizeClass <= maxPooledBytes)
+            {
+                freeBuffers[sizeClass].push_back(std::move(buffer));
+                pooledBytes += sizeClass;
+            }
+        }
+
+        //
+        // Frees the largest buffers first until the pool is back under its limit
+        //
+        void trim()
+        {
+            for (auto sizeClass = freeBuffers.rbegin(); sizeClass != freeBuffers.rend() && pooledBytes > maxPooledBytes; ++sizeClass)
+            {
+                auto& buffers = sizeClass->second;
+                while (! buffers.empty() && pooledBytes > maxPooledBytes)
+                {
+                    buffers.pop_back();
+                    pooledBytes -= sizeClass->first;
+                }
+            }
+        }
+    };
+
+    static std::shared_ptr<Pool> getPool()
+    {
+        static auto pool = std::make_shared<Pool>();
+        return pool;
+    }
+
+    //==============================================================================
+    class PixelData : public juce::ImagePixelData
+    {
+    public:
+        PixelData(juce::Image::PixelFormat format, int width_, int height_, bool clearImage) :
+            juce::ImagePixelData(format, width_, height_),
+            pool(getPool()),
+            pixelStride(format == juce::Image::RGB ? 3 : (format == juce::Image::ARGB ? 4 : 1)),
+            lineStride((pixelStride * juce::jmax(1, width_) + 3) & ~3),
+            sizeClass(getSizeClass((size_t)lineStride * (size_t)juce::jmax(1, height_)))
+        {
+            pixels = pool->take(sizeClass, clearImage);
+        }
+
+        ~PixelData() override
+        {
+            pool->give(std::move(pixels), sizeClass);
+        }
+
+        std::unique_ptr<juce::LowLevelGraphicsContext> createLowLevelContext() override
+        {
+            sendDataChangeMessage();
+            return std::make_unique<juce::LowLevelGraphicsSoftwareRenderer>(juce::Image{ *this });
+        }
+
+        void initialiseBitmapData(juce::Image::BitmapData& bitmap, int x, int y, juce::Image::BitmapData::ReadWriteMode mode) override
+        {
+            auto offset = (size_t)(x * pixelStride + y * lineStride);
+            bitmap.data = pixels + offset;
+            bitmap.size = (size_t)(lineStride * height) - offset;
+            bitmap.pixelFormat = pixelFormat;
+            bitmap.lineStride = lineStride;
+            bitmap.pixelStride = pixelStride;
+
+            if (mode != juce::Image::BitmapData::readOnly)
+            {
+                sendDataChangeMessage();
+            }
+        }
+
+        juce::ImagePixelData::Ptr clone() override
+        {
+            auto copy = new PixelData{ pixelFormat, width, height, false };
+            std::memcpy(copy->pixels, pixels, (size_t)(lineStride * height));
+            return copy;
+        }
+
+        std::unique_ptr<juce::ImageType> createType() const override
+        {
+            return std::make_unique<Type>();
+        }
+
+    private:
+        std::shared_ptr<Pool> const pool;
+        int const pixelStride;
+        int const lineStride;
+        size_t const sizeClass;
+        juce::HeapBlock<juce::uint8> pixels;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PixelData)
+    };
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "SVGPathLoader.h"
+#include "PathLevelOfDetail.h"
+#include "AssetCache.h"
+
+//
+// Loads SVG files into Paths on a thread pool, off the message thread
+//
+// Each file gets its own job, so dropping several files loads them in parallel. A job parses the
+// file with SVGPathLoader, works out the bounds, and optionally builds the level-of-detail hierarchy
+// (which includes flattening the curves), so the message thread has nothing left to do but swap
+// the result in.
+//
+// Parsed paths are kept in the on-disk asset cache, keyed on the file's path, size and modification
+// time, so loading an unchanged file again maps the stored path instead of re-parsing the SVG.
+//
+// Finished assets are handed to onAssetLoaded on the message thread as a std::unique_ptr, in the
+// order they finish. Assets aren't copyable; the receiver takes ownership.
+//
+class SVGAssetLoader : private juce::AsyncUpdater
+{
+public:
+    struct Asset
+    {
+        juce::File file;
+        juce::Path path;
+        juce::Rectangle<float> bounds;
+        PathLevelOfDetail levelOfDetail;
+
+        bool loadedFromCache = false;
+        bool usedDrawableFallback = false;
+        juce::String fallbackReason;
+        double parseMs = 0.0;
+        double prepareMs = 0.0;
+        size_t peakBytes = 0;
+    };
+
+    SVGAssetLoader() :
+        threadPool(juce::jmax(1, juce::SystemStats::getNumCpus() - 1))
+    {
+    }
+
+    //
+    // Running jobs poll shouldExit() while parsing, so this doesn't wait for a large file to finish
+    //
+    ~SVGAssetLoader() override
+    {
+        threadPool.removeAllJobs(true, -1);
+        cancelPendingUpdate();
+    }
+
+    void load(juce::Array<juce::File> const& files, bool buildLevelOfDetail)
+    {
+        for (auto const& file : files)
+        {
+            auto progress = batchProgress.add(new std::atomic<float>{ 0.0f });
+            threadPool.addJob(new LoadJob{ *this, file, buildLevelOfDetail, *progress }, true);
+        }
+    }
+
+    bool isLoading() const noexcept
+    {
+        return ! batchProgress.isEmpty();
+    }
+
+    //
+    // Overall progress of the files currently loading, from 0 to 1
+    //
+    double getProgress() const noexcept
+    {
+        if (batchProgress.isEmpty())
+        {
+            return 1.0;
+        }
+
+        double total = 0.0;
+        for (auto progress : batchProgress)
+        {
+            total += progress->load();
+        }
+
+        return total / (double)batchProgress.size();
+    }
+
+    std::function<void(std::unique_ptr<Asset>)> onAssetLoaded;
+
+private:
+    class LoadJob : public juce::ThreadPoolJob
+    {
+    public:
+        LoadJob(SVGAssetLoader& owner_, juce::File file_, bool buildLevelOfDetail_, std::atomic<float>& progress_) :
+            juce::ThreadPoolJob("Load " + file_.getFileName()),
+            owner(owner_),
+            file(file_),
+            buildLevelOfDetail(buildLevelOfDetail_),
+            progress(progress_)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            auto asset = std::make_unique<Asset>();
+            asset->file = file;
+
+            //
+            // Parsing is most of the work unless there's a level-of-detail hierarchy to build as well
+            //
+            auto parseWeight = buildLevelOfDetail ? 0.6f : 0.95f;
+            auto recipe = "SVG " + file.getFullPathName()
+                + " size " + juce::String{ file.getSize() }
+                + " modified " + juce::String{ file.getLastModificationTime().toMilliseconds() };
+
+            auto start = juce::Time::getHighResolutionTicks();
+            asset->loadedFromCache = true;
+            asset->path = owner.assetCache->getPath(recipe, [&]
+                {
+                    auto result = SVGPathLoader::load(file,
+                        [&](float fraction) { progress = fraction * parseWeight; },
+                        [this] { return shouldExit(); });
+
+                    asset->loadedFromCache = false;
+                    asset->usedDrawableFallback = result.usedDrawableFallback;
+                    asset->fallbackReason = result.fallbackReason;
+                    asset->peakBytes = result.peakBytes;
+                    return std::move(result.path);
+                });
+
+            asset->parseMs = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+            progress = parseWeight;
+
+            if (shouldExit())
+            {
+                owner.finished(nullptr);
+                return jobHasFinished;
+            }
+
+            start = juce::Time::getHighResolutionTicks();
+            asset->bounds = asset->path.getBounds();
+            if (buildLevelOfDetail)
+            {
+                asset->levelOfDetail.build(asset->path);
+            }
+
+            asset->prepareMs = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+            progress = 1.0f;
+
+            owner.finished(std::move(asset));
+            return jobHasFinished;
+        }
+
+    private:
+        SVGAssetLoader& owner;
+        juce::File const file;
+        bool const buildLevelOfDetail;
+        std::atomic<float>& progress;
+    };
+
+    juce::SharedResourcePointer<AssetCache> assetCache;
+
+    //
+    // Per-file progress for the current batch; only touched on the message thread, and only cleared
+    // once every job in the batch has reported back
+    //
+    juce::OwnedArray<std::atomic<float>> batchProgress;
+
+    juce::CriticalSection lock;
+    std::vector<std::unique_ptr<Asset>> finishedAssets;
+    int numFinished = 0;
+
+    //
+    // Declared last so it's destroyed first, while everything the jobs touch is still alive
+    //
+    juce::ThreadPool threadPool;
+
+    void finished(std::unique_ptr<Asset> asset)
+    {
+        {
+            juce::ScopedLock locker{ lock };
+            if (asset)
+            {
+                finishedAssets.push_back(std::move(asset));
+            }
+            ++numFinished;
+        }
+
+        triggerAsyncUpdate();
+    }
+
+    void handleAsyncUpdate() override
+    {
+        std::vector<std::unique_ptr<Asset>> assets;
+
+        {
+            juce::ScopedLock locker{ lock };
+            assets.swap(finishedAssets);
+
+            if (numFinished == batchProgress.size())
+            {
+                batchProgress.clear();
+                numFinished = 0;
+            }
+        }
+
+        for (auto& asset : assets)
+        {
+            if (onAssetLoaded)
+            {
+                onAssetLoaded(std::move(asset));
+            }
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SVGAssetLoader)
+};
@@ -0,0 +1,1062 @@
+#pragma once
+
+//
+// Streaming SVG loader that builds a single Path without an XML DOM or a Drawable tree
+//
+// The file is memory-mapped and scanned once, start tag by start tag. Attribute values are
+// string_views into the mapped file, so nothing is copied; the only real allocations are the
+// output Path, which is reserved up front from the file size, and one scratch Path per shape.
+//
+// The result matches Drawable::createFromImageFile(file)->getOutlineAsPath(): shapes with a
+// visible stroke contribute their stroke outline, everything else contributes its geometry, all
+// transformed into the root viewBox. Supported: path, rect, circle, ellipse, line, polyline,
+// polygon, nested groups, transforms, viewBox and preserveAspectRatio, inherited stroke styles,
+// and style attributes. Anything else that affects geometry (use, text, image, <style>
+// sheets, clip paths, masks, dashes, nested svg) makes the loader fall back to the Drawable route.
+//
+class SVGPathLoader
+{
+public:
+    struct Result
+    {
+        juce::Path path;
+        bool usedDrawableFallback = false;
+        juce::String fallbackReason;
+        double parseMs = 0.0;
+        bool cancelled = false;
+
+        //
+        // Estimated peak memory used by the streaming loader; not measured for the Drawable fallback
+        //
+        size_t peakBytes = 0;
+    };
+
+    //
+    // onProgress, if set, is called on the loading thread with the fraction of the file scanned so far.
+    // shouldCancel, if set, is polled at the same interval; once it returns true, load() stops and
+    // returns an empty path with cancelled set.
+    //
+    static Result load(juce::File const& file, std::function<void(float)> onProgress = {}, std::function<bool()> shouldCancel = {})
+    {
+        Result result;
+        auto start = juce::Time::getHighResolutionTicks();
+
+        {
+            juce::MemoryMappedFile mappedFile{ file, juce::MemoryMappedFile::readOnly };
+
+            if (mappedFile.getData() != nullptr)
+            {
+                SVGPathLoader loader{ static_cast<char const*>(mappedFile.getData()), mappedFile.getSize() };
+                loader.onProgress = std::move(onProgress);
+                loader.shouldCancel = std::move(shouldCancel);
+
+                if (loader.parse())
+                {
+                    result.path = std::move(loader.path);
+                    result.peakBytes = loader.getPeakBytes();
+                }
+                else if (loader.cancelled)
+                {
+                    result.cancelled = true;
+                }
+                else
+                {
+                    result.usedDrawableFallback = true;
+                    result.fallbackReason = loader.unsupportedFeature;
+                }
+            }
+            else
+            {
+                result.usedDrawableFallback = true;
+                result.fallbackReason = "couldn't map file";
+            }
+        }
+
+        if (result.usedDrawableFallback)
+        {
+            if (auto svg = juce::Drawable::createFromImageFile(file))
+            {
+                result.path = svg->getOutlineAsPath();
+            }
+        }
+
+        result.parseMs = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+        return result;
+    }
+
+private:
+    using Attributes = std::vector<std::pair<std::string_view, std::string_view>>;
+
+    struct State
+    {
+        std::string_view elementName;
+        juce::AffineTransform transform;
+        std::string_view stroke, strokeWidth, strokeLineJoin, strokeLineCap;
+        bool hidden = false;
+        float viewBoxWidth = 0.0f, viewBoxHeight = 0.0f;
+    };
+
+    char const* const begin;
+    char const* const end;
+
+    juce::Path path;
+    juce::Path scratch;
+    std::vector<State> stack;
+    Attributes attributes;
+    bool foundSvgElement = false;
+    juce::String unsupportedFeature;
+    std::function<void(float)> onProgress;
+    std::function<bool()> shouldCancel;
+    bool cancelled = false;
+
+    size_t reservedFloats = 0;
+    size_t emittedFloats = 0;
+    size_t largestElementFloats = 0;
+    size_t deepestStack = 0;
+
+    SVGPathLoader(char const* data, size_t size) :
+        begin(data),
+        end(data + size)
+    {
+        reservedFloats = juce::jmin(size / 4, (size_t)1 << 26);
+        path.preallocateSpace((int)reservedFloats);
+        stack.reserve(32);
+        stack.emplace_back();
+    }
+
+    size_t getPeakBytes() const noexcept
+    {
+        return (juce::jmax(reservedFloats, emittedFloats) + largestElementFloats) * sizeof(float)
+            + deepestStack * sizeof(State)
+            + attributes.capacity() * sizeof(Attributes::value_type);
+    }
+
+    //==============================================================================
+    //
+    // Tag scanner
+    //
+    static char const* find(char const* p, char const* limit, std::string_view pattern) noexcept
+    {
+        auto found = std::search(p, limit, pattern.begin(), pattern.end());
+        return found == limit ? limit : found + pattern.size();
+    }
+
+    static bool startsWith(char const* p, char const* limit, std::string_view prefix) noexcept
+    {
+        return (size_t)(limit - p) >= prefix.size() && std::equal(prefix.begin(), prefix.end(), p);
+    }
+
+    static bool isWhitespace(char c) noexcept
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    bool parse()
+    {
+        static constexpr size_t progressInterval = 1 << 16;
+        auto p = begin;
+        auto nextProgress = begin;
+
+        while (p < end)
+        {
+            if (p >= nextProgress)
+            {
+                if (shouldCancel && shouldCancel())
+                {
+                    cancelled = true;
+                    return false;
+                }
+
+                if (onProgress)
+                {
+                    onProgress((float)(p - begin) / (float)(end - begin));
+                }
+
+                nextProgress = p + progressInterval;
+            }
+
+            p = std::find(p, end, '<');
+            if (p == end)
+            {
+                break;
+            }
+
+            ++p;
+
+            if (startsWith(p, end, "!--"))
+            {
+                p = find(p, end, "-->");
+                continue;
+            }
+
+            if (startsWith(p, end, "![CDATA["))
+            {
+                p = find(p, end, "]]>");
+                continue;
+            }
+
+            if (p < end && (*p == '?' || *p == '!'))
+            {
+                p = find(p, end, ">");
+                continue;
+            }
+
+            if (p < end && *p == '/')
+            {
+                if (stack.size() > 1)
+                {
+                    stack.pop_back();
+                }
+
+                p = find(p, end, ">");
+                continue;
+            }
+
+            auto nameStart = p;
+            while (p < end && ! isWhitespace(*p) && *p != '/' && *p != '>')
+            {
+                ++p;
+            }
+
+            std::string_view name{ nameStart, (size_t)(p - nameStart) };
+            bool selfClosing = false;
+            p = parseAttributes(p, selfClosing);
+
+            if (! handleElement(name, selfClosing))
+            {
+                return false;
+            }
+        }
+
+        if (! foundSvgElement)
+        {
+            unsupportedFeature = "no <svg> element";
+            return false;
+        }
+
+        return true;
+    }
+
+    char const* parseAttributes(char const* p, bool& selfClosing)
+    {
+        attributes.clear();
+
+        while (p < end)
+        {
+            while (p < end && isWhitespace(*p))
+            {
+                ++p;
+            }
+
+            if (p >= end)
+            {
+                break;
+            }
+
+            if (*p == '>')
+            {
+                return p + 1;
+            }
+
+            if (*p == '/')
+            {
+                selfClosing = true;
+                ++p;
+                continue;
+            }
+
+            auto nameStart = p;
+            while (p < end && *p != '=' && ! isWhitespace(*p) && *p != '>' && *p != '/')
+            {
+                ++p;
+            }
+
+            std::string_view attributeName{ nameStart, (size_t)(p - nameStart) };
+
+            while (p < end && isWhitespace(*p))
+            {
+                ++p;
+            }
+
+            if (p >= end || *p != '=')
+            {
+                continue;
+            }
+
+            ++p;
+            while (p < end && isWhitespace(*p))
+            {
+                ++p;
+            }
+
+            if (p >= end || (*p != '"' && *p != '\''))
+            {
+                continue;
+            }
+
+            auto quote = *p++;
+            auto valueStart = p;
+            p = std::find(p, end, quote);
+            attributes.push_back({ attributeName, std::string_view{ valueStart, (size_t)(p - valueStart) } });
+
+            if (p < end)
+            {
+                ++p;
+            }
+        }
+
+        return p;
+    }
+
+    //==============================================================================
+    //
+    // Elements
+    //
+    std::string_view getAttribute(std::string_view name) const noexcept
+    {
+        for (auto const& [attributeName, value] : attributes)
+        {
+            if (attributeName == name)
+            {
+                return value;
+            }
+        }
+
+        return {};
+    }
+
+    //
+    // Presentation attributes can also come from the style attribute, which takes priority
+    //
+    std::string_view getStyleAttribute(std::string_view name) const noexcept
+    {
+        auto style = getAttribute("style");
+
+        while (! style.empty())
+        {
+            auto semicolon = style.find(';');
+            auto declaration = style.substr(0, semicolon);
+            style = semicolon == std::string_view::npos ? std::string_view{} : style.substr(semicolon + 1);
+
+            auto colon = declaration.find(':');
+            if (colon == std::string_view::npos)
+            {
+                continue;
+            }
+
+            if (trim(declaration.substr(0, colon)) == name)
+            {
+                return trim(declaration.substr(colon + 1));
+            }
+        }
+
+        return getAttribute(name);
+    }
+
+    static std::string_view trim(std::string_view text) noexcept
+    {
+        while (! text.empty() && isWhitespace(text.front()))
+            text.remove_prefix(1);
+
+        while (! text.empty() && isWhitespace(text.back()))
+            text.remove_suffix(1);
+
+        return text;
+    }
+
+    bool unsupported(juce::String feature)
+    {
+        unsupportedFeature = feature;
+        return false;
+    }
+
+    bool handleElement(std::string_view name, bool selfClosing)
+    {
+        auto const& parent = stack.back();
+        State state = parent;
+        state.elementName = name;
+
+        if (! parent.hidden)
+        {
+            static constexpr std::array<std::string_view, 8> unsupportedElements{ "use", "text", "image", "style", "foreignObject", "switch", "textPath", "tspan" };
+            if (std::find(unsupportedElements.begin(), unsupportedElements.end(), name) != unsupportedElements.end())
+            {
+                return unsupported("<" + juce::String{ name.data(), name.size() } + ">");
+            }
+
+            for (auto attributeName : { "clip-path", "mask", "stroke-dasharray" })
+            {
+                auto value = getStyleAttribute(attributeName);
+                if (! value.empty() && value != "none")
+                {
+                    return unsupported(attributeName);
+                }
+            }
+
+            static constexpr std::array<std::string_view, 12> nonRenderingElements{ "defs", "symbol", "title", "desc", "metadata", "linearGradient",
+                "radialGradient", "pattern", "marker", "clipPath", "mask", "filter" };
+            if (std::find(nonRenderingElements.begin(), nonRenderingElements.end(), name) != nonRenderingElements.end()
+                || name.find(':') != std::string_view::npos
+                || getStyleAttribute("display") == "none")
+            {
+                state.hidden = true;
+            }
+        }
+
+        if (! state.hidden)
+        {
+            if (name == "svg")
+            {
+                if (foundSvgElement)
+                {
+                    return unsupported("nested <svg>");
+                }
+
+                foundSvgElement = true;
+                if (! applyViewBox(state))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                state.transform = parseTransform(getAttribute("transform")).followedBy(parent.transform);
+            }
+
+            for (auto [attributeName, member] : { std::pair{ "stroke", &State::stroke },
+                                                  std::pair{ "stroke-width", &State::strokeWidth },
+                                                  std::pair{ "stroke-linejoin", &State::strokeLineJoin },
+                                                  std::pair{ "stroke-linecap", &State::strokeLineCap } })
+            {
+                auto value = getStyleAttribute(attributeName);
+                if (! value.empty() && value != "inherit")
+                {
+                    state.*member = value;
+                }
+            }
+
+            if (! addShape(name, state))
+            {
+                return false;
+            }
+        }
+
+        if (! selfClosing)
+        {
+            stack.push_back(state);
+            deepestStack = juce::jmax(deepestStack, stack.size());
+        }
+
+        return true;
+    }
+
+    bool applyViewBox(State& state)
+    {
+        auto viewBox = getAttribute("viewBox");
+        float viewBoxValues[4];
+        auto p = viewBox.data(), limit = p + viewBox.size();
+        bool hasViewBox = ! viewBox.empty();
+
+        for (auto& value : viewBoxValues)
+        {
+            hasViewBox = hasViewBox && readNumber(p, limit, value);
+        }
+
+        state.transform = parseTransform(getAttribute("transform"));
+
+        if (! hasViewBox || viewBoxValues[2] <= 0.0f || viewBoxValues[3] <= 0.0f)
+        {
+            return true;
+        }
+
+        juce::Rectangle<float> viewBoxArea{ viewBoxValues[0], viewBoxValues[1], viewBoxValues[2], viewBoxValues[3] };
+        state.viewBoxWidth = viewBoxArea.getWidth();
+        state.viewBoxHeight = viewBoxArea.getHeight();
+
+        //
+        // Missing or percentage sizes mean the viewBox size
+        //
+        auto width = viewBoxArea.getWidth(), height = viewBoxArea.getHeight();
+        auto widthAttribute = getAttribute("width"), heightAttribute = getAttribute("height");
+        if (! widthAttribute.empty() && widthAttribute.back() != '%')
+            parseLength(widthAttribute, width);
+        if (! heightAttribute.empty() && heightAttribute.back() != '%')
+            parseLength(heightAttribute, height);
+
+        int placement = juce::RectanglePlacement::centred;
+        auto aspect = trim(getAttribute("preserveAspectRatio"));
+        if (aspect == "none")
+        {
+            placement = juce::RectanglePlacement::stretchToFit;
+        }
+        else if (! aspect.empty())
+        {
+            placement = 0;
+            placement |= aspect.find("xMin") != std::string_view::npos ? juce::RectanglePlacement::xLeft
+                : aspect.find("xMax") != std::string_view::npos ? juce::RectanglePlacement::xRight : juce::RectanglePlacement::xMid;
+            placement |= aspect.find("YMin") != std::string_view::npos ? juce::RectanglePlacement::yTop
+                : aspect.find("YMax") != std::string_view::npos ? juce::RectanglePlacement::yBottom : juce::RectanglePlacement::yMid;
+
+            if (aspect.find("slice") != std::string_view::npos)
+                placement |= juce::RectanglePlacement::fillDestination;
+        }
+
+        state.transform = juce::RectanglePlacement{ placement }.getTransformToFit(viewBoxArea, { width, height }).followedBy(state.transform);
+        return true;
+    }
+
+    //==============================================================================
+    //
+    // Shapes
+    //
+    bool getLength(std::string_view attributeName, float& value, float defaultValue = 0.0f)
+    {
+        value = defaultValue;
+        auto text = getAttribute(attributeName);
+        if (text.empty())
+        {
+            return true;
+        }
+
+        if (text.back() == '%')
+        {
+            return unsupported("percentage lengths");
+        }
+
+        parseLength(text, value);
+        return true;
+    }
+
+    bool addShape(std::string_view name, State const& state)
+    {
+        scratch.clear();
+        size_t numValues = 0;
+
+        if (name == "path")
+        {
+            numValues = parsePathData(getAttribute("d"), scratch);
+        }
+        else if (name == "rect")
+        {
+            float x, y, width, height, rx, ry;
+            if (! (getLength("x", x) && getLength("y", y) && getLength("width", width) && getLength("height", height)
+                && getLength("rx", rx, -1.0f) && getLength("ry", ry, -1.0f)))
+                return false;
+
+            if (rx < 0.0f) rx = juce::jmax(0.0f, ry);
+            if (ry < 0.0f) ry = rx;
+
+            if (width > 0.0f && height > 0.0f)
+            {
+                if (rx > 0.0f || ry > 0.0f)
+                    scratch.addRoundedRectangle(x, y, width, height, juce::jmin(rx, width * 0.5f), juce::jmin(ry, height * 0.5f));
+                else
+                    scratch.addRectangle(x, y, width, height);
+            }
+
+            numValues = 6;
+        }
+        else if (name == "circle" || name == "ellipse")
+        {
+            float cx, cy, rx, ry;
+            if (! (getLength("cx", cx) && getLength("cy", cy)))
+                return false;
+
+            if (name == "circle")
+            {
+                if (! getLength("r", rx))
+                    return false;
+                ry = rx;
+            }
+            else if (! (getLength("rx", rx) && getLength("ry", ry)))
+            {
+                return false;
+            }
+
+            if (rx > 0.0f && ry > 0.0f)
+                scratch.addEllipse(cx - rx, cy - ry, rx * 2.0f, ry * 2.0f);
+
+            numValues = 4;
+        }
+        else if (name == "line")
+        {
+            float x1, y1, x2, y2;
+            if (! (getLength("x1", x1) && getLength("y1", y1) && getLength("x2", x2) && getLength("y2", y2)))
+                return false;
+
+            scratch.startNewSubPath(x1, y1);
+            scratch.lineTo(x2, y2);
+            numValues = 4;
+        }
+        else if (name == "polyline" || name == "polygon")
+        {
+            auto points = getAttribute("points");
+            auto p = points.data(), limit = p + points.size();
+            float x, y;
+
+            if (readNumber(p, limit, x) && readNumber(p, limit, y))
+            {
+                scratch.startNewSubPath(x, y);
+                numValues = 2;
+
+                while (readNumber(p, limit, x) && readNumber(p, limit, y))
+                {
+                    scratch.lineTo(x, y);
+                    numValues += 2;
+                }
+
+                if (name == "polygon")
+                    scratch.closeSubPath();
+            }
+        }
+        else
+        {
+            return true;
+        }
+
+        if (scratch.isEmpty())
+        {
+            return true;
+        }
+
+        auto elementFloats = numValues * 3 / 2 + 8;
+        largestElementFloats = juce::jmax(largestElementFloats, elementFloats);
+        emittedFloats += elementFloats;
+
+        //
+        // Strokes are widened in the shape's own coordinates and then transformed, as DrawablePath does,
+        // so non-uniform scales and shears distort the stroke the same way
+        //
+        if (isStrokeVisible(state))
+        {
+            float strokeWidth = 1.0f;
+            if (! state.strokeWidth.empty())
+                parseLength(state.strokeWidth, strokeWidth);
+
+            auto jointStyle = state.strokeLineJoin == "round" ? juce::PathStrokeType::curved
+                : state.strokeLineJoin == "bevel" ? juce::PathStrokeType::beveled : juce::PathStrokeType::mitered;
+            auto endCapStyle = state.strokeLineCap == "round" ? juce::PathStrokeType::rounded
+                : state.strokeLineCap == "square" ? juce::PathStrokeType::square : juce::PathStrokeType::butt;
+
+            juce::Path stroke;
+            juce::PathStrokeType{ strokeWidth, jointStyle, endCapStyle }.createStrokedPath(stroke, scratch);
+            path.addPath(stroke, state.transform);
+            return true;
+        }
+
+        path.addPath(scratch, state.transform);
+        return true;
+    }
+
+    static bool isStrokeVisible(State const& state) noexcept
+    {
+        return ! state.stroke.empty() && state.stroke != "none" && state.stroke != "transparent";
+    }
+
+    //==============================================================================
+    //
+    // Numbers, lengths, and transforms
+    //
+    static void skipSeparators(char const*& p, char const* limit) noexcept
+    {
+        while (p < limit && (isWhitespace(*p) || *p == ','))
+        {
+            ++p;
+        }
+    }
+
+    static bool isDigit(char c) noexcept
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    //
+    // SVG number grammar; "1.5.5" is two numbers and "1-2" is two numbers
+    //
+    static bool readNumber(char const*& p, char const* limit, float& value) noexcept
+    {
+        skipSeparators(p, limit);
+
+        auto q = p;
+        double sign = 1.0;
+        if (q < limit && (*q == '-' || *q == '+'))
+        {
+            sign = *q == '-' ? -1.0 : 1.0;
+            ++q;
+        }
+
+        double mantissa = 0.0;
+        bool hasDigits = false;
+        while (q < limit && isDigit(*q))
+        {
+            mantissa = mantissa * 10.0 + (*q++ - '0');
+            hasDigits = true;
+        }
+
+        if (q < limit && *q == '.')
+        {
+            ++q;
+            double scale = 0.1;
+            while (q < limit && isDigit(*q))
+            {
+                mantissa += (*q++ - '0') * scale;
+                scale *= 0.1;
+                hasDigits = true;
+            }
+        }
+
+        if (! hasDigits)
+        {
+            return false;
+        }
+
+        if (q < limit && (*q == 'e' || *q == 'E'))
+        {
+            auto e = q + 1;
+            int exponentSign = 1;
+            if (e < limit && (*e == '-' || *e == '+'))
+            {
+                exponentSign = *e == '-' ? -1 : 1;
+                ++e;
+            }
+
+            if (e < limit && isDigit(*e))
+            {
+                int exponent = 0;
+                while (e < limit && isDigit(*e))
+                {
+                    exponent = juce::jmin(exponent * 10 + (*e++ - '0'), 400);
+                }
+
+                mantissa *= std::pow(10.0, exponentSign * exponent);
+                q = e;
+            }
+        }
+
+        value = (float)(sign * mantissa);
+        p = q;
+        return true;
+    }
+
+    static bool readFlag(char const*& p, char const* limit, bool& flag) noexcept
+    {
+        skipSeparators(p, limit);
+
+        if (p < limit && (*p == '0' || *p == '1'))
+        {
+            flag = *p++ == '1';
+            return true;
+        }
+
+        return false;
+    }
+
+    //
+    // Same units and conversions as the Drawable SVG parser, at 96 dpi
+    //
+    static bool parseLength(std::string_view text, float& value) noexcept
+    {
+        auto p = text.data(), limit = p + text.size();
+        if (! readNumber(p, limit, value))
+        {
+            return false;
+        }
+
+        std::string_view units{ p, (size_t)(limit - p) };
+        units = trim(units);
+
+        if (units == "in")      value *= 96.0f;
+        else if (units == "cm") value *= 96.0f / 2.54f;
+        else if (units == "mm") value *= 96.0f / 25.4f;
+        else if (units == "pt") value *= 1.25f;
+        else if (units == "pc") value *= 15.0f;
+
+        return true;
+    }
+
+    static juce::AffineTransform parseTransform(std::string_view text) noexcept
+    {
+        juce::AffineTransform result;
+        auto p = text.data(), limit = p + text.size();
+
+        while (p < limit)
+        {
+            skipSeparators(p, limit);
+
+            auto nameStart = p;
+            while (p < limit && std::isalpha((unsigned char)*p))
+            {
+                ++p;
+            }
+
+            std::string_view name{ nameStart, (size_t)(p - nameStart) };
+            p = std::find(p, limit, '(');
+            if (name.empty() || p == limit)
+            {
+                break;
+            }
+
+            ++p;
+            float values[6] = {};
+            int numValues = 0;
+            while (numValues < 6 && readNumber(p, limit, values[numValues]))
+            {
+                ++numValues;
+            }
+
+            p = std::find(p, limit, ')');
+            if (p < limit)
+            {
+                ++p;
+            }
+
+            juce::AffineTransform item;
+            if (name == "matrix" && numValues == 6)
+                item = { values[0], values[2], values[4], values[1], values[3], values[5] };
+            else if (name == "translate" && numValues >= 1)
+                item = juce::AffineTransform::translation(values[0], numValues > 1 ? values[1] : 0.0f);
+            else if (name == "scale" && numValues >= 1)
+                item = juce::AffineTransform::scale(values[0], numValues > 1 ? values[1] : values[0]);
+            else if (name == "rotate" && numValues >= 1)
+                item = numValues >= 3 ? juce::AffineTransform::rotation(juce::degreesToRadians(values[0]), values[1], values[2])
+                                      : juce::AffineTransform::rotation(juce::degreesToRadians(values[0]));
+            else if (name == "skewX" && numValues >= 1)
+                item = juce::AffineTransform::shear(std::tan(juce::degreesToRadians(values[0])), 0.0f);
+            else if (name == "skewY" && numValues >= 1)
+                item = juce::AffineTransform::shear(0.0f, std::tan(juce::degreesToRadians(values[0])));
+
+            //
+            // The rightmost transform in the list applies first
+            //
+            result = item.followedBy(result);
+        }
+
+        return result;
+    }
+
+    //==============================================================================
+    //
+    // Path data; stops at the first error and keeps what it has, like a browser does.
+    // Returns the number of values read.
+    //
+    static size_t parsePathData(std::string_view data, juce::Path& dest)
+    {
+        auto p = data.data(), limit = p + data.size();
+        char command = 0, lastCommand = 0;
+        juce::Point<float> current, subPathStart, lastControl;
+        size_t numValues = 0;
+
+        auto read = [&](float& value)
+            {
+                if (! readNumber(p, limit, value))
+                    return false;
+
+                ++numValues;
+                return true;
+            };
+
+        auto readPoint = [&](juce::Point<float>& point, bool relative)
+            {
+                if (! (read(point.x) && read(point.y)))
+                    return false;
+
+                if (relative)
+                    point += current;
+
+                return true;
+            };
+
+        while (true)
+        {
+            skipSeparators(p, limit);
+            if (p >= limit)
+            {
+                break;
+            }
+
+            if (std::isalpha((unsigned char)*p))
+            {
+                command = *p++;
+
+                if (command == 'z' || command == 'Z')
+                {
+                    dest.closeSubPath();
+                    current = subPathStart;
+                    lastCommand = 'Z';
+                    continue;
+                }
+            }
+            else if (command == 0 || command == 'z' || command == 'Z')
+            {
+                break;
+            }
+
+            bool relative = command >= 'a' && command <= 'z';
+            auto upperCommand = (char)(relative ? command - ('a' - 'A') : command);
+            juce::Point<float> control, control2, point;
+
+            switch (upperCommand)
+            {
+            case 'M':
+                if (! readPoint(point, relative))
+                    return numValues;
+
+                dest.startNewSubPath(point);
+                current = subPathStart = point;
+
+                //
+                // Further coordinate pairs after a moveto are linetos
+                //
+                command = relative ? 'l' : 'L';
+                break;
+
+            case 'L':
+                if (! readPoint(point, relative))
+                    return numValues;
+
+                dest.lineTo(point);
+                current = point;
+                break;
+
+            case 'H':
+            {
+                float x;
+                if (! read(x))
+                    return numValues;
+
+                current.x = relative ? current.x + x : x;
+                dest.lineTo(current);
+                break;
+            }
+
+            case 'V':
+            {
+                float y;
+                if (! read(y))
+                    return numValues;
+
+                current.y = relative ? current.y + y : y;
+                dest.lineTo(current);
+                break;
+            }
+
+            case 'C':
+                if (! (readPoint(control, relative) && readPoint(control2, relative) && readPoint(point, relative)))
+                    return numValues;
+
+                dest.cubicTo(control, control2, point);
+                lastControl = control2;
+                current = point;
+                break;
+
+            case 'S':
+                control = (lastCommand == 'C' || lastCommand == 'S') ? current * 2.0f - lastControl : current;
+                if (! (readPoint(control2, relative) && readPoint(point, relative)))
+                    return numValues;
+
+                dest.cubicTo(control, control2, point);
+                lastControl = control2;
+                current = point;
+                break;
+
+            case 'Q':
+                if (! (readPoint(control, relative) && readPoint(point, relative)))
+                    return numValues;
+
+                dest.quadraticTo(control, point);
+                lastControl = control;
+                current = point;
+                break;
+
+            case 'T':
+                control = (lastCommand == 'Q' || lastCommand == 'T') ? current * 2.0f - lastControl : current;
+                if (! readPoint(point, relative))
+                    return numValues;
+
+                dest.quadraticTo(control, point);
+                lastControl = control;
+                current = point;
+                break;
+
+            case 'A':
+            {
+                float rx, ry, rotation;
+                bool largeArc, sweep;
+                if (! (read(rx) && read(ry) && read(rotation) && readFlag(p, limit, largeArc) && readFlag(p, limit, sweep) && readPoint(point, relative)))
+                    return numValues;
+
+                addArc(dest, current, point, std::abs(rx), std::abs(ry), juce::degreesToRadians(rotation), largeArc, sweep);
+                current = point;
+                break;
+            }
+
+            default:
+                return numValues;
+            }
+
+            lastCommand = upperCommand;
+        }
+
+        return numValues;
+    }
+
+    //
+    // SVG endpoint arc to JUCE centre arc, following the SVG implementation notes (F.6.5). JUCE measures
+    // arc angles clockwise from 12 o'clock, which is a quarter turn on from the SVG convention.
+    //
+    static void addArc(juce::Path& dest, juce::Point<float> start, juce::Point<float> end, float rx, float ry, float angle, bool largeArc, bool sweep)
+    {
+        if (start == end)
+        {
+            return;
+        }
+
+        if (rx <= 0.0f || ry <= 0.0f)
+        {
+            dest.lineTo(end);
+            return;
+        }
+
+        auto cosAngle = std::cos(angle), sinAngle = std::sin(angle);
+        auto halfDelta = (start - end) * 0.5f;
+        juce::Point<float> primed{ cosAngle * halfDelta.x + sinAngle * halfDelta.y, -sinAngle * halfDelta.x + cosAngle * halfDelta.y };
+
+        auto lambda = (primed.x * primed.x) / (rx * rx) + (primed.y * primed.y) / (ry * ry);
+        if (lambda > 1.0f)
+        {
+            rx *= std::sqrt(lambda);
+            ry *= std::sqrt(lambda);
+        }
+
+        auto rx2 = rx * rx, ry2 = ry * ry;
+        auto numerator = rx2 * ry2 - rx2 * primed.y * primed.y - ry2 * primed.x * primed.x;
+        auto denominator = rx2 * primed.y * primed.y + ry2 * primed.x * primed.x;
+        auto coefficient = std::sqrt(juce::jmax(0.0f, numerator / denominator)) * (largeArc != sweep ? 1.0f : -1.0f);
+
+        juce::Point<float> centrePrimed{ coefficient * rx * primed.y / ry, -coefficient * ry * primed.x / rx };
+        auto mid = (start + end) * 0.5f;
+        juce::Point<float> centre{ cosAngle * centrePrimed.x - sinAngle * centrePrimed.y + mid.x,
+            sinAngle * centrePrimed.x + cosAngle * centrePrimed.y + mid.y };
+
+        auto vectorAngle = [](float ux, float uy, float vx, float vy)
+            {
+                return std::atan2(ux * vy - uy * vx, ux * vx + uy * vy);
+            };
+
+        auto startX = (primed.x - centrePrimed.x) / rx, startY = (primed.y - centrePrimed.y) / ry;
+        auto endX = (-primed.x - centrePrimed.x) / rx, endY = (-primed.y - centrePrimed.y) / ry;
+
+        auto startAngle = vectorAngle(1.0f, 0.0f, startX, startY);
+        auto sweepAngle = vectorAngle(startX, startY, endX, endY);
+
+        if (! sweep && sweepAngle > 0.0f)
+            sweepAngle -= juce::MathConstants<float>::twoPi;
+        else if (sweep && sweepAngle < 0.0f)
+            sweepAngle += juce::MathConstants<float>::twoPi;
+
+        startAngle += juce::MathConstants<float>::halfPi;
+        dest.addCentredArc(centre.x, centre.y, rx, ry, angle, startAngle, startAngle + sweepAngle, false);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SVGPathLoader)
+};
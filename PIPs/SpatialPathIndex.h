@@ -0,0 +1,568 @@
+#pragma once
+
+//
+// Quadtree over a Path, so filling or stroking a zoomed-in view only touches the visible part
+//
+// Each node covers a quarter of its parent's area and is built lazily, from its parent, the first
+// time a draw needs it. A node keeps two things:
+//
+//  - Fill geometry clipped to the node's area. Pieces of the path inside the area are copied exactly;
+//    pieces outside are clamped onto the area's edges. Clamping moves points without crossing the
+//    inside of the area, so every point inside keeps its winding number and the clipped fill matches
+//    the real one. Clamped sub-paths that collapse onto a single edge are dropped, so a node's size
+//    depends on what crosses it rather than the size of the whole path. Curves crossing the edge are
+//    flattened at 1/4096 of the node size.
+//
+//  - The indices of the original path elements whose bounds touch the area, for stroking. The
+//    selected elements are stroked as runs of consecutive elements, so the stroke keeps its joins.
+//
+// Clipped fill pieces never leave their node's area, so the visible nodes are combined into one Path
+// and filled once without seams. Once the visible area covers the whole path, the original Path is
+// drawn instead.
+//
+class SpatialPathIndex
+{
+public:
+    SpatialPathIndex() = default;
+    ~SpatialPathIndex() = default;
+
+    void build(juce::Path const& source)
+    {
+        clear();
+
+        juce::Path::Iterator it{ source };
+        juce::Point<float> current, subPathStart;
+
+        while (it.next())
+        {
+            switch (it.elementType)
+            {
+            case juce::Path::Iterator::startNewSubPath:
+                current = subPathStart = { it.x1, it.y1 };
+                elements.push_back({ Kind::startNewSubPath, current, { current } });
+                break;
+
+            case juce::Path::Iterator::lineTo:
+                elements.push_back({ Kind::lineTo, current, { juce::Point<float>{ it.x1, it.y1 } } });
+                break;
+
+            case juce::Path::Iterator::quadraticTo:
+                elements.push_back({ Kind::quadraticTo, current, { juce::Point<float>{ it.x1, it.y1 }, { it.x2, it.y2 } } });
+                break;
+
+            case juce::Path::Iterator::cubicTo:
+                elements.push_back({ Kind::cubicTo, current, { juce::Point<float>{ it.x1, it.y1 }, { it.x2, it.y2 }, { it.x3, it.y3 } } });
+                break;
+
+            case juce::Path::Iterator::closePath:
+                elements.push_back({ Kind::closePath, current, { subPathStart } });
+                break;
+            }
+
+            current = elements.back().getEnd();
+        }
+
+        if (elements.empty())
+        {
+            return;
+        }
+
+        root = std::make_unique<Node>();
+        root->area = source.getBounds().expanded(1.0f);
+        nonZeroWinding = source.isUsingNonZeroWinding();
+    }
+
+    void clear()
+    {
+        root.reset();
+        elements.clear();
+    }
+
+    void fillPath(juce::Graphics& g, juce::Path const& path, juce::AffineTransform const& transform)
+    {
+        auto const& nodes = findVisibleNodes(g.getClipBounds().toFloat(), transform);
+        if (nodes.empty())
+        {
+            g.fillPath(path, transform);
+            return;
+        }
+
+        juce::Path visiblePath;
+        visiblePath.setUsingNonZeroWinding(nonZeroWinding);
+        size_t numElements = 0;
+
+        for (auto node : nodes)
+        {
+            appendElements(visiblePath, node->fillElements);
+            numElements += node->fillElements.size();
+        }
+
+        elementsDrawn.addValue((double)numElements);
+        g.fillPath(visiblePath, transform);
+    }
+
+    void strokePath(juce::Graphics& g, juce::Path const& path, juce::PathStrokeType const& strokeType, juce::AffineTransform const& transform)
+    {
+        //
+        // Strokes are sized after the transform, so widen the visible area before mapping it back into path
+        // coordinates; twice the thickness leaves room for mitered joins
+        //
+        auto const& nodes = findVisibleNodes(g.getClipBounds().toFloat().expanded(strokeType.getStrokeThickness() * 2.0f), transform);
+        if (nodes.empty())
+        {
+            g.strokePath(path, strokeType, transform);
+            return;
+        }
+
+        visibleIndices.clear();
+        for (auto node : nodes)
+        {
+            visibleIndices.insert(visibleIndices.end(), node->strokeIndices.begin(), node->strokeIndices.end());
+        }
+
+        std::sort(visibleIndices.begin(), visibleIndices.end());
+        visibleIndices.erase(std::unique(visibleIndices.begin(), visibleIndices.end()), visibleIndices.end());
+
+        juce::Path visiblePath;
+        appendRuns(visiblePath, visibleIndices);
+
+        elementsDrawn.addValue((double)visibleIndices.size());
+        g.strokePath(visiblePath, strokeType, transform);
+    }
+
+    juce::StatisticsAccumulator<double> elementsDrawn;
+
+private:
+    static constexpr int maxDepth = 16;
+    static constexpr size_t minElementsToSplit = 64;
+    static constexpr float flatteningDivisions = 4096.0f;
+
+    enum class Kind : juce::uint8
+    {
+        startNewSubPath,
+        lineTo,
+        quadraticTo,
+        cubicTo,
+        closePath
+    };
+
+    struct Element
+    {
+        Kind kind;
+        juce::Point<float> start;
+        std::array<juce::Point<float>, 3> points;
+
+        juce::Point<float> getEnd() const noexcept
+        {
+            return points[kind == Kind::cubicTo ? 2 : (kind == Kind::quadraticTo ? 1 : 0)];
+        }
+
+        juce::Rectangle<float> getBounds() const noexcept
+        {
+            std::array<juce::Point<float>, 4> allPoints{ start, points[0], points[1], points[2] };
+            auto numPoints = kind == Kind::cubicTo ? 4 : (kind == Kind::quadraticTo ? 3 : 2);
+            return juce::Rectangle<float>::findAreaContainingPoints(allPoints.data(), numPoints);
+        }
+    };
+
+    struct Node
+    {
+        juce::Rectangle<float> area;
+        int depth = 0;
+        std::vector<Element> fillElements;
+        std::vector<int> strokeIndices;
+        std::array<std::unique_ptr<Node>, 4> children;
+    };
+
+    std::vector<Element> elements;
+    std::unique_ptr<Node> root;
+    bool nonZeroWinding = true;
+    std::vector<Node*> visibleNodes;
+    std::vector<int> visibleIndices;
+
+    //
+    // Rectangle::intersects is false for zero-width or zero-height rectangles, which horizontal and
+    // vertical lines have
+    //
+    static bool touches(juce::Rectangle<float> a, juce::Rectangle<float> b) noexcept
+    {
+        return a.getX() <= b.getRight() && b.getX() <= a.getRight() && a.getY() <= b.getBottom() && b.getY() <= a.getBottom();
+    }
+
+    static bool contains(juce::Rectangle<float> outer, juce::Rectangle<float> inner) noexcept
+    {
+        return inner.getX() >= outer.getX() && inner.getRight() <= outer.getRight() && inner.getY() >= outer.getY() && inner.getBottom() <= outer.getBottom();
+    }
+
+    //
+    // Returns the nodes covering the visible area at roughly half its size, or nothing if the root
+    // would do, in which case the caller draws the original path
+    //
+    std::vector<Node*> const& findVisibleNodes(juce::Rectangle<float> clipBounds, juce::AffineTransform const& transform)
+    {
+        visibleNodes.clear();
+
+        if (root == nullptr || transform.isSingularity())
+        {
+            return visibleNodes;
+        }
+
+        auto visibleArea = clipBounds.transformedBy(transform.inverted());
+        if (contains(visibleArea, root->area))
+        {
+            return visibleNodes;
+        }
+
+        collect(*root, visibleArea, juce::jmax(visibleArea.getWidth(), visibleArea.getHeight()) * 0.5f);
+
+        if (visibleNodes.size() == 1 && visibleNodes.front() == root.get())
+        {
+            visibleNodes.clear();
+        }
+
+        return visibleNodes;
+    }
+
+    void collect(Node& node, juce::Rectangle<float> visibleArea, float targetSize)
+    {
+        if (! touches(node.area, visibleArea))
+        {
+            return;
+        }
+
+        auto numElements = &node == root.get() ? elements.size() : juce::jmax(node.fillElements.size(), node.strokeIndices.size());
+        if (node.depth >= maxDepth || numElements < minElementsToSplit || juce::jmax(node.area.getWidth(), node.area.getHeight()) <= targetSize)
+        {
+            visibleNodes.push_back(&node);
+            return;
+        }
+
+        if (node.children[0] == nullptr)
+        {
+            split(node);
+        }
+
+        for (auto& child : node.children)
+        {
+            collect(*child, visibleArea, targetSize);
+        }
+    }
+
+    void split(Node& parent)
+    {
+        auto const& parentFillElements = &parent == root.get() ? elements : parent.fillElements;
+        auto halfWidth = parent.area.getWidth() * 0.5f, halfHeight = parent.area.getHeight() * 0.5f;
+
+        for (int index = 0; index < 4; ++index)
+        {
+            auto child = std::make_unique<Node>();
+            child->area = { parent.area.getX() + (float)(index & 1) * halfWidth, parent.area.getY() + (float)(index >> 1) * halfHeight, halfWidth, halfHeight };
+            child->depth = parent.depth + 1;
+
+            Clipper clipper{ child->area, juce::jmax(halfWidth, halfHeight) / flatteningDivisions, child->fillElements };
+            clipper.process(parentFillElements);
+
+            auto addIfTouching = [&](int elementIndex)
+                {
+                    auto const& element = elements[(size_t)elementIndex];
+                    if (element.kind != Kind::startNewSubPath && touches(element.getBounds(), child->area))
+                    {
+                        child->strokeIndices.push_back(elementIndex);
+                    }
+                };
+
+            if (&parent == root.get())
+            {
+                for (int elementIndex = 0; elementIndex < (int)elements.size(); ++elementIndex)
+                    addIfTouching(elementIndex);
+            }
+            else
+            {
+                for (auto elementIndex : parent.strokeIndices)
+                    addIfTouching(elementIndex);
+            }
+
+            child->fillElements.shrink_to_fit();
+            child->strokeIndices.shrink_to_fit();
+            parent.children[(size_t)index] = std::move(child);
+        }
+    }
+
+    static void appendElements(juce::Path& dest, std::vector<Element> const& source)
+    {
+        for (auto const& element : source)
+        {
+            switch (element.kind)
+            {
+            case Kind::startNewSubPath: dest.startNewSubPath(element.points[0]); break;
+            case Kind::lineTo:          dest.lineTo(element.points[0]); break;
+            case Kind::quadraticTo:     dest.quadraticTo(element.points[0], element.points[1]); break;
+            case Kind::cubicTo:         dest.cubicTo(element.points[0], element.points[1], element.points[2]); break;
+            case Kind::closePath:       dest.closeSubPath(); break;
+            }
+        }
+    }
+
+    //
+    // Runs of consecutive elements become open sub-paths; a closed sub-path that's entirely visible
+    // stays closed so it keeps its closing join
+    //
+    void appendRuns(juce::Path& dest, std::vector<int> const& indices) const
+    {
+        int previousIndex = -2;
+        bool runStartsSubPath = false;
+
+        for (auto index : indices)
+        {
+            auto const& element = elements[(size_t)index];
+
+            if (index != previousIndex + 1)
+            {
+                dest.startNewSubPath(element.start);
+                runStartsSubPath = elements[(size_t)index - 1].kind == Kind::startNewSubPath;
+            }
+
+            switch (element.kind)
+            {
+            case Kind::lineTo:      dest.lineTo(element.points[0]); break;
+            case Kind::quadraticTo: dest.quadraticTo(element.points[0], element.points[1]); break;
+            case Kind::cubicTo:     dest.cubicTo(element.points[0], element.points[1], element.points[2]); break;
+
+            case Kind::closePath:
+                if (runStartsSubPath)
+                    dest.closeSubPath();
+                else
+                    dest.lineTo(element.points[0]);
+                break;
+
+            case Kind::startNewSubPath:
+                break;
+            }
+
+            previousIndex = index;
+        }
+    }
+
+    //==============================================================================
+    //
+    // Clips fill geometry to a rectangle by clamping everything outside it onto its edges
+    //
+    class Clipper
+    {
+    public:
+        Clipper(juce::Rectangle<float> area_, float tolerance_, std::vector<Element>& dest_) :
+            area(area_),
+            tolerance(tolerance_),
+            dest(dest_)
+        {
+        }
+
+        void process(std::vector<Element> const& source)
+        {
+            juce::Point<float> current, subPathStart;
+            bool open = false;
+
+            for (auto const& element : source)
+            {
+                switch (element.kind)
+                {
+                case Kind::startNewSubPath:
+                    if (open)
+                        closeSubPath(current, subPathStart);
+
+                    current = subPathStart = element.points[0];
+                    beginSubPath(current);
+                    open = true;
+                    continue;
+
+                case Kind::lineTo:
+                    addLine(current, element.points[0]);
+                    break;
+
+                case Kind::quadraticTo:
+                case Kind::cubicTo:
+                    addCurve(element);
+                    break;
+
+                case Kind::closePath:
+                    closeSubPath(current, subPathStart);
+                    open = false;
+                    break;
+                }
+
+                current = element.getEnd();
+            }
+
+            if (open)
+            {
+                closeSubPath(current, subPathStart);
+            }
+        }
+
+    private:
+        enum Edge
+        {
+            left = 1,
+            right = 2,
+            top = 4,
+            bottom = 8
+        };
+
+        juce::Rectangle<float> const area;
+        float const tolerance;
+        std::vector<Element>& dest;
+
+        size_t subPathIndex = 0;
+        int subPathEdges = 0;
+        juce::Point<float> lastPoint;
+
+        juce::Point<float> clamp(juce::Point<float> point) const noexcept
+        {
+            return { juce::jlimit(area.getX(), area.getRight(), point.x), juce::jlimit(area.getY(), area.getBottom(), point.y) };
+        }
+
+        int getEdges(juce::Point<float> point) const noexcept
+        {
+            return (point.x == area.getX() ? left : 0) | (point.x == area.getRight() ? right : 0)
+                | (point.y == area.getY() ? top : 0) | (point.y == area.getBottom() ? bottom : 0);
+        }
+
+        void beginSubPath(juce::Point<float> point)
+        {
+            point = clamp(point);
+            subPathIndex = dest.size();
+            subPathEdges = getEdges(point);
+            lastPoint = point;
+            dest.push_back({ Kind::startNewSubPath, point, { point } });
+        }
+
+        void lineTo(juce::Point<float> point)
+        {
+            if (point == lastPoint)
+            {
+                return;
+            }
+
+            auto edges = getEdges(point);
+            subPathEdges &= edges;
+
+            //
+            // Consecutive points along the same edge only need the last one
+            //
+            if (dest.size() > subPathIndex + 1)
+            {
+                auto const& previous = dest[dest.size() - 2];
+                auto const& last = dest.back();
+                if (last.kind == Kind::lineTo && (getEdges(previous.getEnd()) & getEdges(last.points[0]) & edges) != 0)
+                {
+                    dest.back().points[0] = point;
+                    lastPoint = point;
+                    return;
+                }
+            }
+
+            dest.push_back({ Kind::lineTo, lastPoint, { point } });
+            lastPoint = point;
+        }
+
+        void addLine(juce::Point<float> start, juce::Point<float> end)
+        {
+            //
+            // Split the line where it crosses the lines through the area's edges; each piece is then either
+            // inside the area, or outside on one side of it and clamps onto that side
+            //
+            std::array<float, 6> splits;
+            size_t numSplits = 0;
+            splits[numSplits++] = 0.0f;
+
+            auto addCrossing = [&](float from, float to, float edge)
+                {
+                    if ((from < edge && to > edge) || (from > edge && to < edge))
+                        splits[numSplits++] = (edge - from) / (to - from);
+                };
+
+            addCrossing(start.x, end.x, area.getX());
+            addCrossing(start.x, end.x, area.getRight());
+            addCrossing(start.y, end.y, area.getY());
+            addCrossing(start.y, end.y, area.getBottom());
+            std::sort(splits.begin() + 1, splits.begin() + numSplits);
+            splits[numSplits++] = 1.0f;
+
+            for (size_t index = 1; index < numSplits; ++index)
+            {
+                auto pieceEnd = index == numSplits - 1 ? end : start + (end - start) * splits[index];
+                lineTo(clamp(pieceEnd));
+            }
+        }
+
+        void addCurve(Element const& element)
+        {
+            auto bounds = element.getBounds();
+
+            if (contains(area, bounds))
+            {
+                subPathEdges = 0;
+                lastPoint = element.getEnd();
+                dest.push_back(element);
+                return;
+            }
+
+            if (! touches(area, bounds))
+            {
+                lineTo(clamp(element.getEnd()));
+                return;
+            }
+
+            //
+            // Wang's formula for the number of line segments that keeps the curve within tolerance
+            //
+            auto const& p = element.points;
+            auto p0 = element.start;
+            int numSegments;
+
+            if (element.kind == Kind::quadraticTo)
+            {
+                auto second = (p0 - p[0] * 2.0f + p[1]).getDistanceFromOrigin();
+                numSegments = (int)std::ceil(std::sqrt(second * 0.25f / tolerance));
+            }
+            else
+            {
+                auto second = juce::jmax((p0 - p[0] * 2.0f + p[1]).getDistanceFromOrigin(), (p[0] - p[1] * 2.0f + p[2]).getDistanceFromOrigin());
+                numSegments = (int)std::ceil(std::sqrt(second * 0.75f / tolerance));
+            }
+
+            numSegments = juce::jlimit(1, 4096, numSegments);
+            auto previous = p0;
+
+            for (int segment = 1; segment <= numSegments; ++segment)
+            {
+                auto t = (float)segment / (float)numSegments;
+                auto u = 1.0f - t;
+                auto point = element.kind == Kind::quadraticTo
+                    ? p0 * (u * u) + p[0] * (2.0f * u * t) + p[1] * (t * t)
+                    : p0 * (u * u * u) + p[0] * (3.0f * u * u * t) + p[1] * (3.0f * u * t * t) + p[2] * (t * t * t);
+
+                addLine(previous, point);
+                previous = point;
+            }
+        }
+
+        void closeSubPath(juce::Point<float> current, juce::Point<float> subPathStart)
+        {
+            addLine(current, subPathStart);
+
+            //
+            // A sub-path lying along a single edge encloses nothing inside the area
+            //
+            if (subPathEdges != 0)
+            {
+                dest.resize(subPathIndex);
+                return;
+            }
+
+            dest.push_back({ Kind::closePath, lastPoint, { lastPoint } });
+        }
+    };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpatialPathIndex)
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+//
+// Vectorised post-processing kernels for spectrum frames
+//
+// These run once per frame per channel, so they avoid per-bin branches and use SSE2 where
+// FloatVectorOperations doesn't already provide the operation. Everything works in place if
+// dest and src are the same array.
+//
+struct SpectrumKernels
+{
+    //
+    // Interleaved real/imaginary pairs, as produced by dsp::FFT::performRealOnlyForwardTransform,
+    // to magnitudes
+    //
+    static void complexToMagnitude(float* dest, float const* interleavedComplex, int numBins) noexcept
+    {
+        int bin = 0;
+
+#if JUCE_INTEL
+        for (; bin + 4 <= numBins; bin += 4)
+        {
+            auto a = _mm_loadu_ps(interleavedComplex + bin * 2);
+            auto b = _mm_loadu_ps(interleavedComplex + bin * 2 + 4);
+            a = _mm_mul_ps(a, a);
+            b = _mm_mul_ps(b, b);
+
+            auto realSquared = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            auto imaginarySquared = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(dest + bin, _mm_sqrt_ps(_mm_add_ps(realSquared, imaginarySquared)));
+        }
+#endif
+
+        for (; bin < numBins; ++bin)
+        {
+            auto real = interleavedComplex[bin * 2];
+            auto imaginary = interleavedComplex[bin * 2 + 1];
+            dest[bin] = std::sqrt(real * real + imaginary * imaginary);
+        }
+    }
+
+    //
+    // Linear magnitudes to decibels, clamped at floorDecibels
+    //
+    // The SSE2 path splits each value into exponent and mantissa and evaluates log2 of the mantissa with
+    // an odd polynomial in (m - 1) / (m + 1); the error is well below 0.001 dB.
+    //
+    static void magnitudeToDecibels(float* dest, float const* src, int num, float floorDecibels) noexcept
+    {
+        auto floorGain = juce::Decibels::decibelsToGain(floorDecibels, floorDecibels - 1.0f);
+        int index = 0;
+
+#if JUCE_INTEL
+        auto const floorRegister = _mm_set1_ps(floorGain);
+        auto const mantissaMask = _mm_set1_epi32(0x007fffff);
+        auto const one = _mm_set1_ps(1.0f);
+        auto const oneBits = _mm_set1_epi32(0x3f800000);
+        auto const exponentBias = _mm_set1_epi32(127);
+        auto const sqrtTwo = _mm_set1_ps(1.41421356f);
+        auto const half = _mm_set1_ps(0.5f);
+        auto const twoOverLn2 = 2.88539008f;
+        auto const c1 = _mm_set1_ps(twoOverLn2);
+        auto const c3 = _mm_set1_ps(twoOverLn2 / 3.0f);
+        auto const c5 = _mm_set1_ps(twoOverLn2 / 5.0f);
+        auto const c7 = _mm_set1_ps(twoOverLn2 / 7.0f);
+        auto const decibelsPerOctave = _mm_set1_ps(6.02059991f);
+
+        for (; index + 4 <= num; index += 4)
+        {
+            auto x = _mm_max_ps(_mm_loadu_ps(src + index), floorRegister);
+            auto bits = _mm_castps_si128(x);
+
+            auto exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), exponentBias);
+            auto mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, mantissaMask), oneBits));
+
+            //
+            // Fold the mantissa into [sqrt(0.5), sqrt(2)) to keep the polynomial argument small
+            //
+            auto fold = _mm_cmpgt_ps(mantissa, sqrtTwo);
+            mantissa = _mm_sub_ps(mantissa, _mm_and_ps(fold, _mm_mul_ps(mantissa, half)));
+            exponent = _mm_sub_epi32(exponent, _mm_castps_si128(fold));
+
+            auto t = _mm_div_ps(_mm_sub_ps(mantissa, one), _mm_add_ps(mantissa, one));
+            auto t2 = _mm_mul_ps(t, t);
+            auto polynomial = _mm_add_ps(c5, _mm_mul_ps(t2, c7));
+            polynomial = _mm_add_ps(c3, _mm_mul_ps(t2, polynomial));
+            polynomial = _mm_add_ps(c1, _mm_mul_ps(t2, polynomial));
+
+            auto log2 = _mm_add_ps(_mm_cvtepi32_ps(exponent), _mm_mul_ps(t, polynomial));
+            _mm_storeu_ps(dest + index, _mm_mul_ps(log2, decibelsPerOctave));
+        }
+#endif
+
+        for (; index < num; ++index)
+        {
+            dest[index] = 20.0f * std::log10(juce::jmax(src[index], floorGain));
+        }
+    }
+
+    //
+    // One-pole exponential smoothing; state = state + (1 - smoothing) * (src - state)
+    //
+    // smoothing is between 0 (no smoothing) and 1 (frozen)
+    //
+    static void smooth(float* state, float const* src, float smoothing, int num) noexcept
+    {
+        juce::FloatVectorOperations::multiply(state, smoothing, num);
+        juce::FloatVectorOperations::addWithMultiply(state, src, 1.0f - smoothing, num);
+    }
+
+    //
+    // Peak hold with multiplicative decay; peaks = max(peaks * decay, src)
+    //
+    static void peakHold(float* peaks, float const* src, float decay, int num) noexcept
+    {
+        juce::FloatVectorOperations::multiply(peaks, decay, num);
+        juce::FloatVectorOperations::max(peaks, peaks, src, num);
+    }
+
+    //
+    // Resamples linearly spaced FFT bins onto logarithmically spaced display points
+    //
+    // Where several bins fall into one display point the point takes their maximum, so narrow peaks
+    // don't disappear at the top end; where the display points are denser than the bins the bins are
+    // linearly interpolated. The per-point bin ranges are calculated once in prepare().
+    //
+    class LogFrequencyResampler
+    {
+    public:
+        void prepare(int numBins_, int numPoints_, float lowestBin = 1.0f)
+        {
+            if (numBins_ == numBins && numPoints_ == numPoints)
+            {
+                return;
+            }
+
+            numBins = numBins_;
+            numPoints = numPoints_;
+            ranges.resize((size_t)numPoints);
+
+            auto highestBin = (float)(numBins - 1);
+            auto ratio = highestBin / lowestBin;
+            auto pointToBin = [&](float point)
+                {
+                    return lowestBin * std::pow(ratio, point / (float)juce::jmax(1, numPoints - 1));
+                };
+
+            for (int point = 0; point < numPoints; ++point)
+            {
+                auto& range = ranges[(size_t)point];
+                auto centre = pointToBin((float)point);
+                auto start = (int)std::ceil(pointToBin((float)point - 0.5f));
+                auto end = (int)std::ceil(pointToBin((float)point + 0.5f));
+
+                range.start = juce::jlimit(0, numBins - 1, start);
+                range.length = juce::jlimit(0, numBins - range.start, end - start);
+
+                range.interpolationBin = juce::jlimit(0, numBins - 2, (int)centre);
+                range.fraction = juce::jlimit(0.0f, 1.0f, centre - (float)range.interpolationBin);
+            }
+        }
+
+        void process(float* dest, float const* bins) const noexcept
+        {
+            for (int point = 0; point < numPoints; ++point)
+            {
+                auto const& range = ranges[(size_t)point];
+
+                if (range.length >= 2)
+                {
+                    dest[point] = juce::FloatVectorOperations::findMaximum(bins + range.start, range.length);
+                    continue;
+                }
+
+                auto low = bins[range.interpolationBin];
+                dest[point] = low + range.fraction * (bins[range.interpolationBin + 1] - low);
+            }
+        }
+
+        int getNumPoints() const noexcept { return numPoints; }
+
+    private:
+        struct Range
+        {
+            int start;
+            int length;
+            int interpolationBin;
+            float fraction;
+        };
+
+        std::vector<Range> ranges;
+        int numBins = 0;
+        int numPoints = 0;
+    };
+};
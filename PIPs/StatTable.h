@@ -12,6 +12,12 @@ private:
         String name;
         int index;
         size_t lastCount;
+
+        //
+        // Rows can also show an accumulator owned by the application instead of one of the
+        // renderer's PaintStats
+        //
+        juce::StatisticsAccumulator<double>* accumulator = nullptr;
     };
 
     juce::Array<AccumulatorInfo> accumulatorsInfo
@@ -94,6 +100,14 @@ public:
                 {
                     paintStats->reset();
                 }
+
+                for (auto& info : accumulatorsInfo)
+                {
+                    if (info.accumulator)
+                    {
+                        info.accumulator->reset();
+                    }
+                }
             };
 
         setSize(350, 150);
@@ -138,10 +152,10 @@ public:
     {
         g.setColour(juce::Colours::white);
 
-        if (auto paintStats = getPaintStats())
+        auto const& info = accumulatorsInfo.getReference(rowNumber);
+        if (auto accumPointer = getAccumulator(info))
         {
-            auto const& info = accumulatorsInfo[rowNumber];
-            auto const& accum = paintStats->getAccumulator(info.index);
+            auto const& accum = *accumPointer;
 
             switch (columnId)
             {
@@ -172,15 +186,14 @@ public:
     {
         bool repaintNeeded = false;
 
-        if (auto paintStats = getPaintStats())
+        for (auto& info : accumulatorsInfo)
         {
-            for (auto& info : accumulatorsInfo)
+            if (auto accum = getAccumulator(info))
             {
-                auto const& accum = paintStats->getAccumulator(info.index);
-                if (accum.getCount() != info.lastCount)
+                if (accum->getCount() != info.lastCount)
                 {
                     repaintNeeded = true;
-                    info.lastCount = accum.getCount();
+                    info.lastCount = accum->getCount();
                 }
             }
         }
@@ -196,6 +209,28 @@ public:
         table.updateContent();
     }
 
+    void addAccumulator(String name, juce::StatisticsAccumulator<double>& accumulator)
+    {
+        accumulatorsInfo.add({ name, -1, 0, &accumulator });
+        setSize(getWidth(), getHeight() + table.getRowHeight());
+        update();
+    }
+
+    juce::StatisticsAccumulator<double> const* getAccumulator(AccumulatorInfo const& info) const
+    {
+        if (info.accumulator)
+        {
+            return info.accumulator;
+        }
+
+        if (auto paintStats = getPaintStats())
+        {
+            return &paintStats->getAccumulator(info.index);
+        }
+
+        return nullptr;
+    }
+
     direct2d::PaintStats* const getPaintStats() const
     {
         if (owner)
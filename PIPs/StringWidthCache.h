@@ -0,0 +1,170 @@
+#pragma once
+
+#include "TextCache.h"
+
+//
+// Remembers string widths so relayouts don't measure the same text again
+//
+// Font::getStringWidthFloat lays the whole string out each time it's asked. Tables and lists ask for
+// the same widths on every relayout, and a changeWidthToFitText() per button adds more. This keeps the
+// most recently used widths, keyed by font and string, and drops the least recently used once it
+// holds more than the capacity.
+//
+// getStringWidths() measures a whole column in one font at once: the font key is built once rather than
+// per string, and a string that appears more than once is only measured once. The misses are measured
+// one after another on the calling thread; Font and Typeface load glyphs lazily into shared caches and
+// aren't safe to measure with from several threads, even through copies of the Font, which share them.
+//
+// Share one cache per app with SharedResourcePointer<StringWidthCache>; it's for the message thread only.
+//
+class StringWidthCache
+{
+public:
+    static constexpr int defaultCapacity = 16384;
+
+    StringWidthCache() = default;
+    ~StringWidthCache() = default;
+
+    float getStringWidthFloat(juce::Font const& font, juce::String const& text)
+    {
+        auto key = createKey(TextCache::getFontKey(font), text);
+
+        float width = 0.0f;
+        if (find(key, width))
+        {
+            return width;
+        }
+
+        width = font.getStringWidthFloat(text);
+        insert(key, width);
+        return width;
+    }
+
+    //
+    // Same rounding as Font::getStringWidth
+    //
+    int getStringWidth(juce::Font const& font, juce::String const& text)
+    {
+        return juce::roundToInt(getStringWidthFloat(font, text));
+    }
+
+    juce::Array<float> getStringWidths(juce::Font const& font, juce::StringArray const& strings)
+    {
+        auto fontKey = TextCache::getFontKey(font);
+
+        juce::Array<float> widths;
+        widths.resize(strings.size());
+
+        for (int index = 0; index < strings.size(); ++index)
+        {
+            auto key = createKey(fontKey, strings[index]);
+
+            auto& width = widths.getReference(index);
+            if (! find(key, width))
+            {
+                width = font.getStringWidthFloat(strings[index]);
+                insert(key, width);
+            }
+        }
+
+        return widths;
+    }
+
+    void setCapacity(int newCapacity)
+    {
+        capacity = juce::jmax(1, newCapacity);
+        trim();
+    }
+
+    int getCapacity() const noexcept { return capacity; }
+
+    struct Metrics
+    {
+        juce::int64 lookups = 0;
+        juce::int64 hits = 0;
+        juce::int64 numEvictions = 0;
+        int numEntries = 0;
+
+        double getHitRate() const noexcept { return lookups > 0 ? (double)hits / (double)lookups : 0.0; }
+    };
+
+    Metrics getMetrics() const noexcept
+    {
+        auto result = metrics;
+        result.numEntries = (int)entries.size();
+        return result;
+    }
+
+    void resetMetrics() noexcept
+    {
+        metrics = {};
+    }
+
+    void clear()
+    {
+        entries.clear();
+        leastRecentlyUsed.clear();
+    }
+
+private:
+    struct StringHash
+    {
+        size_t operator()(juce::String const& string) const noexcept { return (size_t)string.hash(); }
+    };
+
+    struct Entry
+    {
+        float width = 0.0f;
+        std::list<juce::String>::iterator position;
+    };
+
+    std::unordered_map<juce::String, Entry, StringHash> entries;
+
+    //
+    // Keys, most recently used first
+    //
+    std::list<juce::String> leastRecentlyUsed;
+
+    int capacity = defaultCapacity;
+    Metrics metrics;
+
+    static juce::String createKey(juce::String const& fontKey, juce::String const& text)
+    {
+        return fontKey + "|" + text;
+    }
+
+    bool find(juce::String const& key, float& width)
+    {
+        ++metrics.lookups;
+
+        auto found = entries.find(key);
+        if (found == entries.end())
+        {
+            return false;
+        }
+
+        ++metrics.hits;
+        leastRecentlyUsed.splice(leastRecentlyUsed.begin(), leastRecentlyUsed, found->second.position);
+        width = found->second.width;
+        return true;
+    }
+
+    void insert(juce::String const& key, float width)
+    {
+        leastRecentlyUsed.push_front(key);
+        entries[key] = { width, leastRecentlyUsed.begin() };
+        trim();
+    }
+
+    void trim()
+    {
+        while ((int)entries.size() > capacity)
+        {
+            entries.erase(leastRecentlyUsed.back());
+            leastRecentlyUsed.pop_back();
+            ++metrics.numEvictions;
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StringWidthCache)
+};
@@ -0,0 +1,547 @@
+/*******************************************************************************
+ The block below describes the properties of this PIP. A PIP is a short snippet
+ of code that can be read by the Projucer and used to generate a JUCE project.
+
+ BEGIN_JUCE_PIP_METADATA
+
+  name:             Text Benchmark
+
+  dependencies:     juce_core, juce_data_structures, juce_events, juce_graphics
+  exporters:        VS2022, linux_make
+
+  moduleFlags:      JUCE_STRICT_REFCOUNTEDPOINTER=1
+  defines:
+
+  type:             Console
+
+ END_JUCE_PIP_METADATA
+
+*******************************************************************************/
+
+#pragma once
+
+#include "StringWidthCache.h"
+#include "TextCache.h"
+
+//
+// Headless text stress test
+//
+// The Font Test only draws three strings, which says little about views full of text. This draws
+// three workloads offscreen with the software renderer, so it runs on a Linux build machine too:
+//
+//  - labels       thousands of single-line labels of varying length, size, and typeface that don't change
+//  - meters       short numeric readouts whose text changes every frame
+//  - paragraphs   multiline AttributedStrings with mixed fonts and colours, laid out with TextLayout
+//
+// Usage: TextBenchmark [--json] [--iterations N] [--quick] [--output file]
+//
+// Each iteration is one frame. For each configuration it reports, as glyphs per second:
+//
+//  - layout     building the GlyphArrangement or TextLayout
+//  - render     drawing the prepared layout
+//  - drawText   Graphics::drawText (or TextLayout from scratch for paragraphs), as the app would call it
+//  - textCache  TextCache::drawText after one warm-up frame (zero for paragraphs)
+//
+// For labels and meters it also times measuring every line's width, as a relayout would (zero for
+// paragraphs):
+//
+//  - width        Font::getStringWidthFloat for each line
+//  - widthCache   StringWidthCache::getStringWidthFloat for each line, after one warm-up frame
+//  - widthBatch   StringWidthCache::getStringWidths once per font, after one warm-up frame
+//
+class TextBenchmark
+{
+public:
+    struct Options
+    {
+        bool json = false;
+        bool quick = false;
+        int iterations = 10;
+        juce::File outputFile;
+    };
+
+    explicit TextBenchmark(Options options_) :
+        options(options_)
+    {
+    }
+
+    juce::String run()
+    {
+        juce::Array<int> const labelCounts = options.quick ? juce::Array<int>{ 1000 } : juce::Array<int>{ 1000, 5000 };
+        juce::Array<int> const meterCounts = options.quick ? juce::Array<int>{ 256 } : juce::Array<int>{ 256, 1024 };
+        juce::Array<int> const paragraphCounts = options.quick ? juce::Array<int>{ 16 } : juce::Array<int>{ 16, 64 };
+
+        for (auto count : labelCounts)
+        {
+            results.add(measureLines({ "labels", count }));
+        }
+
+        for (auto count : meterCounts)
+        {
+            results.add(measureLines({ "meters", count }));
+        }
+
+        for (auto count : paragraphCounts)
+        {
+            results.add(measureParagraphs({ "paragraphs", count }));
+        }
+
+        return options.json ? toJSON() : toCSV();
+    }
+
+private:
+    struct Configuration
+    {
+        juce::String workload;
+        int count;
+    };
+
+    struct Result
+    {
+        Configuration configuration;
+        juce::int64 glyphsPerFrame = 0;
+        double layoutMs = 0.0;
+        double renderMs = 0.0;
+        double drawTextMs = 0.0;
+        double textCacheMs = 0.0;
+        double widthMs = 0.0;
+        double widthCacheMs = 0.0;
+        double widthBatchMs = 0.0;
+
+        double getGlyphsPerSecond(double milliseconds) const noexcept
+        {
+            return milliseconds > 0.0 ? (double)glyphsPerFrame * 1000.0 / milliseconds : 0.0;
+        }
+    };
+
+    struct Line
+    {
+        juce::String text;
+        juce::Font font;
+        juce::Rectangle<float> area;
+        juce::Justification justification;
+    };
+
+    static constexpr int imageWidth = 1920;
+    static constexpr int imageHeight = 1080;
+
+    Options const options;
+    juce::Array<Result> results;
+    juce::Image image{ juce::Image::ARGB, imageWidth, imageHeight, true, juce::SoftwareImageType{} };
+
+    static juce::StringArray getTypefaceNames()
+    {
+        return { juce::Font::getDefaultSansSerifFontName(), juce::Font::getDefaultSerifFontName(), juce::Font::getDefaultMonospacedFontName() };
+    }
+
+    static juce::String createWords(juce::Random& random, int numWords)
+    {
+        static char const* const words[] = { "gain", "frequency", "Q", "threshold", "ratio", "attack", "release", "mix", "output", "low",
+            "high", "shelf", "band", "bypass", "sidechain", "stereo", "width", "drive", "ceiling", "lookahead" };
+
+        juce::StringArray result;
+        for (int index = 0; index < numWords; ++index)
+        {
+            result.add(words[random.nextInt((int)std::size(words))]);
+        }
+
+        return result.joinIntoString(" ");
+    }
+
+    static juce::String createMeterText(juce::Random& random)
+    {
+        return juce::String{ random.nextFloat() * -60.0f, 1 } + " dB";
+    }
+
+    //
+    // Labels are laid out once and keep their text; meters are short and get new text every frame
+    //
+    std::vector<std::vector<Line>> createFrames(Configuration const& configuration) const
+    {
+        juce::Random random{ 1 };
+        auto typefaceNames = getTypefaceNames();
+        auto meters = configuration.workload == "meters";
+
+        std::vector<Line> lines;
+        for (int index = 0; index < configuration.count; ++index)
+        {
+            auto height = meters ? 14.0f : 10.0f + (float)random.nextInt(20);
+            juce::Font font{ typefaceNames[random.nextInt(typefaceNames.size())], height, random.nextBool() ? juce::Font::plain : juce::Font::bold };
+
+            auto width = meters ? 60.0f : 40.0f + (float)random.nextInt(260);
+            auto x = random.nextFloat() * ((float)imageWidth - width);
+            auto y = random.nextFloat() * ((float)imageHeight - height);
+
+            lines.push_back({ meters ? createMeterText(random) : createWords(random, 1 + random.nextInt(6)),
+                font,
+                { x, y, width, height * 1.5f },
+                meters ? juce::Justification::centredRight : juce::Justification::centredLeft });
+        }
+
+        std::vector<std::vector<Line>> frames((size_t)options.iterations + 1, lines);
+
+        if (meters)
+        {
+            for (auto& frame : frames)
+            {
+                for (auto& line : frame)
+                {
+                    line.text = createMeterText(random);
+                }
+            }
+        }
+
+        return frames;
+    }
+
+    template <typename Callback>
+    double timeFramesMs(Callback&& callback) const
+    {
+        double total = 0.0;
+
+        for (int frame = 0; frame < options.iterations; ++frame)
+        {
+            auto start = juce::Time::getHighResolutionTicks();
+            callback(frame);
+            total += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        }
+
+        return total * 1000.0 / (double)options.iterations;
+    }
+
+    //
+    // The same layout Graphics::drawText does
+    //
+    static void layOut(juce::GlyphArrangement& arrangement, Line const& line)
+    {
+        arrangement.clear();
+        arrangement.addCurtailedLineOfText(line.font, line.text, line.area.getX(), line.area.getY(), line.area.getWidth(), true);
+        arrangement.justifyGlyphs(0, arrangement.getNumGlyphs(), line.area.getX(), line.area.getY(), line.area.getWidth(), line.area.getHeight(), line.justification);
+    }
+
+    Result measureLines(Configuration const& configuration)
+    {
+        Result result;
+        result.configuration = configuration;
+
+        auto frames = createFrames(configuration);
+        std::vector<juce::GlyphArrangement> arrangements(frames.front().size());
+
+        for (size_t index = 0; index < arrangements.size(); ++index)
+        {
+            layOut(arrangements[index], frames.front()[index]);
+            result.glyphsPerFrame += arrangements[index].getNumGlyphs();
+        }
+
+        result.layoutMs = timeFramesMs([&](int frame)
+            {
+                auto const& lines = frames[(size_t)frame];
+                for (size_t index = 0; index < lines.size(); ++index)
+                {
+                    layOut(arrangements[index], lines[index]);
+                }
+            });
+
+        juce::Graphics g{ image };
+        g.setColour(juce::Colours::white);
+
+        result.renderMs = timeFramesMs([&](int)
+            {
+                for (auto const& arrangement : arrangements)
+                {
+                    arrangement.draw(g);
+                }
+            });
+
+        result.drawTextMs = timeFramesMs([&](int frame)
+            {
+                for (auto const& line : frames[(size_t)frame])
+                {
+                    g.setFont(line.font);
+                    g.drawText(line.text, line.area, line.justification);
+                }
+            });
+
+        TextCache textCache;
+        auto drawCached = [&](std::vector<Line> const& lines)
+            {
+                for (auto const& line : lines)
+                {
+                    g.setFont(line.font);
+                    textCache.drawText(g, line.text, line.area, line.justification);
+                }
+            };
+
+        drawCached(frames.back());
+        result.textCacheMs = timeFramesMs([&](int frame) { drawCached(frames[(size_t)frame]); });
+
+        measureWidths(result, frames);
+
+        return result;
+    }
+
+    //
+    // A column of strings that share a font, as a table or list would measure them
+    //
+    struct WidthBatch
+    {
+        juce::Font font;
+        juce::StringArray strings;
+    };
+
+    static std::vector<WidthBatch> createWidthBatches(std::vector<Line> const& lines)
+    {
+        std::vector<WidthBatch> batches;
+        std::map<juce::String, size_t> batchIndices;
+
+        for (auto const& line : lines)
+        {
+            auto [found, added] = batchIndices.emplace(TextCache::getFontKey(line.font), batches.size());
+            if (added)
+            {
+                batches.push_back({ line.font, {} });
+            }
+
+            batches[found->second].strings.add(line.text);
+        }
+
+        return batches;
+    }
+
+    void measureWidths(Result& result, std::vector<std::vector<Line>> const& frames) const
+    {
+        result.widthMs = timeFramesMs([&](int frame)
+            {
+                for (auto const& line : frames[(size_t)frame])
+                {
+                    line.font.getStringWidthFloat(line.text);
+                }
+            });
+
+        StringWidthCache widthCache;
+        auto measureCached = [&](std::vector<Line> const& lines)
+            {
+                for (auto const& line : lines)
+                {
+                    widthCache.getStringWidthFloat(line.font, line.text);
+                }
+            };
+
+        measureCached(frames.back());
+        result.widthCacheMs = timeFramesMs([&](int frame) { measureCached(frames[(size_t)frame]); });
+
+        //
+        // Grouping the lines by font is the caller's layout, so it isn't timed
+        //
+        std::vector<std::vector<WidthBatch>> batchesPerFrame;
+        for (auto const& lines : frames)
+        {
+            batchesPerFrame.push_back(createWidthBatches(lines));
+        }
+
+        StringWidthCache batchCache;
+        auto measureBatched = [&](std::vector<WidthBatch> const& batches)
+            {
+                for (auto const& batch : batches)
+                {
+                    batchCache.getStringWidths(batch.font, batch.strings);
+                }
+            };
+
+        measureBatched(batchesPerFrame.back());
+        result.widthBatchMs = timeFramesMs([&](int frame) { measureBatched(batchesPerFrame[(size_t)frame]); });
+    }
+
+    std::vector<juce::AttributedString> createParagraphs(int count) const
+    {
+        juce::Random random{ 2 };
+        auto typefaceNames = getTypefaceNames();
+        juce::Colour const colours[] = { juce::Colours::white, juce::Colours::lightblue, juce::Colours::orange };
+
+        std::vector<juce::AttributedString> paragraphs;
+        for (int index = 0; index < count; ++index)
+        {
+            juce::AttributedString paragraph;
+            paragraph.setWordWrap(juce::AttributedString::byWord);
+            paragraph.setJustification(juce::Justification::topLeft);
+
+            for (int sentence = 0; sentence < 6; ++sentence)
+            {
+                juce::Font font{ typefaceNames[random.nextInt(typefaceNames.size())], 12.0f + (float)random.nextInt(8), sentence == 0 ? juce::Font::bold : juce::Font::plain };
+                paragraph.append(createWords(random, 8 + random.nextInt(12)) + (sentence % 3 == 2 ? ".\n" : ". "), font, colours[random.nextInt((int)std::size(colours))]);
+            }
+
+            paragraphs.push_back(paragraph);
+        }
+
+        return paragraphs;
+    }
+
+    static juce::int64 countGlyphs(juce::TextLayout const& layout)
+    {
+        juce::int64 numGlyphs = 0;
+
+        for (int index = 0; index < layout.getNumLines(); ++index)
+        {
+            for (auto const* run : layout.getLine(index).runs)
+            {
+                numGlyphs += run->glyphs.size();
+            }
+        }
+
+        return numGlyphs;
+    }
+
+    Result measureParagraphs(Configuration const& configuration)
+    {
+        Result result;
+        result.configuration = configuration;
+
+        constexpr float paragraphWidth = 400.0f;
+        auto paragraphs = createParagraphs(configuration.count);
+        std::vector<juce::TextLayout> layouts(paragraphs.size());
+
+        for (size_t index = 0; index < paragraphs.size(); ++index)
+        {
+            layouts[index].createLayout(paragraphs[index], paragraphWidth);
+            result.glyphsPerFrame += countGlyphs(layouts[index]);
+        }
+
+        result.layoutMs = timeFramesMs([&](int)
+            {
+                for (size_t index = 0; index < paragraphs.size(); ++index)
+                {
+                    layouts[index].createLayout(paragraphs[index], paragraphWidth);
+                }
+            });
+
+        //
+        // Paragraphs are tiled across the image; overlapping doesn't matter for timing
+        //
+        auto getArea = [&](size_t index)
+            {
+                auto columns = (size_t)(imageWidth / (int)paragraphWidth);
+                return juce::Rectangle<float>{ paragraphWidth * (float)(index % columns), 150.0f * (float)((index / columns) % 7), paragraphWidth, (float)imageHeight };
+            };
+
+        juce::Graphics g{ image };
+
+        result.renderMs = timeFramesMs([&](int)
+            {
+                for (size_t index = 0; index < layouts.size(); ++index)
+                {
+                    layouts[index].draw(g, getArea(index));
+                }
+            });
+
+        result.drawTextMs = timeFramesMs([&](int)
+            {
+                for (size_t index = 0; index < paragraphs.size(); ++index)
+                {
+                    paragraphs[index].draw(g, getArea(index));
+                }
+            });
+
+        return result;
+    }
+
+    juce::String toCSV() const
+    {
+        juce::StringArray lines;
+        lines.add("workload,count,glyphsPerFrame,layoutMs,renderMs,drawTextMs,textCacheMs,layoutGlyphsPerSecond,renderGlyphsPerSecond,drawTextGlyphsPerSecond,textCacheGlyphsPerSecond,widthMs,widthCacheMs,widthBatchMs");
+
+        for (auto const& result : results)
+        {
+            auto const& configuration = result.configuration;
+            lines.add(configuration.workload
+                + "," + juce::String{ configuration.count }
+                + "," + juce::String{ result.glyphsPerFrame }
+                + "," + juce::String{ result.layoutMs, 4 }
+                + "," + juce::String{ result.renderMs, 4 }
+                + "," + juce::String{ result.drawTextMs, 4 }
+                + "," + juce::String{ result.textCacheMs, 4 }
+                + "," + juce::String{ (juce::int64)result.getGlyphsPerSecond(result.layoutMs) }
+                + "," + juce::String{ (juce::int64)result.getGlyphsPerSecond(result.renderMs) }
+                + "," + juce::String{ (juce::int64)result.getGlyphsPerSecond(result.drawTextMs) }
+                + "," + juce::String{ (juce::int64)result.getGlyphsPerSecond(result.textCacheMs) }
+                + "," + juce::String{ result.widthMs, 4 }
+                + "," + juce::String{ result.widthCacheMs, 4 }
+                + "," + juce::String{ result.widthBatchMs, 4 });
+        }
+
+        return lines.joinIntoString("\n") + "\n";
+    }
+
+    juce::String toJSON() const
+    {
+        juce::Array<juce::var> rows;
+
+        for (auto const& result : results)
+        {
+            auto const& configuration = result.configuration;
+            auto row = new juce::DynamicObject{};
+            row->setProperty("workload", configuration.workload);
+            row->setProperty("count", configuration.count);
+            row->setProperty("glyphsPerFrame", result.glyphsPerFrame);
+            row->setProperty("layoutMs", result.layoutMs);
+            row->setProperty("renderMs", result.renderMs);
+            row->setProperty("drawTextMs", result.drawTextMs);
+            row->setProperty("textCacheMs", result.textCacheMs);
+            row->setProperty("layoutGlyphsPerSecond", result.getGlyphsPerSecond(result.layoutMs));
+            row->setProperty("renderGlyphsPerSecond", result.getGlyphsPerSecond(result.renderMs));
+            row->setProperty("drawTextGlyphsPerSecond", result.getGlyphsPerSecond(result.drawTextMs));
+            row->setProperty("textCacheGlyphsPerSecond", result.getGlyphsPerSecond(result.textCacheMs));
+            row->setProperty("widthMs", result.widthMs);
+            row->setProperty("widthCacheMs", result.widthCacheMs);
+            row->setProperty("widthBatchMs", result.widthBatchMs);
+            rows.add(juce::var{ row });
+        }
+
+        auto root = new juce::DynamicObject{};
+        root->setProperty("benchmark", "TextBenchmark");
+        root->setProperty("juceVersion", juce::SystemStats::getJUCEVersion());
+        root->setProperty("operatingSystem", juce::SystemStats::getOperatingSystemName());
+        root->setProperty("cpu", juce::SystemStats::getCpuModel());
+        root->setProperty("iterations", options.iterations);
+        root->setProperty("results", rows);
+
+        return juce::JSON::toString(juce::var{ root });
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TextBenchmark)
+};
+
+int main(int argc, char* argv[])
+{
+    TextBenchmark::Options options;
+    juce::StringArray args{ argv + 1, argc - 1 };
+
+    for (int index = 0; index < args.size(); ++index)
+    {
+        if (args[index] == "--json")
+            options.json = true;
+        else if (args[index] == "--quick")
+            options.quick = true;
+        else if (args[index] == "--iterations")
+            options.iterations = juce::jmax(1, args[++index].getIntValue());
+        else if (args[index] == "--output")
+            options.outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++index]);
+    }
+
+    TextBenchmark benchmark{ options };
+    auto report = benchmark.run();
+
+    if (options.outputFile != juce::File{})
+    {
+        if (! options.outputFile.replaceWithText(report))
+        {
+            std::cerr << "Couldn't write " << options.outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    std::cout << report;
+    return 0;
+}
@@ -0,0 +1,302 @@
+#pragma once
+
+//
+// Caches laid-out text runs and rasterised glyphs for the software renderer
+//
+// Graphics::drawText lays the string out into a GlyphArrangement and fills every glyph's outline on
+// every call, even though most UI text never changes. TextCache::drawText keeps two caches instead:
+//
+//  runs     the laid-out arrangement, keyed by text, font, area size, justification and ellipsis flag;
+//           it's laid out at the origin and moved to the area when drawn
+//
+//  glyphs   each glyph's coverage mask, rasterised once into a single-channel atlas page, keyed by
+//           font, glyph and horizontal subpixel offset in quarter pixels; glyphs are drawn by blitting
+//           the mask with the current fill
+//
+// Glyph masks are only used when the context draws at one physical pixel per unit, so they line up with
+// the device pixels; otherwise, and for underlined fonts, the cached run is drawn as outlines like
+// Graphics::drawText does. Baselines are rounded to whole pixels.
+//
+// Runs are dropped all at once when there are more than maxRuns; the atlas is cleared when its pages are
+// full. Share one cache per app with SharedResourcePointer<TextCache>; it's for the message thread only.
+//
+class TextCache
+{
+public:
+    static constexpr int maxRuns = 4096;
+    static constexpr int atlasPageSize = 1024;
+    static constexpr int maxAtlasPages = 4;
+    static constexpr int subpixelSteps = 4;
+
+    TextCache() = default;
+    ~TextCache() = default;
+
+    void drawText(juce::Graphics& g, juce::String const& text, juce::Rectangle<float> area, juce::Justification justification,
+        bool useEllipsesIfTooBig = true)
+    {
+        if (text.isEmpty() || ! g.clipRegionIntersects(area.getSmallestIntegerContainer()))
+        {
+            return;
+        }
+
+        auto const& font = g.getCurrentFont();
+        auto fontKey = getFontKey(font);
+        auto const& arrangement = getRun(text, font, fontKey, area.getWidth(), area.getHeight(), justification, useEllipsesIfTooBig);
+
+        auto& context = g.getInternalContext();
+        if (font.isUnderlined()
+            || context.getPhysicalPixelScaleFactor() != 1.0f
+            || dynamic_cast<juce::LowLevelGraphicsSoftwareRenderer*>(&context) == nullptr)
+        {
+            arrangement.draw(g, juce::AffineTransform::translation(area.getPosition()));
+            return;
+        }
+
+        for (int index = 0; index < arrangement.getNumGlyphs(); ++index)
+        {
+            auto const& glyph = arrangement.getGlyph(index);
+            if (glyph.isWhitespace())
+            {
+                continue;
+            }
+
+            auto x = glyph.getLeft() + area.getX();
+            auto wholeX = (int)std::floor(x);
+            auto subpixel = juce::roundToInt((x - (float)wholeX) * (float)subpixelSteps);
+            if (subpixel == subpixelSteps)
+            {
+                ++wholeX;
+                subpixel = 0;
+            }
+
+            auto baseline = juce::roundToInt(glyph.getBaselineY() + area.getY());
+
+            auto const& mask = getGlyph(glyph, fontKey, subpixel);
+            if (mask.image.isValid())
+            {
+                g.drawImageAt(mask.image, wholeX + mask.offset.x, baseline + mask.offset.y, true);
+            }
+            else if (mask.tooBigForAtlas)
+            {
+                juce::Path outline;
+                glyph.createPath(outline);
+                g.fillPath(outline, juce::AffineTransform::translation(area.getPosition()));
+            }
+        }
+    }
+
+    void drawText(juce::Graphics& g, juce::String const& text, juce::Rectangle<int> area, juce::Justification justification,
+        bool useEllipsesIfTooBig = true)
+    {
+        drawText(g, text, area.toFloat(), justification, useEllipsesIfTooBig);
+    }
+
+    struct Metrics
+    {
+        juce::int64 runLookups = 0;
+        juce::int64 runHits = 0;
+        juce::int64 glyphLookups = 0;
+        juce::int64 glyphHits = 0;
+        int numRuns = 0;
+        int numGlyphs = 0;
+        int numAtlasPages = 0;
+        int numAtlasResets = 0;
+
+        double getRunHitRate() const noexcept { return runLookups > 0 ? (double)runHits / (double)runLookups : 0.0; }
+        double getGlyphHitRate() const noexcept { return glyphLookups > 0 ? (double)glyphHits / (double)glyphLookups : 0.0; }
+    };
+
+    Metrics getMetrics() const noexcept
+    {
+        auto result = metrics;
+        result.numRuns = (int)runs.size();
+        result.numGlyphs = (int)glyphs.size();
+        result.numAtlasPages = (int)atlasPages.size();
+        return result;
+    }
+
+    void resetMetrics() noexcept
+    {
+        metrics = {};
+    }
+
+    void clear()
+    {
+        runs.clear();
+        clearAtlas();
+    }
+
+    //
+    // Identifies everything about a font that changes its layout
+    //
+    static juce::String getFontKey(juce::Font const& font)
+    {
+        return juce::String::toHexString((juce::pointer_sized_int)font.getTypefacePtr().get())
+            + " " + font.toString()
+            + " " + juce::String{ font.getHeight(), 3 }
+            + " " + juce::String{ font.getHorizontalScale(), 3 }
+            + " " + juce::String{ font.getExtraKerningFactor(), 3 };
+    }
+
+private:
+    struct StringHash
+    {
+        size_t operator()(juce::String const& string) const noexcept { return (size_t)string.hash(); }
+    };
+
+    struct GlyphMask
+    {
+        juce::Image image;
+        juce::Point<int> offset;
+        bool tooBigForAtlas = false;
+    };
+
+    struct AtlasPage
+    {
+        juce::Image image;
+        int shelfX = 0;
+        int shelfY = 0;
+        int shelfHeight = 0;
+    };
+
+    std::unordered_map<juce::String, juce::GlyphArrangement, StringHash> runs;
+    std::unordered_map<juce::String, GlyphMask, StringHash> glyphs;
+    std::vector<AtlasPage> atlasPages;
+    Metrics metrics;
+
+    juce::GlyphArrangement const& getRun(juce::String const& text, juce::Font const& font, juce::String const& fontKey,
+        float width, float height, juce::Justification justification, bool useEllipsesIfTooBig)
+    {
+        ++metrics.runLookups;
+
+        auto key = fontKey + "|" + juce::String{ width, 2 } + "x" + juce::String{ height, 2 }
+            + "|" + juce::String{ justification.getFlags() } + (useEllipsesIfTooBig ? "|e|" : "|-|") + text;
+
+        if (auto found = runs.find(key); found != runs.end())
+        {
+            ++metrics.runHits;
+            return found->second;
+        }
+
+        if ((int)runs.size() >= maxRuns)
+        {
+            runs.clear();
+        }
+
+        //
+        // Same layout as Graphics::drawText, at the origin
+        //
+        juce::GlyphArrangement arrangement;
+        arrangement.addCurtailedLineOfText(font, text, 0.0f, 0.0f, width, useEllipsesIfTooBig);
+        arrangement.justifyGlyphs(0, arrangement.getNumGlyphs(), 0.0f, 0.0f, width, height, justification);
+
+        return runs.emplace(key, std::move(arrangement)).first->second;
+    }
+
+    GlyphMask const& getGlyph(juce::PositionedGlyph const& glyph, juce::String const& fontKey, int subpixel)
+    {
+        ++metrics.glyphLookups;
+
+        auto key = fontKey + "|" + juce::String{ glyph.getGlyphIndex() } + "|" + juce::String{ subpixel };
+        if (auto found = glyphs.find(key); found != glyphs.end())
+        {
+            ++metrics.glyphHits;
+            return found->second;
+        }
+
+        //
+        // Move the outline so the glyph origin sits at the subpixel offset on the baseline
+        //
+        juce::Path outline;
+        glyph.createPath(outline);
+        outline.applyTransform(juce::AffineTransform::translation((float)subpixel / (float)subpixelSteps - glyph.getLeft(), -glyph.getBaselineY()));
+
+        GlyphMask mask;
+        auto bounds = outline.getBounds().getSmallestIntegerContainer();
+        juce::Rectangle<int> atlasArea;
+        int pageIndex = 0;
+
+        if (bounds.isEmpty())
+        {
+            return glyphs.emplace(key, mask).first->second;
+        }
+
+        if (! allocate(bounds.getWidth(), bounds.getHeight(), atlasArea, pageIndex))
+        {
+            mask.tooBigForAtlas = true;
+            return glyphs.emplace(key, mask).first->second;
+        }
+
+        auto& page = atlasPages[(size_t)pageIndex].image;
+
+        {
+            juce::Graphics g{ page };
+            g.reduceClipRegion(atlasArea);
+            g.setOrigin(atlasArea.getPosition() - bounds.getPosition());
+            g.setColour(juce::Colours::white);
+            g.fillPath(outline);
+        }
+
+        mask.image = page.getClippedImage(atlasArea);
+        mask.offset = bounds.getPosition();
+        return glyphs.emplace(key, mask).first->second;
+    }
+
+    //
+    // Shelf packing: glyphs fill a row left to right, and a new row starts below the tallest glyph in
+    // the current one. Returns false if the glyph can't fit even on an empty page.
+    //
+    bool allocate(int width, int height, juce::Rectangle<int>& area, int& pageIndex)
+    {
+        if (width > atlasPageSize || height > atlasPageSize)
+        {
+            return false;
+        }
+
+        if (atlasPages.empty() || ! allocateOnPage(atlasPages.back(), width, height, area))
+        {
+            if ((int)atlasPages.size() >= maxAtlasPages)
+            {
+                clearAtlas();
+                ++metrics.numAtlasResets;
+            }
+
+            atlasPages.push_back({ juce::Image{ juce::Image::SingleChannel, atlasPageSize, atlasPageSize, true, juce::SoftwareImageType{} } });
+            allocateOnPage(atlasPages.back(), width, height, area);
+        }
+
+        pageIndex = (int)atlasPages.size() - 1;
+        return true;
+    }
+
+    static bool allocateOnPage(AtlasPage& page, int width, int height, juce::Rectangle<int>& area)
+    {
+        if (page.shelfX + width > atlasPageSize)
+        {
+            page.shelfY += page.shelfHeight;
+            page.shelfX = 0;
+            page.shelfHeight = 0;
+        }
+
+        if (page.shelfY + height > atlasPageSize)
+        {
+            return false;
+        }
+
+        //
+        // One pixel gap so a glyph's antialiased edge never bleeds into its neighbour
+        //
+        area = { page.shelfX, page.shelfY, width, height };
+        page.shelfX += width + 1;
+        page.shelfHeight = juce::jmax(page.shelfHeight, height + 1);
+        return true;
+    }
+
+    void clearAtlas()
+    {
+        glyphs.clear();
+        atlasPages.clear();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TextCache)
+};
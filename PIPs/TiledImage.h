@@ -0,0 +1,432 @@
+#pragma once
+
+#include "PixelBufferPool.h"
+
+//
+// Image pixel data stored as 64x64 tiles, for very large images that get rotated or sheared
+//
+// A rotated draw walks the source image diagonally. With a linear layout, every destination pixel
+// lands on a different source row, and a 16k-wide ARGB row is 64 KB, so each read is a cache miss. A
+// 64x64 ARGB tile is 16 KB, so a diagonal walk through it stays in cache.
+//
+// Tiles are software images, allocated when first written. A tile that's never written, or that
+// was entirely transparent when the image was created with createFrom(), takes no memory at all.
+//
+// The tiled data plugs into Image like any other pixel data. A BitmapData inside one tile points
+// straight at the tile. A BitmapData that spans tiles gets a linear copy of its area, which is
+// written back to the tiles when the BitmapData is released if it was writable. Drawing into the
+// image with a Graphics goes through a BitmapData for the whole image, so for big images it's better
+// to draw tile by tile.
+//
+// The software renderer only samples linear images, so drawTransformed() renders the destination in
+// 64x64 blocks. Each block is clipped to its own pixels and draws just the part of the source that
+// lands in it. That's a small linear region: a zero-copy subsection of a linear image, or a gather
+// from the few tiles it covers. Fully transparent tiles are skipped without drawing anything.
+//
+class TiledImage
+{
+public:
+    static constexpr int tileSize = 64;
+
+    //
+    // Tiles start out unallocated, which reads as transparent, so the image is always cleared
+    //
+    static juce::Image create(juce::Image::PixelFormat format, int width, int height)
+    {
+        return juce::Image{ new PixelData{ format, width, height } };
+    }
+
+    //
+    // Copies an image into tiles; with sparse set, tiles that would be all zero aren't allocated
+    //
+    static juce::Image createFrom(juce::Image const& source, bool sparse)
+    {
+        if (source.isNull())
+        {
+            return {};
+        }
+
+        auto image = create(source.getFormat(), source.getWidth(), source.getHeight());
+        auto pixelData = static_cast<PixelData*>(image.getPixelData());
+        juce::Image::BitmapData sourceData{ source, juce::Image::BitmapData::readOnly };
+
+        for (int tileY = 0; tileY < pixelData->numTilesY; ++tileY)
+        {
+            for (int tileX = 0; tileX < pixelData->numTilesX; ++tileX)
+            {
+                auto area = pixelData->getTileArea(tileX, tileY);
+                if (sparse && isAllZero(sourceData, area))
+                {
+                    continue;
+                }
+
+                pixelData->scatter(area, sourceData.getPixelPointer(area.getX(), area.getY()), (size_t)sourceData.lineStride);
+            }
+        }
+
+        return image;
+    }
+
+    static bool isTiled(juce::Image const& image)
+    {
+        return dynamic_cast<PixelData*>(image.getPixelData()) != nullptr;
+    }
+
+    static int getNumAllocatedTiles(juce::Image const& image)
+    {
+        if (auto pixelData = dynamic_cast<PixelData*>(image.getPixelData()))
+        {
+            return pixelData->numAllocatedTiles;
+        }
+
+        return 0;
+    }
+
+    //
+    // A linear image of part of a tiled or linear image, for reading; zero-copy when the area is inside one
+    // tile or the image is linear
+    //
+    static juce::Image getRegion(juce::Image const& image, juce::Rectangle<int> area)
+    {
+        if (auto pixelData = dynamic_cast<PixelData*>(image.getPixelData()))
+        {
+            return pixelData->getRegion(area);
+        }
+
+        return image.getClippedImage(area);
+    }
+
+    //
+    // Draws a tiled or linear image the way Graphics::drawImageTransformed would, a destination block at a
+    // time. That only works with the software renderer at a whole-number scale; anything else is drawn
+    // directly.
+    //
+    static void drawTransformed(juce::Graphics& g, juce::Image const& image, juce::AffineTransform const& transform)
+    {
+        auto& context = g.getInternalContext();
+        auto scaleFactor = context.getPhysicalPixelScaleFactor();
+
+        if (image.isNull()
+            || transform.isOnlyTranslation()
+            || dynamic_cast<juce::LowLevelGraphicsSoftwareRenderer*>(&context) == nullptr
+            || scaleFactor != std::floor(scaleFactor))
+        {
+            g.drawImageTransformed(image, transform);
+            return;
+        }
+
+        auto pixelData = dynamic_cast<PixelData*>(image.getPixelData());
+        auto imageBounds = image.getBounds();
+        auto inverse = transform.inverted();
+        auto destBounds = imageBounds.toFloat().transformedBy(transform).getSmallestIntegerContainer().getIntersection(g.getClipBounds());
+
+        for (int blockY = destBounds.getY(); blockY < destBounds.getBottom(); blockY += tileSize)
+        {
+            for (int blockX = destBounds.getX(); blockX < destBounds.getRight(); blockX += tileSize)
+            {
+                juce::Rectangle<int> block{ blockX, blockY, tileSize, tileSize };
+                if (! g.clipRegionIntersects(block))
+                {
+                    continue;
+                }
+
+                //
+                // Widen the source area so the subsection's own antialiased edges fall outside the block,
+                // and to leave room for the resampling filter
+                //
+                auto sourceArea = block.expanded(2).toFloat().transformedBy(inverse).getSmallestIntegerContainer().expanded(2).getIntersection(imageBounds);
+                if (sourceArea.isEmpty() || (pixelData != nullptr && pixelData->isEmpty(sourceArea)))
+                {
+                    continue;
+                }
+
+                auto region = getRegion(image, sourceArea);
+
+                juce::Graphics::ScopedSaveState saveState{ g };
+                g.reduceClipRegion(block);
+                g.drawImageTransformed(region, juce::AffineTransform::translation((float)sourceArea.getX(), (float)sourceArea.getY()).followedBy(transform));
+            }
+        }
+    }
+
+    class Type : public juce::ImageType
+    {
+    public:
+        juce::ImagePixelData::Ptr create(juce::Image::PixelFormat format, int width, int height, bool) const override
+        {
+            return new PixelData{ format, width, height };
+        }
+
+        int getTypeID() const override
+        {
+            return 0x54494c45; // "TILE"
+        }
+    };
+
+private:
+    static int getPixelStride(juce::Image::PixelFormat format) noexcept
+    {
+        return format == juce::Image::RGB ? 3 : (format == juce::Image::ARGB ? 4 : 1);
+    }
+
+    static bool isAllZero(juce::Image::BitmapData const& bitmap, juce::Rectangle<int> area) noexcept
+    {
+        auto rowBytes = (size_t)(area.getWidth() * bitmap.pixelStride);
+
+        for (int y = area.getY(); y < area.getBottom(); ++y)
+        {
+            auto row = bitmap.getPixelPointer(area.getX(), y);
+            if (row[0] != 0 || std::memcmp(row, row + 1, rowBytes - 1) != 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    class PixelData : public juce::ImagePixelData
+    {
+    public:
+        PixelData(juce::Image::PixelFormat format, int width_, int height_) :
+            juce::ImagePixelData(format, width_, height_),
+            pixelStride(getPixelStride(format)),
+            numTilesX((width_ + tileSize - 1) / tileSize),
+            numTilesY((height_ + tileSize - 1) / tileSize),
+            tiles((size_t)(numTilesX * numTilesY)),
+            tilePixels((size_t)(numTilesX * numTilesY), nullptr)
+        {
+        }
+
+        std::unique_ptr<juce::LowLevelGraphicsContext> createLowLevelContext() override
+        {
+            sendDataChangeMessage();
+            return std::make_unique<juce::LowLevelGraphicsSoftwareRenderer>(juce::Image{ *this });
+        }
+
+        void initialiseBitmapData(juce::Image::BitmapData& bitmap, int x, int y, juce::Image::BitmapData::ReadWriteMode mode) override
+        {
+            juce::Rectangle<int> area{ x, y, juce::jmax(1, bitmap.width), juce::jmax(1, bitmap.height) };
+
+            if (mode != juce::Image::BitmapData::readOnly)
+            {
+                sendDataChangeMessage();
+            }
+
+            bitmap.pixelFormat = pixelFormat;
+            bitmap.pixelStride = pixelStride;
+
+            auto tileX = x / tileSize;
+            auto tileY = y / tileSize;
+            if (getTileArea(tileX, tileY).contains(area))
+            {
+                auto tileIndex = (size_t)(tileY * numTilesX + tileX);
+                if (tilePixels[tileIndex] == nullptr && mode != juce::Image::BitmapData::readOnly)
+                {
+                    allocateTile(tileIndex);
+                }
+
+                auto base = tilePixels[tileIndex] != nullptr ? tilePixels[tileIndex] : getZeroTile();
+                bitmap.lineStride = tileLineStride;
+                bitmap.data = base + (y - tileY * tileSize) * tileLineStride + (x - tileX * tileSize) * pixelStride;
+                bitmap.size = (size_t)(tileLineStride * tileSize) - (size_t)(bitmap.data - base);
+                return;
+            }
+
+            auto linearCopy = std::make_unique<LinearCopy>(*this, area, mode);
+            bitmap.lineStride = (int)linearCopy->lineStride;
+            bitmap.data = linearCopy->pixels.get();
+            bitmap.size = linearCopy->lineStride * (size_t)area.getHeight();
+            bitmap.dataReleaser = std::move(linearCopy);
+        }
+
+        juce::ImagePixelData::Ptr clone() override
+        {
+            auto copy = new PixelData{ pixelFormat, width, height };
+
+            for (size_t index = 0; index < tiles.size(); ++index)
+            {
+                if (tilePixels[index] != nullptr)
+                {
+                    copy->allocateTile(index);
+                    std::memcpy(copy->tilePixels[index], tilePixels[index], (size_t)(tileLineStride * tileSize));
+                }
+            }
+
+            return copy;
+        }
+
+        std::unique_ptr<juce::ImageType> createType() const override
+        {
+            return std::make_unique<Type>();
+        }
+
+        juce::Rectangle<int> getTileArea(int tileX, int tileY) const noexcept
+        {
+            return juce::Rectangle<int>{ tileX * tileSize, tileY * tileSize, tileSize, tileSize }.getIntersection({ width, height });
+        }
+
+        bool isEmpty(juce::Rectangle<int> area) const noexcept
+        {
+            for (int tileY = area.getY() / tileSize; tileY <= (area.getBottom() - 1) / tileSize; ++tileY)
+            {
+                for (int tileX = area.getX() / tileSize; tileX <= (area.getRight() - 1) / tileSize; ++tileX)
+                {
+                    if (tilePixels[(size_t)(tileY * numTilesX + tileX)] != nullptr)
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        juce::Image getRegion(juce::Rectangle<int> area)
+        {
+            auto tileX = area.getX() / tileSize;
+            auto tileY = area.getY() / tileSize;
+            auto tileIndex = (size_t)(tileY * numTilesX + tileX);
+
+            if (getTileArea(tileX, tileY).contains(area) && tilePixels[tileIndex] != nullptr)
+            {
+                return tiles[tileIndex].getClippedImage(area.translated(-tileX * tileSize, -tileY * tileSize));
+            }
+
+            juce::Image region{ pixelFormat, area.getWidth(), area.getHeight(), false, PixelBufferPool::Type{} };
+            juce::Image::BitmapData regionData{ region, juce::Image::BitmapData::writeOnly };
+            gather(area, regionData.data, (size_t)regionData.lineStride);
+            return region;
+        }
+
+        //
+        // Copies between an area of the tiles and a linear buffer
+        //
+        void gather(juce::Rectangle<int> area, juce::uint8* dest, size_t destLineStride)
+        {
+            forEachTileSpan(area, [&](size_t tileIndex, juce::Rectangle<int> span)
+                {
+                    auto rowBytes = (size_t)(span.getWidth() * pixelStride);
+                    for (int y = span.getY(); y < span.getBottom(); ++y)
+                    {
+                        auto destRow = dest + (size_t)(y - area.getY()) * destLineStride + (size_t)((span.getX() - area.getX()) * pixelStride);
+                        if (tilePixels[tileIndex] == nullptr)
+                        {
+                            std::memset(destRow, 0, rowBytes);
+                        }
+                        else
+                        {
+                            std::memcpy(destRow, getTilePixel(tileIndex, span.getX(), y), rowBytes);
+                        }
+                    }
+                });
+        }
+
+        void scatter(juce::Rectangle<int> area, juce::uint8 const* source, size_t sourceLineStride)
+        {
+            forEachTileSpan(area, [&](size_t tileIndex, juce::Rectangle<int> span)
+                {
+                    if (tilePixels[tileIndex] == nullptr)
+                    {
+                        allocateTile(tileIndex);
+                    }
+
+                    auto rowBytes = (size_t)(span.getWidth() * pixelStride);
+                    for (int y = span.getY(); y < span.getBottom(); ++y)
+                    {
+                        auto sourceRow = source + (size_t)(y - area.getY()) * sourceLineStride + (size_t)((span.getX() - area.getX()) * pixelStride);
+                        std::memcpy(getTilePixel(tileIndex, span.getX(), y), sourceRow, rowBytes);
+                    }
+                });
+        }
+
+        int const pixelStride;
+        int const numTilesX;
+        int const numTilesY;
+        int numAllocatedTiles = 0;
+
+    private:
+        std::vector<juce::Image> tiles;
+        std::vector<juce::uint8*> tilePixels;
+        int tileLineStride = tileSize * getPixelStride(pixelFormat);
+        juce::HeapBlock<juce::uint8> zeroTile;
+
+        //
+        // Linear copy of an area spanning several tiles, written back on release if it was writable
+        //
+        struct LinearCopy : public juce::Image::BitmapData::BitmapDataReleaser
+        {
+            LinearCopy(PixelData& owner_, juce::Rectangle<int> area_, juce::Image::BitmapData::ReadWriteMode mode_) :
+                owner(&owner_),
+                area(area_),
+                mode(mode_),
+                lineStride((size_t)(area_.getWidth() * owner_.pixelStride + 3) & ~(size_t)3)
+            {
+                pixels.malloc(lineStride * (size_t)area.getHeight());
+
+                if (mode != juce::Image::BitmapData::writeOnly)
+                {
+                    owner_.gather(area, pixels, lineStride);
+                }
+            }
+
+            ~LinearCopy() override
+            {
+                if (mode != juce::Image::BitmapData::readOnly)
+                {
+                    static_cast<PixelData*>(owner.get())->scatter(area, pixels, lineStride);
+                }
+            }
+
+            juce::ImagePixelData::Ptr owner;
+            juce::Rectangle<int> const area;
+            juce::Image::BitmapData::ReadWriteMode const mode;
+            size_t const lineStride;
+            juce::HeapBlock<juce::uint8> pixels;
+        };
+
+        void allocateTile(size_t tileIndex)
+        {
+            tiles[tileIndex] = juce::Image{ pixelFormat, tileSize, tileSize, true, juce::SoftwareImageType{} };
+
+            juce::Image::BitmapData tileData{ tiles[tileIndex], juce::Image::BitmapData::readWrite };
+            tilePixels[tileIndex] = tileData.data;
+            tileLineStride = tileData.lineStride;
+            ++numAllocatedTiles;
+        }
+
+        juce::uint8* getZeroTile()
+        {
+            if (zeroTile == nullptr)
+            {
+                zeroTile.calloc((size_t)(tileLineStride * tileSize));
+            }
+
+            return zeroTile;
+        }
+
+        juce::uint8* getTilePixel(size_t tileIndex, int x, int y) const noexcept
+        {
+            return tilePixels[tileIndex] + (y % tileSize) * tileLineStride + (x % tileSize) * pixelStride;
+        }
+
+        template <typename SpanFunction>
+        void forEachTileSpan(juce::Rectangle<int> area, SpanFunction&& spanFunction)
+        {
+            for (int tileY = area.getY() / tileSize; tileY <= (area.getBottom() - 1) / tileSize; ++tileY)
+            {
+                for (int tileX = area.getX() / tileSize; tileX <= (area.getRight() - 1) / tileSize; ++tileX)
+                {
+                    auto span = getTileArea(tileX, tileY).getIntersection(area);
+                    if (! span.isEmpty())
+                    {
+                        spanFunction((size_t)(tileY * numTilesX + tileX), span);
+                    }
+                }
+            }
+        }
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PixelData)
+    };
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+//
+// Loads embedded typefaces and warms their glyphs on worker threads while the app starts up
+//
+// Typeface::createSystemTypefaceFor parses the whole font file, and the first time each glyph is drawn
+// the renderer extracts its outline and builds an edge table for it. Doing all that on the message
+// thread at startup and in the first paint delays the first frame, and it grows with every font.
+//
+// add() queues a typeface and returns straight away. A worker thread creates the typeface, lays out
+// the requested characters at each requested height, which builds the glyph tables, and, if asked,
+// draws them into a scratch software image, which fills the software renderer's glyph cache. Then
+// onReady is called on the message thread. get() never waits; it returns nullptr until the typeface
+// is ready, so callers draw with a fallback font until then and relayout from onReady.
+//
+// The Direct2D renderer keeps its own glyph cache on the GPU, which can only be filled by drawing on
+// the message thread, so pre-rasterising only helps the software renderer.
+//
+// The font data must outlive the loader; BinaryData does. Call add() and get() on the message thread.
+// onReady may come after the loader is gone, so it shouldn't touch the loader.
+//
+class TypefaceWarmUp
+{
+public:
+    struct Options
+    {
+        juce::String characters = getPrintableASCII();
+        juce::Array<float> heights{ 14.0f, 24.0f, 30.0f };
+        bool rasterise = true;
+    };
+
+    TypefaceWarmUp(int numThreads = juce::jmax(1, juce::SystemStats::getNumCpus() / 2)) :
+        threadPool(numThreads)
+    {
+    }
+
+    ~TypefaceWarmUp()
+    {
+        threadPool.removeAllJobs(true, -1);
+    }
+
+    int add(void const* fontData, size_t fontDataSize, std::function<void()> onReady)
+    {
+        return add(fontData, fontDataSize, Options{}, std::move(onReady));
+    }
+
+    int add(void const* fontData, size_t fontDataSize, Options options, std::function<void()> onReady)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        auto index = (int)entries.size();
+        entries.push_back(std::make_unique<Entry>(fontData, fontDataSize, std::move(options)));
+
+        auto entry = entries.back().get();
+        threadPool.addJob([entry, onReady = std::move(onReady)]
+            {
+                warmUp(*entry);
+
+                juce::MessageManager::callAsync([onReady]
+                    {
+                        if (onReady != nullptr)
+                        {
+                            onReady();
+                        }
+                    });
+            });
+
+        return index;
+    }
+
+    //
+    // Null until the typeface is ready
+    //
+    juce::Typeface::Ptr get(int index) const
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        auto const& entry = *entries[(size_t)index];
+        return entry.ready ? entry.typeface : nullptr;
+    }
+
+    bool isReady(int index) const
+    {
+        return entries[(size_t)index]->ready;
+    }
+
+    bool areAllReady() const
+    {
+        return std::all_of(entries.begin(), entries.end(), [](auto const& entry) { return entry->ready.load(); });
+    }
+
+    struct Metrics
+    {
+        int numTypefaces = 0;
+        int numReady = 0;
+        int numGlyphsWarmed = 0;
+        double workerMilliseconds = 0.0;
+    };
+
+    Metrics getMetrics() const
+    {
+        Metrics metrics;
+        metrics.numTypefaces = (int)entries.size();
+
+        for (auto const& entry : entries)
+        {
+            if (entry->ready)
+            {
+                ++metrics.numReady;
+                metrics.numGlyphsWarmed += entry->numGlyphsWarmed;
+                metrics.workerMilliseconds += entry->workerMilliseconds;
+            }
+        }
+
+        return metrics;
+    }
+
+    static juce::String getPrintableASCII()
+    {
+        juce::String characters;
+        for (juce::juce_wchar character = 0x20; character < 0x7f; ++character)
+        {
+            characters << juce::String::charToString(character);
+        }
+
+        return characters;
+    }
+
+private:
+    struct Entry
+    {
+        Entry(void const* fontData_, size_t fontDataSize_, Options options_) :
+            fontData(fontData_),
+            fontDataSize(fontDataSize_),
+            options(std::move(options_))
+        {
+        }
+
+        void const* const fontData;
+        size_t const fontDataSize;
+        Options const options;
+
+        //
+        // Written by the worker before ready is set
+        //
+        juce::Typeface::Ptr typeface;
+        int numGlyphsWarmed = 0;
+        double workerMilliseconds = 0.0;
+
+        std::atomic<bool> ready{ false };
+    };
+
+    std::vector<std::unique_ptr<Entry>> entries;
+    juce::ThreadPool threadPool;
+
+    static void warmUp(Entry& entry)
+    {
+        auto start = juce::Time::getHighResolutionTicks();
+
+        entry.typeface = juce::Typeface::createSystemTypefaceFor(entry.fontData, entry.fontDataSize);
+
+        if (entry.typeface != nullptr)
+        {
+            for (auto height : entry.options.heights)
+            {
+                auto font = juce::Font{ entry.typeface }.withHeight(height);
+
+                juce::GlyphArrangement arrangement;
+                arrangement.addLineOfText(font, entry.options.characters, 0.0f, font.getAscent());
+                entry.numGlyphsWarmed += arrangement.getNumGlyphs();
+
+                if (entry.options.rasterise && arrangement.getNumGlyphs() > 0)
+                {
+                    auto bounds = arrangement.getBoundingBox(0, -1, true).getSmallestIntegerContainer();
+                    juce::Image scratch{ juce::Image::SingleChannel, juce::jmax(1, bounds.getRight()), juce::jmax(1, bounds.getBottom()), false, juce::SoftwareImageType{} };
+
+                    juce::Graphics g{ scratch };
+                    g.setColour(juce::Colours::white);
+                    arrangement.draw(g);
+                }
+            }
+        }
+
+        entry.workerMilliseconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+        entry.ready = true;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TypefaceWarmUp)
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+//
+// The test path shared by the cached path creation test and benchmark: a circle of the given
+// diameter with a sine wave running round its edge, centred on the origin and built from
+// numSegments straight line segments
+//
+struct WavyCirclePath
+{
+    static juce::Path create(float size, int numSegments)
+    {
+        juce::Path path;
+        auto area = juce::Rectangle<float>{ size, size }.withCentre({});
+
+        int numCycles = 12;
+        float angle = 0.0f;
+        float angleStep = juce::MathConstants<float>::twoPi / (float)numSegments;
+        float radius = area.getWidth() * 0.5f;
+        float amplitude = radius * 0.25f;
+        path.preallocateSpace(numSegments * 3 + 4);
+        path.startNewSubPath(area.getCentreX(), area.getCentreY() - radius);
+        angle += angleStep;
+
+        while (angle < juce::MathConstants<float>::twoPi)
+        {
+            auto distance = amplitude * std::sin(angle * (float)numCycles);
+            auto point = area.getCentre().getPointOnCircumference(distance + radius, angle);
+            path.lineTo(point);
+            angle += angleStep;
+        }
+        path.closeSubPath();
+
+        return path;
+    }
+};